@@ -0,0 +1,524 @@
+#ifndef DELTA_HISTORY_H
+#define DELTA_HISTORY_H
+
+/**
+ * @file DeltaHistory.h
+ *
+ * @brief Fixed-memory time series of readings, which are kept on the node while WiFi or the Home Assistant API is down
+ *        and are sent in batches after reconnecting (DeltaHistoryBackfill). Used by the HR20 controllers and the Govee proxy.
+ *        The memory is split into blocks. A record holds the source (e.g. the number of a sensor), the time and the values
+ *        as difference to the previous record of the block, zigzag and varint encoded: a slowly changing value needs one byte.
+ *        The first record of a block is encoded against 0, so every block is decoded on its own and the oldest block is
+ *        dropped when the memory is full.
+ *        The class has no constructor and Restore() validates the content, so it can be placed in memory which survives
+ *        a warm boot, e.g. "static RTC_NOINIT_ATTR DeltaHistory<4> history;" on an ESP32.
+ *
+ */
+
+#include "esphome.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+/**
+ * @tparam VALUES Number of values per sample.
+ * @tparam BLOCKS Number of blocks, the oldest one is dropped when the memory is full.
+ * @tparam BLOCK_SIZE Bytes of encoded records per block.
+ */
+template <size_t VALUES, size_t BLOCKS = 16, size_t BLOCK_SIZE = 256>
+class DeltaHistory
+{
+public:
+    /// @brief Value which is not known, e.g. the valve position of a backend without status lines
+    static constexpr int16_t UNKNOWN{ INT16_MIN };
+
+    /// @brief Max size of an encoded record: source, time (5 bytes) and the values (3 bytes each)
+    static constexpr size_t MAX_RECORD_SIZE{ 1u + 5u + (3u * VALUES) };
+
+    static_assert(BLOCKS > 1u, "the newest block must be kept, when the oldest one is dropped");
+    static_assert((BLOCK_SIZE >= MAX_RECORD_SIZE) && (BLOCK_SIZE <= UINT16_MAX), "a record must fit into a block");
+
+    /**
+     * @brief One decoded sample, without default member initializers like the history
+     */
+    struct Sample
+    {
+        /// @brief Running number of the sample, the cursor of Read() points to it
+        uint32_t sequence;
+
+        /// @brief Time in seconds, as given to Add()
+        uint32_t time;
+
+        /// @brief Source of the sample, e.g. the number of the sensor
+        uint8_t source;
+
+        int16_t values[VALUES];
+    };
+
+    /**
+     * @brief Validate the content after a boot and clear it, if it is not consistent (e.g. random RAM after power on).
+     *        Must be called once before the history is used.
+     *
+     * @return true if the samples were kept.
+     */
+    bool Restore(void);
+
+    /**
+     * @brief Drop all samples.
+     */
+    void Clear(void);
+
+    /**
+     * @brief Append a sample. If the newest block is full, the next block is started and the oldest one is dropped.
+     *
+     * @param time Time in seconds, e.g. time(nullptr).
+     * @param source Source of the sample.
+     * @param values The values, UNKNOWN if a value is not known.
+     */
+    void Add(uint32_t time, uint8_t source, const int16_t (&values)[VALUES]);
+
+    /**
+     * @brief Decode a batch of samples, starting at the cursor.
+     *
+     * @param cursor Sequence of the first sample, the oldest one is used if it was dropped already.
+     *               Receives the sequence behind the last decoded sample.
+     * @param samples Receives the samples.
+     * @param maxSamples Max number of samples.
+     * @return Number of decoded samples, less than maxSamples if there are no more.
+     */
+    size_t Read(uint32_t& cursor, Sample* samples, size_t maxSamples) const;
+
+    /// @brief Sequence of the oldest stored sample
+    uint32_t OldestSequence(void) const { return blocks_[oldest()].firstSequence; }
+
+    /// @brief Sequence of the next added sample
+    uint32_t NextSequence(void) const { return nextSequence_; }
+
+    /// @brief Number of stored samples
+    uint32_t Count(void) const { return nextSequence_ - OldestSequence(); }
+
+    /// @brief Bytes of encoded records
+    size_t UsedBytes(void) const;
+
+    /// @brief Bytes of all blocks
+    static constexpr size_t Capacity(void) { return BLOCKS * BLOCK_SIZE; }
+
+    /// @brief Sequence of the first sample, which was not transferred yet (see DeltaHistoryBackfill)
+    uint32_t Transferred(void) const { return transferred_; }
+    void SetTransferred(uint32_t sequence) { transferred_ = sequence; }
+
+    /// @brief Samples which were dropped before they were transferred
+    uint32_t Lost(void) const { return lost_; }
+
+private:
+    /// @brief Marks a valid content, combined with the layout
+    static constexpr uint32_t MAGIC{ 0x44485354u ^ static_cast<uint32_t>((VALUES << 24) ^ (BLOCKS << 16) ^ BLOCK_SIZE) };
+
+    /**
+     * @brief Encoded records of a time range
+     */
+    struct Block
+    {
+        /// @brief Sequence of the first record
+        uint32_t firstSequence;
+
+        /// @brief Number of records and their bytes
+        uint16_t count;
+        uint16_t used;
+
+        uint8_t data[BLOCK_SIZE];
+    };
+
+    /// @brief Index of the oldest block
+    size_t oldest(void) const { return (newest_ + BLOCKS + 1u - blockCount_) % BLOCKS; }
+
+    /**
+     * @brief Decode the next record of a block.
+     *
+     * @param block The block.
+     * @param position Position of the record, receives the position of the next one.
+     * @param sample The previous sample of the block (all 0 for the first one), receives the decoded one.
+     * @return false if the record exceeds the used bytes.
+     */
+    static bool decode(const Block& block, size_t& position, Sample& sample);
+
+    /**
+     * @brief Encode a record against the previous record of the newest block.
+     * @return Number of bytes, at most MAX_RECORD_SIZE.
+     */
+    size_t encode(uint32_t time, uint8_t source, const int16_t (&values)[VALUES], uint8_t* record) const;
+
+    /// @return Number of bytes
+    static size_t putVarint(uint8_t* data, uint32_t value);
+    static bool getVarint(const Block& block, size_t& position, uint32_t& value);
+
+    /// @brief Small differences of both signs to small numbers: 0, -1, 1, -2 ... to 0, 1, 2, 3 ...
+    static uint32_t zigzag(int32_t value) { return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31); }
+    static int32_t unzigzag(uint32_t value) { return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1u); }
+
+    // no default member initializers, the content of a memory which survives a reboot must not be overwritten at startup
+    uint32_t magic_;
+    uint32_t newest_;
+    uint32_t blockCount_;
+    uint32_t nextSequence_;
+    uint32_t transferred_;
+    uint32_t lost_;
+
+    /// @brief Previous record of the newest block, the differences of the next record refer to it
+    Sample last_;
+
+    Block blocks_[BLOCKS];
+};
+
+// Public functions
+
+template <size_t VALUES, size_t BLOCKS, size_t BLOCK_SIZE>
+bool DeltaHistory<VALUES, BLOCKS, BLOCK_SIZE>::Restore(void)
+{
+    bool valid = (magic_ == MAGIC) && (newest_ < BLOCKS) && (blockCount_ >= 1u) && (blockCount_ <= BLOCKS);
+
+    // the sequences of the blocks must follow each other and every block must decode to its number of records,
+    // a record cut off by the reboot or a corrupted byte invalidates the content
+    for (size_t i = 0; valid && (i < blockCount_); ++i)
+    {
+        const Block& block    = blocks_[(oldest() + i) % BLOCKS];
+        const uint32_t follow = (i + 1u < blockCount_) ? blocks_[(oldest() + i + 1u) % BLOCKS].firstSequence : nextSequence_;
+        Sample sample{};
+        size_t position = 0;
+
+        valid = (block.used <= BLOCK_SIZE) && ((block.firstSequence + block.count) == follow);
+
+        for (uint16_t k = 0; valid && (k < block.count); ++k)
+        {
+            valid = decode(block, position, sample);
+        }
+
+        valid = valid && (position == block.used);
+
+        // the encoder continues with the last record of the newest block
+        last_ = sample;
+    }
+
+    if (!valid)
+    {
+        Clear();
+        return false;
+    }
+
+    // nothing is sent twice or skipped
+    if (static_cast<int32_t>(transferred_ - OldestSequence()) < 0)
+    {
+        transferred_ = OldestSequence();
+    }
+    else if (static_cast<int32_t>(nextSequence_ - transferred_) < 0)
+    {
+        transferred_ = nextSequence_;
+    }
+
+    return true;
+}
+
+template <size_t VALUES, size_t BLOCKS, size_t BLOCK_SIZE>
+void DeltaHistory<VALUES, BLOCKS, BLOCK_SIZE>::Clear(void)
+{
+    magic_        = MAGIC;
+    newest_       = 0;
+    blockCount_   = 1;
+    nextSequence_ = 0;
+    transferred_  = 0;
+    lost_         = 0;
+    last_         = Sample{};
+
+    blocks_[0].firstSequence = 0;
+    blocks_[0].count         = 0;
+    blocks_[0].used          = 0;
+}
+
+template <size_t VALUES, size_t BLOCKS, size_t BLOCK_SIZE>
+void DeltaHistory<VALUES, BLOCKS, BLOCK_SIZE>::Add(uint32_t time, uint8_t source, const int16_t (&values)[VALUES])
+{
+    uint8_t record[MAX_RECORD_SIZE];
+    size_t length = encode(time, source, values, record);
+
+    if ((blocks_[newest_].used + length) > BLOCK_SIZE)
+    {
+        // the oldest block is overwritten, if all blocks are used
+        if (blockCount_ == BLOCKS)
+        {
+            const Block& dropped   = blocks_[oldest()];
+            const uint32_t dropEnd = dropped.firstSequence + dropped.count;
+
+            if (static_cast<int32_t>(dropEnd - transferred_) > 0)
+            {
+                lost_        += dropEnd - transferred_;
+                transferred_ = dropEnd;
+            }
+        }
+        else
+        {
+            ++blockCount_;
+        }
+
+        const uint32_t next = (newest_ + 1u) % BLOCKS;
+
+        blocks_[next].firstSequence = nextSequence_;
+        blocks_[next].count         = 0;
+        blocks_[next].used          = 0;
+        newest_                     = next;
+
+        // the first record of a block is encoded against 0
+        last_  = Sample{};
+        length = encode(time, source, values, record);
+    }
+
+    // the record is complete before it is counted, Restore() detects a reboot in between
+    Block& block = blocks_[newest_];
+    memcpy(&block.data[block.used], record, length);
+    block.used = static_cast<uint16_t>(block.used + length);
+    ++block.count;
+    ++nextSequence_;
+
+    last_.time   = time;
+    last_.source = source;
+    memcpy(last_.values, values, sizeof(last_.values));
+}
+
+template <size_t VALUES, size_t BLOCKS, size_t BLOCK_SIZE>
+size_t DeltaHistory<VALUES, BLOCKS, BLOCK_SIZE>::Read(uint32_t& cursor, Sample* samples, size_t maxSamples) const
+{
+    size_t count = 0;
+
+    if (static_cast<int32_t>(cursor - OldestSequence()) < 0)
+    {
+        cursor = OldestSequence();
+    }
+
+    for (size_t i = 0; (i < blockCount_) && (count < maxSamples); ++i)
+    {
+        const Block& block = blocks_[(oldest() + i) % BLOCKS];
+        Sample sample{};
+        size_t position = 0;
+
+        // skip the blocks in front of the cursor without decoding them
+        if (static_cast<int32_t>(cursor - (block.firstSequence + block.count)) >= 0)
+        {
+            continue;
+        }
+
+        for (uint16_t k = 0; (k < block.count) && (count < maxSamples); ++k)
+        {
+            if (!decode(block, position, sample))
+            {
+                return count;
+            }
+
+            sample.sequence = block.firstSequence + k;
+
+            if (static_cast<int32_t>(sample.sequence - cursor) >= 0)
+            {
+                samples[count++] = sample;
+                cursor           = sample.sequence + 1u;
+            }
+        }
+    }
+
+    return count;
+}
+
+template <size_t VALUES, size_t BLOCKS, size_t BLOCK_SIZE>
+size_t DeltaHistory<VALUES, BLOCKS, BLOCK_SIZE>::UsedBytes(void) const
+{
+    size_t used = 0;
+
+    for (size_t i = 0; i < blockCount_; ++i)
+    {
+        used += blocks_[(oldest() + i) % BLOCKS].used;
+    }
+
+    return used;
+}
+
+// Private functions
+
+template <size_t VALUES, size_t BLOCKS, size_t BLOCK_SIZE>
+size_t DeltaHistory<VALUES, BLOCKS, BLOCK_SIZE>::encode(uint32_t time, uint8_t source, const int16_t (&values)[VALUES],
+                                                        uint8_t* record) const
+{
+    size_t length = 0;
+
+    record[length++] = source;
+    length += putVarint(&record[length], time - last_.time);
+
+    for (size_t i = 0; i < VALUES; ++i)
+    {
+        length += putVarint(&record[length], zigzag(static_cast<int32_t>(values[i]) - last_.values[i]));
+    }
+
+    return length;
+}
+
+template <size_t VALUES, size_t BLOCKS, size_t BLOCK_SIZE>
+bool DeltaHistory<VALUES, BLOCKS, BLOCK_SIZE>::decode(const Block& block, size_t& position, Sample& sample)
+{
+    uint32_t value = 0;
+
+    if ((position >= block.used) || (block.used > BLOCK_SIZE))
+    {
+        return false;
+    }
+
+    sample.source = block.data[position++];
+
+    if (!getVarint(block, position, value))
+    {
+        return false;
+    }
+
+    sample.time += value;
+
+    for (size_t i = 0; i < VALUES; ++i)
+    {
+        if (!getVarint(block, position, value))
+        {
+            return false;
+        }
+
+        sample.values[i] = static_cast<int16_t>(sample.values[i] + unzigzag(value));
+    }
+
+    return true;
+}
+
+template <size_t VALUES, size_t BLOCKS, size_t BLOCK_SIZE>
+size_t DeltaHistory<VALUES, BLOCKS, BLOCK_SIZE>::putVarint(uint8_t* data, uint32_t value)
+{
+    size_t length = 0;
+
+    // 7 bits per byte, the high bit marks a following byte
+    while (value >= 0x80u)
+    {
+        data[length++] = static_cast<uint8_t>(value | 0x80u);
+        value >>= 7;
+    }
+
+    data[length++] = static_cast<uint8_t>(value);
+
+    return length;
+}
+
+template <size_t VALUES, size_t BLOCKS, size_t BLOCK_SIZE>
+bool DeltaHistory<VALUES, BLOCKS, BLOCK_SIZE>::getVarint(const Block& block, size_t& position, uint32_t& value)
+{
+    value = 0;
+
+    for (uint32_t shift = 0; (shift < 35u) && (position < block.used); shift += 7u)
+    {
+        const uint8_t byte = block.data[position++];
+        value |= static_cast<uint32_t>(byte & 0x7Fu) << shift;
+
+        if ((byte & 0x80u) == 0u)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#ifdef USE_API
+/**
+ * @brief Sends the samples, which were recorded while no Home Assistant client was connected, as events after reconnecting.
+ *        Loop() sends one event with up to BATCH samples per call, so the whole backlog is transferred within a few loops.
+ *        Samples recorded while a client is connected were published live and are skipped.
+ *        Event data: "device": name of the device, "now": time(nullptr) of the node (the age of a sample is now - time,
+ *        also without time synchronisation), "samples": "<time>,<source>,<value>,...;" per sample, an unknown value is empty.
+ */
+template <typename History, size_t BATCH = 16>
+class DeltaHistoryBackfill
+{
+public:
+    /**
+     * @brief Set the history and the event, e.g. "esphome.honeywell_history".
+     */
+    void Attach(History* history, const char* event, const std::string& device)
+    {
+        history_ = history;
+        event_   = event;
+        device_  = device;
+    }
+
+    /**
+     * @brief Send the next batch, if a client is connected. Called from loop() of the component.
+     */
+    void Loop(void)
+    {
+        if ((history_ == nullptr) || !api_.is_connected())
+        {
+            caught_up_ = false;
+            return;
+        }
+
+        if (caught_up_)
+        {
+            history_->SetTransferred(history_->NextSequence());
+            return;
+        }
+
+        typename History::Sample samples[BATCH];
+        uint32_t cursor     = history_->Transferred();
+        const size_t count  = history_->Read(cursor, samples, BATCH);
+        std::string encoded;
+
+        encoded.reserve(count * 32u);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            char field[16];
+
+            snprintf(field, sizeof(field), "%u,%u", static_cast<unsigned>(samples[i].time), static_cast<unsigned>(samples[i].source));
+            encoded += field;
+
+            for (int16_t value : samples[i].values)
+            {
+                encoded += ',';
+
+                if (value != History::UNKNOWN)
+                {
+                    snprintf(field, sizeof(field), "%d", static_cast<int>(value));
+                    encoded += field;
+                }
+            }
+
+            encoded += ';';
+        }
+
+        if (count > 0u)
+        {
+            api_.fire_homeassistant_event(event_, { { "device", device_ },
+                                                    { "now", std::to_string(static_cast<uint32_t>(::time(nullptr))) },
+                                                    { "samples", encoded } });
+            history_->SetTransferred(cursor);
+            ESP_LOGD("history", "%s: %u samples sent, %u lost", device_.c_str(), static_cast<unsigned>(count),
+                     static_cast<unsigned>(history_->Lost()));
+        }
+
+        caught_up_ = (count < BATCH);
+    }
+
+private:
+    History* history_{ nullptr };
+    std::string event_;
+    std::string device_;
+
+    /// @brief Fires the events
+    api::CustomAPIDevice api_;
+
+    /// @brief The backlog of the current connection was sent
+    bool caught_up_{ false };
+};
+#endif
+
+#endif
@@ -0,0 +1,537 @@
+#ifndef GOVEE_ADVERTISEMENT_DECODER_H
+#define GOVEE_ADVERTISEMENT_DECODER_H
+
+/**
+ * @file GoveeAdvertisementDecoder.h
+ *
+ * @brief Decoder of the BLE advertisements of Govee thermo-hygrometers (H5105, H5179, ...).
+ *        The sensors are registered with their MAC address in a fixed hash table, so every advertisement is dispatched
+ *        in constant time, independent of the number of sensors. Advertisements whose payload equals the previous one
+ *        of the same sensor are dropped before any conversion, and only the values which changed are published.
+ *        Optionally temperature and humidity are aggregated over a time window (see set_window()): the mean of the window is
+ *        published once per window, a reading which moves past a delta threshold is published at once.
+ *        Optionally the published values are recorded in a history (see set_history()), which is sent to Home Assistant
+ *        after the API was disconnected.
+ *
+ */
+
+#include "DeltaHistory.h"
+#include "esphome.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+/**
+ * @brief History of the published values: temperature (1/10 °C), humidity (1/10 %) and battery level (%).
+ *        The source of a sample is the number of the sensor in the order of add_sensor().
+ */
+using GoveeHistory = DeltaHistory<3>;
+
+/**
+ * @brief One decoded advertisement, all values in fixed point.
+ */
+struct GoveeReading
+{
+    /// @brief Temperature in 1/10 °C
+    int16_t temperature{ 0 };
+
+    /// @brief Relative humidity in 1/10 %
+    uint16_t humidity{ 0 };
+
+    /// @brief Battery level in %
+    uint8_t battery{ 0 };
+};
+
+/**
+ * @brief Decode the manufacturer data (id 0x0001) of a Govee thermo-hygrometer.
+ *        Bytes 2 ... 4 are a big endian 24 bit number: temperature (1/10 °C) * 1000 + humidity (1/10 %).
+ *        Bit 23 is the sign of the temperature. Byte 5 is the battery level.
+ *
+ * @param data The manufacturer data.
+ * @param length Number of bytes.
+ * @param reading The decoded values.
+ * @return false if the data is too short or the values are out of range.
+ */
+bool GoveeDecode(const uint8_t* data, size_t length, GoveeReading& reading)
+{
+    static constexpr uint32_t SIGN_BIT{ 0x800000u };
+
+    if (length < 6u)
+    {
+        return false;
+    }
+
+    const uint32_t raw       = (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 8) | data[4];
+    const uint32_t magnitude = raw & (SIGN_BIT - 1u);
+    const uint32_t humidity  = magnitude % 1000u;
+    const uint32_t degrees   = magnitude / 1000u;
+
+    // more than 100 °C or a battery level above 100 % is a corrupted advertisement
+    if ((degrees > 1000u) || (data[5] > 100u))
+    {
+        return false;
+    }
+
+    reading.temperature = static_cast<int16_t>(((raw & SIGN_BIT) != 0u) ? -static_cast<int32_t>(degrees) : static_cast<int32_t>(degrees));
+    reading.humidity    = static_cast<uint16_t>(humidity);
+    reading.battery     = data[5];
+
+    return true;
+}
+
+/**
+ * @brief Fixed-size ring buffer of the last readings of one value, with min, max and mean. Nothing is allocated.
+ *        If a window contains more than N readings, only the last N are kept.
+ */
+template <size_t N>
+class GoveeWindow
+{
+public:
+    void Add(int16_t value)
+    {
+        samples_[next_] = value;
+        next_           = (next_ + 1u) % N;
+        count_          = (count_ < N) ? (count_ + 1u) : N;
+    }
+
+    void Clear(void)
+    {
+        next_  = 0;
+        count_ = 0;
+    }
+
+    /// @brief Number of readings in the window
+    size_t Count(void) const { return count_; }
+
+    int16_t Min(void) const
+    {
+        int16_t min = samples_[0];
+
+        for (size_t i = 1; i < count_; ++i)
+        {
+            min = (samples_[i] < min) ? samples_[i] : min;
+        }
+
+        return min;
+    }
+
+    int16_t Max(void) const
+    {
+        int16_t max = samples_[0];
+
+        for (size_t i = 1; i < count_; ++i)
+        {
+            max = (samples_[i] > max) ? samples_[i] : max;
+        }
+
+        return max;
+    }
+
+    /// @brief Mean of the readings, rounded half away from zero. 0 if the window is empty.
+    int16_t Mean(void) const
+    {
+        int32_t sum = 0;
+
+        for (size_t i = 0; i < count_; ++i)
+        {
+            sum += samples_[i];
+        }
+
+        if (count_ == 0u)
+        {
+            return 0;
+        }
+
+        const int32_t count = static_cast<int32_t>(count_);
+        return static_cast<int16_t>((sum >= 0) ? ((sum + (count / 2)) / count) : ((sum - (count / 2)) / count));
+    }
+
+private:
+    int16_t samples_[N]{};
+    size_t next_{ 0 };
+    size_t count_{ 0 };
+};
+
+/**
+ * ESPHome component, which decodes the advertisements of all registered Govee sensors and publishes them to template sensors.
+ * It is registered as listener of the esp32_ble_tracker in the YAML:
+ *
+ *   auto govee = new GoveeAdvertisementDecoder();
+ *   govee->add_sensor(0xC73533336673ULL, id(govee_1_temperature), id(govee_1_humidity), id(govee_1_battery));
+ *   govee->set_window(60000, 5, 20);
+ *   id(ble_tracker)->register_listener(govee);
+ *   return {govee};
+ */
+class GoveeAdvertisementDecoder : public Component, public esp32_ble_tracker::ESPBTDeviceListener
+{
+public:
+    /// @brief Max number of sensors, a power of 2 which is larger than the number of sensors keeps the probe sequences short
+    static constexpr size_t MAX_SENSORS{ 64 };
+
+    /// @brief Manufacturer id of the advertisements with the sensor values
+    static constexpr uint16_t MANUFACTURER_ID{ 0x0001 };
+
+    /// @brief Number of readings per value in the ring buffer of a window
+    static constexpr size_t WINDOW_SAMPLES{ 16 };
+
+    /**
+     * @brief Register a sensor. Any of the template sensors may be nullptr.
+     *
+     * @param address MAC address, e.g. 0xC73533336673ULL for C7:35:33:33:66:73.
+     * @return false if the table is full or the address is already registered.
+     */
+    bool add_sensor(uint64_t address, sensor::Sensor* temperature, sensor::Sensor* humidity, sensor::Sensor* battery);
+
+    /**
+     * @brief Aggregate temperature and humidity over a window instead of publishing every change.
+     *        The battery level is always published when it changes.
+     *
+     * @param window_ms Length of the window, 0 publishes every change (default).
+     * @param temperature_delta A temperature which differs by this value from the published one is published at once, in 1/10 °C.
+     * @param humidity_delta A humidity which differs by this value from the published one is published at once, in 1/10 %.
+     */
+    void set_window(uint32_t window_ms, uint16_t temperature_delta, uint16_t humidity_delta)
+    {
+        window_ms_         = window_ms;
+        temperature_delta_ = temperature_delta;
+        humidity_delta_    = humidity_delta;
+    }
+
+    /**
+     * @brief Record the published values in a history. Must be called before setup(), the history may be placed in RTC memory.
+     */
+    void set_history(GoveeHistory* history) { history_ = history; }
+
+    void setup() override;
+
+    void loop() override;
+
+    bool parse_device(const esp32_ble_tracker::ESPBTDevice& device) override;
+
+    void dump_config() override;
+
+    float get_setup_priority() const override { return setup_priority::DATA; }
+
+private:
+    /// @brief Number of payload bytes (2 ... 5), which are compared to detect a duplicate
+    static constexpr size_t PAYLOAD_LENGTH{ 4 };
+
+    /**
+     * @brief One registered sensor
+     */
+    struct Slot
+    {
+        /// @brief MAC address, 0 = free slot
+        uint64_t address{ 0 };
+
+        /// @brief Number of the sensor in the order of add_sensor(), the source in the history
+        uint8_t number{ 0 };
+
+        sensor::Sensor* temperature{ nullptr };
+        sensor::Sensor* humidity{ nullptr };
+        sensor::Sensor* battery{ nullptr };
+
+        /// @brief Payload and values of the last published advertisement
+        uint8_t payload[PAYLOAD_LENGTH]{};
+        GoveeReading reading;
+        bool published{ false };
+
+        /// @brief Readings since the last published value
+        GoveeWindow<WINDOW_SAMPLES> temperature_window;
+        GoveeWindow<WINDOW_SAMPLES> humidity_window;
+
+        uint32_t advertisements{ 0 };
+        uint32_t duplicates{ 0 };
+    };
+
+    /**
+     * @brief Start of the probe sequence of an address (multiplicative hashing of the 48 bit address).
+     */
+    static size_t hash(uint64_t address) { return static_cast<size_t>((address * 0x9E3779B97F4A7C15ULL) >> 32) & (MAX_SENSORS - 1u); }
+
+    /**
+     * @brief Find the slot of an address with linear probing.
+     * @return The slot, nullptr if the address is not registered.
+     */
+    Slot* find(uint64_t address);
+
+    /**
+     * @brief Publish the values, which differ from the last published ones.
+     */
+    void publish(Slot& slot, const GoveeReading& reading);
+
+    /**
+     * @brief Add a reading to the windows of the sensor. Values which moved past the delta threshold are published at once.
+     */
+    void aggregate(Slot& slot, const GoveeReading& reading);
+
+    /**
+     * @brief Publish the mean of the windows of all sensors and start the next windows.
+     */
+    void publish_windows();
+
+    Slot slots_[MAX_SENSORS];
+    size_t sensor_count_{ 0 };
+
+    uint32_t window_ms_{ 0 };
+    uint16_t temperature_delta_{ 0 };
+    uint16_t humidity_delta_{ 0 };
+
+    /// @brief History of the published values, nullptr if not used
+    GoveeHistory* history_{ nullptr };
+
+#ifdef USE_API
+    /// @brief Sends the samples recorded during an outage of the API
+    DeltaHistoryBackfill<GoveeHistory> history_backfill_;
+#endif
+
+    /// @brief Advertisements of registered sensors without sensor values (e.g. scan responses) or with invalid values
+    uint32_t unknown_advertisements_{ 0 };
+    uint32_t invalid_advertisements_{ 0 };
+};
+
+static_assert((GoveeAdvertisementDecoder::MAX_SENSORS & (GoveeAdvertisementDecoder::MAX_SENSORS - 1u)) == 0u,
+              "the hash needs a power of 2");
+
+// Public functions
+
+bool GoveeAdvertisementDecoder::add_sensor(uint64_t address, sensor::Sensor* temperature, sensor::Sensor* humidity, sensor::Sensor* battery)
+{
+    // one slot stays free, so every unsuccessful lookup ends at a free slot
+    if ((address == 0u) || (sensor_count_ >= (MAX_SENSORS - 1u)) || (find(address) != nullptr))
+    {
+        ESP_LOGW("govee", "Sensor %012llX not added (duplicate or more than %u sensors)", static_cast<unsigned long long>(address),
+                 static_cast<unsigned>(MAX_SENSORS - 1u));
+        return false;
+    }
+
+    size_t index = hash(address);
+
+    while (slots_[index].address != 0u)
+    {
+        index = (index + 1u) % MAX_SENSORS;
+    }
+
+    slots_[index].address     = address;
+    slots_[index].number      = static_cast<uint8_t>(sensor_count_);
+    slots_[index].temperature = temperature;
+    slots_[index].humidity    = humidity;
+    slots_[index].battery     = battery;
+    ++sensor_count_;
+
+    return true;
+}
+
+void GoveeAdvertisementDecoder::setup()
+{
+    if (window_ms_ > 0u)
+    {
+        this->set_interval("window", window_ms_, [this]() { publish_windows(); });
+    }
+
+    if (history_ != nullptr)
+    {
+        if (history_->Restore())
+        {
+            ESP_LOGI("govee", "History restored: %u samples", static_cast<unsigned>(history_->Count()));
+        }
+#ifdef USE_API
+        history_backfill_.Attach(history_, "esphome.govee_history", App.get_name());
+#endif
+    }
+}
+
+void GoveeAdvertisementDecoder::loop()
+{
+#ifdef USE_API
+    history_backfill_.Loop();
+#endif
+}
+
+bool GoveeAdvertisementDecoder::parse_device(const esp32_ble_tracker::ESPBTDevice& device)
+{
+    Slot* slot = find(device.address_uint64());
+
+    if (slot == nullptr)
+    {
+        return false;
+    }
+
+    for (const esp32_ble_tracker::ServiceData& manufacturer_data : device.get_manufacturer_datas())
+    {
+        const std::vector<uint8_t>& data = manufacturer_data.data;
+
+        if (!(manufacturer_data.uuid == esp32_ble_tracker::ESPBTUUID::from_uint16(MANUFACTURER_ID)))
+        {
+            continue;
+        }
+
+        ++slot->advertisements;
+
+        // the sensor repeats the same advertisement several times per second, nothing is converted or published for a repetition
+        if ((data.size() >= (2u + PAYLOAD_LENGTH)) && slot->published && (0 == memcmp(slot->payload, &data[2], PAYLOAD_LENGTH)))
+        {
+            ++slot->duplicates;
+            return true;
+        }
+
+        GoveeReading reading;
+
+        if (!GoveeDecode(data.data(), data.size(), reading))
+        {
+            ++invalid_advertisements_;
+            return true;
+        }
+
+        memcpy(slot->payload, &data[2], PAYLOAD_LENGTH);
+
+        if (window_ms_ > 0u)
+        {
+            aggregate(*slot, reading);
+        }
+        else
+        {
+            publish(*slot, reading);
+        }
+
+        return true;
+    }
+
+    ++unknown_advertisements_;
+
+    return true;
+}
+
+void GoveeAdvertisementDecoder::dump_config()
+{
+    ESP_LOGCONFIG("govee", "Govee advertisement decoder: %u sensors", static_cast<unsigned>(sensor_count_));
+
+    if (window_ms_ > 0u)
+    {
+        ESP_LOGCONFIG("govee", "  window: %u ms, delta: %.1f °C, %.1f %%", static_cast<unsigned>(window_ms_),
+                      static_cast<float>(temperature_delta_) / 10.0f, static_cast<float>(humidity_delta_) / 10.0f);
+    }
+
+    for (const Slot& slot : slots_)
+    {
+        if (slot.address != 0u)
+        {
+            ESP_LOGCONFIG("govee", "  %012llX: %u advertisements, %u duplicates", static_cast<unsigned long long>(slot.address),
+                          static_cast<unsigned>(slot.advertisements), static_cast<unsigned>(slot.duplicates));
+        }
+    }
+
+    ESP_LOGCONFIG("govee", "  without sensor values: %u, invalid: %u", static_cast<unsigned>(unknown_advertisements_),
+                  static_cast<unsigned>(invalid_advertisements_));
+
+    if (history_ != nullptr)
+    {
+        ESP_LOGCONFIG("govee", "  history: %u samples in %u of %u bytes, %u lost", static_cast<unsigned>(history_->Count()),
+                      static_cast<unsigned>(history_->UsedBytes()), static_cast<unsigned>(GoveeHistory::Capacity()),
+                      static_cast<unsigned>(history_->Lost()));
+    }
+}
+
+// Private functions
+
+GoveeAdvertisementDecoder::Slot* GoveeAdvertisementDecoder::find(uint64_t address)
+{
+    for (size_t index = hash(address); slots_[index].address != 0u; index = (index + 1u) % MAX_SENSORS)
+    {
+        if (slots_[index].address == address)
+        {
+            return &slots_[index];
+        }
+    }
+
+    return nullptr;
+}
+
+void GoveeAdvertisementDecoder::publish(Slot& slot, const GoveeReading& reading)
+{
+    const bool changed = !slot.published || (reading.temperature != slot.reading.temperature)
+                         || (reading.humidity != slot.reading.humidity) || (reading.battery != slot.reading.battery);
+
+    if ((history_ != nullptr) && changed)
+    {
+        const int16_t values[]{ reading.temperature, static_cast<int16_t>(reading.humidity), static_cast<int16_t>(reading.battery) };
+        history_->Add(static_cast<uint32_t>(::time(nullptr)), slot.number, values);
+    }
+
+    if ((slot.temperature != nullptr) && (!slot.published || (reading.temperature != slot.reading.temperature)))
+    {
+        slot.temperature->publish_state(static_cast<float>(reading.temperature) / 10.0f);
+    }
+
+    if ((slot.humidity != nullptr) && (!slot.published || (reading.humidity != slot.reading.humidity)))
+    {
+        slot.humidity->publish_state(static_cast<float>(reading.humidity) / 10.0f);
+    }
+
+    if ((slot.battery != nullptr) && (!slot.published || (reading.battery != slot.reading.battery)))
+    {
+        slot.battery->publish_state(static_cast<float>(reading.battery));
+    }
+
+    slot.reading   = reading;
+    slot.published = true;
+}
+
+void GoveeAdvertisementDecoder::aggregate(Slot& slot, const GoveeReading& reading)
+{
+    // the battery level is not aggregated, the other values keep their published state till the end of the window
+    GoveeReading immediate = slot.reading;
+    immediate.battery      = reading.battery;
+
+    slot.temperature_window.Add(reading.temperature);
+    slot.humidity_window.Add(static_cast<int16_t>(reading.humidity));
+
+    // the first reading and a jump are published at once and start a new window
+    if (!slot.published || (abs(reading.temperature - slot.reading.temperature) >= temperature_delta_))
+    {
+        immediate.temperature = reading.temperature;
+        slot.temperature_window.Clear();
+    }
+
+    if (!slot.published || (abs(reading.humidity - slot.reading.humidity) >= humidity_delta_))
+    {
+        immediate.humidity = reading.humidity;
+        slot.humidity_window.Clear();
+    }
+
+    publish(slot, immediate);
+}
+
+void GoveeAdvertisementDecoder::publish_windows()
+{
+    for (Slot& slot : slots_)
+    {
+        if ((slot.address == 0u) || !slot.published)
+        {
+            continue;
+        }
+
+        GoveeReading summary = slot.reading;
+
+        if (slot.temperature_window.Count() > 0u)
+        {
+            summary.temperature = slot.temperature_window.Mean();
+            ESP_LOGD("govee", "%012llX: %u temperatures, min %.1f, max %.1f, mean %.1f", static_cast<unsigned long long>(slot.address),
+                     static_cast<unsigned>(slot.temperature_window.Count()), static_cast<float>(slot.temperature_window.Min()) / 10.0f,
+                     static_cast<float>(slot.temperature_window.Max()) / 10.0f, static_cast<float>(summary.temperature) / 10.0f);
+            slot.temperature_window.Clear();
+        }
+
+        if (slot.humidity_window.Count() > 0u)
+        {
+            summary.humidity = static_cast<uint16_t>(slot.humidity_window.Mean());
+            slot.humidity_window.Clear();
+        }
+
+        publish(slot, summary);
+    }
+}
+
+#endif
@@ -1,13 +1,41 @@
-
 #ifndef ESPHOME_CLIMATE_HONEYWELL_ADAPTER_H
 #define ESPHOME_CLIMATE_HONEYWELL_ADAPTER_H
 
-// #include "HoneywellManager_HR20_V1.h"
-#include "HoneywellManager_OpenHR20.h"
+#include "HoneywellBackendTraits.h"
+#include "HoneywellStatistics.h"
 #include "IHoneywellManager.h"
 #include "esphome.h"
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+/**
+ * @brief Records the readings in a history, defined in HoneywellHistory.h.
+ */
+template <typename History>
+class HoneywellHistoryRecorder;
+
+/**
+ * @brief Without a history nothing is recorded, the adapter compiles the recording away.
+ */
+template <>
+class HoneywellHistoryRecorder<void>
+{
+};
 
-/// ESPHome Custom Climate Adapter to control a Honeywell HR20 rondostat
+/**
+ * ESPHome Custom Climate Adapter to control a Honeywell HR20 rondostat.
+ * The backend is selected in the YAML, e.g. EsphomeClimateHoneywellAdapter<HoneywellManager_OpenHR20>.
+ * The YAML includes the header of the backend, the adapter only knows the interface and the traits of the backends.
+ * The last confirmed state (mode, target temperature, detected protocol and learned polling interval) is kept in the flash:
+ * after a reboot it is published at once and reconciled with the thermostat in the background.
+ * With HoneywellManager_AutoDetect the protocol is detected at runtime, the cached one skips the probing after a reboot.
+ * With HoneywellIoTask<...> the UART communication runs on its own task on the second core of an ESP32.
+ * Features which are not supported by the backend (see HoneywellBackendTraits) are compiled away.
+ * The history is only compiled in with the second template argument, e.g. <HoneywellManager_AutoDetect, HoneywellHistory>.
+ */
+template <typename Backend, typename History = void, typename Traits = HoneywellBackendTraits<Backend>>
 class EsphomeClimateHoneywellAdapter : public PollingComponent, public Climate
 {
 public:
@@ -15,19 +43,178 @@ public:
 
     /// custom c'tor
     explicit EsphomeClimateHoneywellAdapter(UARTComponent* parent_component)
-        : PollingComponent(10 * 60 * 1000)
+        : PollingComponent(FAST_UPDATE_INTERVAL_MS)
         , honeywell_manager_(parent_component)
-    //, temp_sensor_ptr_(temp_sensor_ptr)
     {
     }
 
+#ifdef USE_SENSOR
+    /// custom c'tor, the external sensor provides the current temperature
+    EsphomeClimateHoneywellAdapter(UARTComponent* parent_component, sensor::Sensor* temp_sensor_ptr)
+        : EsphomeClimateHoneywellAdapter(parent_component)
+    {
+        temp_sensor_ptr_ = temp_sensor_ptr;
+    }
+#endif
+
     void setup() override
     {
         // This will be called by App.setup()
+        if (!on_bus_)
+        {
+            honeywell_manager_.SetLoopBudget(loop_budget_ms_);
+        }
+
+        publish_availability();
+
+        // the last confirmed state is shown at once, the thermostat is read soon after in the background
+        state_preference_ = global_preferences->make_preference<PersistedState>(this->get_object_id_hash() ^ STATE_PREFERENCE_KEY, true);
+        restore_state();
+
+        if constexpr (HAS_HISTORY)
+        {
+            history_.Setup(this->get_name());
+        }
+
+        if (statistics_interval_ms_ > 0u)
+        {
+            this->set_interval("statistics", statistics_interval_ms_, [this]() {
+                log_statistics();
+                publish_statistics();
+            });
+        }
+
+        if constexpr (Traits::DETECTS_BACKEND)
+        {
+            // skip the probing, if the protocol was already detected before the reboot
+            if (saved_state_.backend != static_cast<uint8_t>(HoneywellBackendType::E_UNKNOWN))
+            {
+                honeywell_manager_.SetBackendHint(static_cast<HoneywellBackendType>(saved_state_.backend));
+            }
+
+            // only called if the detected protocol differs from the cached one
+            honeywell_manager_.SetDetectionObserver([this](HoneywellBackendType backend) {
+                detected_backend_ = static_cast<uint8_t>(backend);
+                save_state();
+            });
+        }
+
+        if constexpr (Traits::SUPPORTS_STATUS_LINES)
+        {
+            if (passive_listening_)
+            {
+                // the thermostat reports its status on its own, the polling is only a fallback if no status line was received
+                honeywell_manager_.SetStatusObserver([this](ErrorCode error_code, const auto& snapshot) {
+                    if (ErrorCode::E_OK == error_code)
+                    {
+                        apply_status_snapshot(snapshot);
+                    }
+                });
+                honeywell_manager_.SetListenMode(true);
+            }
+        }
+    }
+
+    /// @brief Enable or disable the passive listening for unsolicited status lines (default: enabled), must be called before setup().
+    void set_passive_listening(bool passive_listening) { passive_listening_ = passive_listening; }
+
+    /// @brief Time without a new target temperature, till it is written to the thermostat (default: 1.5 s). 0 = write immediately.
+    void set_write_settle_time(uint32_t write_settle_time_ms) { write_settle_time_ms_ = write_settle_time_ms; }
+
+    /// @brief Polling interval while the state changes (default: 15 s) and the ceiling of the backoff, if nothing changes (default: 10 min).
+    void set_update_intervals(uint32_t fast_update_interval_ms, uint32_t max_update_interval_ms)
+    {
+        fast_update_interval_ms_ = fast_update_interval_ms;
+        max_update_interval_ms_  = (max_update_interval_ms > fast_update_interval_ms) ? max_update_interval_ms : fast_update_interval_ms;
+        this->set_update_interval(fast_update_interval_ms_);
+    }
+
+    /// @brief Max time, which the UART communication may block one loop() call (default: 20 ms), must be called before setup().
+    void set_loop_budget(uint32_t loop_budget_ms) { loop_budget_ms_ = loop_budget_ms; }
+
+    /// @brief Backoff of repeated requests and circuit breaker of the thermostat, must be called before setup().
+    void set_retry_policy(const RetryPolicy& retry_policy) { honeywell_manager_.SetRetryPolicy(retry_policy); }
+
+    /// @brief Max time without publishing the state, even if nothing changed (default: 30 min), 0 = only changes are published.
+    void set_refresh_interval(uint32_t refresh_interval_ms) { refresh_interval_ms_ = refresh_interval_ms; }
+
+    /**
+     * @brief Record the readings in a history, which is sent to Home Assistant after the API was disconnected.
+     *        Must be called before setup(), the history may be placed in RTC memory (see DeltaHistory).
+     *
+     * @param history The history, nullptr = no history.
+     * @param history_interval_ms Min time between two samples, a sample is only recorded if a value changed.
+     */
+    void set_history(History* history, uint32_t history_interval_ms)
+    {
+        static_assert(HAS_HISTORY, "the history is enabled with the template argument, e.g. <HoneywellManager_OpenHR20, HoneywellHistory>");
+        history_.Set(history, history_interval_ms);
+    }
+
+    /// @brief Interval of the statistics log summary and of the statistics sensors (default: 10 min), 0 = off. Must be called before setup().
+    void set_statistics_interval(uint32_t statistics_interval_ms) { statistics_interval_ms_ = statistics_interval_ms; }
+
+#ifdef USE_SENSOR
+    /// @brief Optional diagnostic sensor for one value of the statistics, published in the statistics interval.
+    void set_statistics_sensor(HoneywellStatisticsSensor value, sensor::Sensor* statistics_sensor)
+    {
+        if (value < HoneywellStatisticsSensor::E_COUNT)
+        {
+            statistics_sensors_[static_cast<size_t>(value)] = statistics_sensor;
+        }
+    }
+#endif
+
+#ifdef USE_BINARY_SENSOR
+    /// @brief Optional binary sensor, which is on while the thermostat responds (e.g. a template binary sensor with device_class connectivity).
+    void set_availability_sensor(binary_sensor::BinarySensor* availability_sensor) { availability_sensor_ = availability_sensor; }
+#endif
+
+    /**
+     * @brief Let the bus advance the UART communication interleaved with other thermostats, instead of loop().
+     *        The loop budget of the bus is used. Must be called before setup().
+     *
+     * @return false if the bus is full, loop() advances the communication then.
+     */
+    template <typename Bus>
+    bool set_bus(Bus* bus)
+    {
+        if ((bus == nullptr) || (ErrorCode::E_OK != bus->AddManager(honeywell_manager_)))
+        {
+            return false;
+        }
+
+        on_bus_ = true;
+        return true;
+    }
+
+    void loop() override
+    {
+        const uint32_t start = micros();
+
+        // advance the UART communication without blocking, the results are reported with the callbacks
+        if (!on_bus_)
+        {
+            honeywell_manager_.Loop();
+        }
+
+        if (honeywell_manager_.IsAvailable() != available_)
+        {
+            available_ = !available_;
+            publish_availability();
+        }
+
+        if constexpr (HAS_HISTORY)
+        {
+            history_.Loop();
+        }
+
+        loop_blocking_us_.Add(micros() - start);
     }
 
     void control(const ClimateCall& call) override
     {
+        const uint32_t start                            = micros();
         esphome::optional<float> target_temperature_opt = call.get_target_temperature();
 
         if (call.get_mode().has_value())
@@ -49,15 +236,26 @@ public:
 
         set_current_temperature_from_external_sensor();
 
-        // update all states for the Home Assistant GUI
-        this->publish_state();
+        // the valve will move after a command, so the next poll comes soon
+        adapt_update_interval(true);
+
+        // update the changed states for the Home Assistant GUI, the results of the thermostat commands are published by the callbacks
+        publish_if_changed();
+
+        control_blocking_us_.Add(micros() - start);
+    }
+
+    void dump_config() override
+    {
+        ESP_LOGCONFIG("honeywell", "Honeywell HR20 climate:");
+        log_statistics();
     }
 
     ClimateTraits traits() override
     {
         // The capabilities of the climate device
         auto traits = climate::ClimateTraits();
-        traits.set_supports_current_temperature(true);
+        traits.set_supports_current_temperature(Traits::SUPPORTS_CURRENT_TEMPERATURE || has_external_temperature_sensor());
         traits.set_supported_modes({ climate::CLIMATE_MODE_AUTO, climate::CLIMATE_MODE_HEAT, climate::CLIMATE_MODE_OFF });
         traits.set_visual_min_temperature(8.0);
         traits.set_visual_max_temperature(28.0);
@@ -68,43 +266,178 @@ public:
 
     void update() override
     {
+        const uint32_t start = micros();
+
         set_current_temperature_from_external_sensor();
 
-        int desiredTemperature = 0;
-        if (ErrorCode::E_OK == honeywell_manager_.GetDesiredTemperature(desiredTemperature))
+        if constexpr (Traits::SUPPORTS_STATUS_LINES)
         {
-            this->target_temperature = static_cast<float>(desiredTemperature) / 10.0;
-
-            // if the temperature is below 20° Celcius, get the current mode
-            if (this->target_temperature > 20.0)
+            if (honeywell_manager_.IsListenMode())
             {
-                this->mode = ClimateMode::CLIMATE_MODE_HEAT;
+                // only poll if no status line was received within the update interval, the observer publishes the result
+                honeywell_manager_.GetStatusSnapshotAsync([](ErrorCode, const auto&) {},
+                                                          this->get_update_interval());
+                update_blocking_us_.Add(micros() - start);
+                return;
             }
-            else
+
+            // without passive listening the status line is requested, it also reports room temperature, valve and battery
+            if (reports_status_lines())
             {
-                Mode mode{ Mode::E_INVALID };
-                if (ErrorCode::E_OK == honeywell_manager_.GetMode(mode))
+                const ErrorCode error_code = honeywell_manager_.GetStatusSnapshotAsync(
+                    [this](ErrorCode result, const auto& snapshot) {
+                        if (ErrorCode::E_OK == result)
+                        {
+                            apply_status_snapshot(snapshot);
+                        }
+                    },
+                    STATUS_SNAPSHOT_MAX_AGE_MS);
+
+                // otherwise (e.g. while the protocol is probed) the state is read like from HR20_V1
+                if (ErrorCode::E_OK == error_code)
                 {
-                    if (mode == Mode::E_AUTOMATIC)
-                    {
-                        this->mode = ClimateMode::CLIMATE_MODE_AUTO;
-                    }
-                    else if (mode == Mode::E_MANUAL)
-                    {
-                        this->mode = ClimateMode::CLIMATE_MODE_OFF;
-                    }
+                    update_blocking_us_.Add(micros() - start);
+                    return;
                 }
             }
         }
 
-        this->publish_state();
+        // desired temperature and mode are read in one session, so the thermostat is woken up only once
+        honeywell_manager_.GetStateAsync([this](ErrorCode error_code, int desiredTemperature, Mode mode) {
+            if (ErrorCode::E_OK == error_code)
+            {
+                adapt_update_interval(apply_state(desiredTemperature, mode));
+                record_history(INT16_MIN, INT16_MIN);
+            }
+        });
+
+        update_blocking_us_.Add(micros() - start);
+    }
+
+    /// @return true if the thermostat answers with status lines, i.e. the OpenHR20 firmware is used or was detected.
+    bool reports_status_lines() const
+    {
+        if constexpr (Traits::DETECTS_BACKEND)
+        {
+            return detected_backend_ == static_cast<uint8_t>(HoneywellBackendType::E_OPEN_HR20);
+        }
+        else
+        {
+            return Traits::SUPPORTS_STATUS_LINES;
+        }
+    }
+
+    template <typename Snapshot>
+    void apply_status_snapshot(const Snapshot& snapshot)
+    {
+        // the valve is moving or the room temperature is changing, the first reading only counts by its state (apply_state())
+        bool changed = last_current_temperature_.has_value() && (*last_current_temperature_ != snapshot.currentTemperature);
+
+        if constexpr (Traits::SUPPORTS_VALVE_POSITION)
+        {
+            changed              = changed || (last_valve_position_.has_value() && (*last_valve_position_ != snapshot.valvePosition));
+            last_valve_position_ = snapshot.valvePosition;
+        }
+
+        last_current_temperature_ = snapshot.currentTemperature;
+
+        // an external sensor is preferred
+        if (!has_external_temperature_sensor())
+        {
+            this->current_temperature = static_cast<float>(snapshot.currentTemperature) / 10.0;
+        }
+
+        const bool state_changed = apply_state(snapshot.desiredTemperature, snapshot.mode);
+
+        adapt_update_interval(changed || state_changed);
+        record_history(static_cast<int16_t>(snapshot.valvePosition), static_cast<int16_t>(snapshot.batteryVoltage));
+    }
+
+    /// @return true if the desired temperature or the mode of the thermostat changed since the last reading.
+    bool apply_state(int desiredTemperature, Mode mode)
+    {
+        const bool first_reading = !confirmed_target_temperature_.has_value();
+        bool changed             = first_reading || (*confirmed_target_temperature_ != desiredTemperature) || (last_mode_ != mode);
+
+        confirmed_target_temperature_ = desiredTemperature;
+        last_mode_                    = mode;
+
+        // a target temperature which is not written or not confirmed yet shall not jump back in the GUI
+        if (pending_target_temperature_.has_value())
+        {
+            this->target_temperature = static_cast<float>(*pending_target_temperature_) / 10.0;
+        }
+        else if (inflight_target_temperature_.has_value())
+        {
+            this->target_temperature = static_cast<float>(*inflight_target_temperature_) / 10.0;
+        }
+        else
+        {
+            this->target_temperature = static_cast<float>(desiredTemperature) / 10.0;
+        }
+
+        // above 20° Celcius it is heating, otherwise the mode of the thermostat decides
+        if (this->target_temperature > 20.0)
+        {
+            this->mode = ClimateMode::CLIMATE_MODE_HEAT;
+        }
+        else if (mode == Mode::E_AUTOMATIC)
+        {
+            this->mode = ClimateMode::CLIMATE_MODE_AUTO;
+        }
+        else if (mode == Mode::E_MANUAL)
+        {
+            this->mode = ClimateMode::CLIMATE_MODE_OFF;
+        }
+
+        // the first reading after a reboot is compared with the restored state
+        if (first_reading && state_restored_)
+        {
+            changed = (desiredTemperature != saved_state_.target_temperature) || (static_cast<uint8_t>(this->mode) != saved_state_.mode);
+        }
+
+        publish_if_changed();
+        save_state();
+
+        return changed;
+    }
+
+    /**
+     * @brief Poll fast while the state changes, otherwise double the interval up to the ceiling.
+     *
+     * @param changed true if a command was sent or a reading changed.
+     */
+    void adapt_update_interval(bool changed)
+    {
+        uint32_t interval = fast_update_interval_ms_;
+
+        if (!changed && (resume_update_interval_ms_ > 0u))
+        {
+            // nothing changed during the reboot, continue with the interval learned before
+            interval = resume_update_interval_ms_;
+        }
+        else if (!changed)
+        {
+            const uint32_t current = this->get_update_interval();
+            interval               = ((current * 2u) < max_update_interval_ms_) ? (current * 2u) : max_update_interval_ms_;
+        }
+
+        resume_update_interval_ms_ = 0u;
+
+        if (interval != this->get_update_interval())
+        {
+            // restart the poller, so the new interval is used from now on
+            this->set_update_interval(interval);
+            this->start_poller();
+            save_state();
+        }
     }
 
     void set_current_temperature_from_external_sensor()
     {
         // if an external temperature sensor is given, receive it's value and set if for this climate instance
         // Current temperature format from HR20_V1 is unknown from an A/D converter --> receive current temperature from external sensor.
-        /*
+#ifdef USE_SENSOR
         if (temp_sensor_ptr_ != nullptr)
         {
             if (temp_sensor_ptr_->has_state())
@@ -112,44 +445,262 @@ public:
                 this->current_temperature = temp_sensor_ptr_->get_state();
             }
         }
-        */
+#endif
+    }
+
+    bool has_external_temperature_sensor() const
+    {
+#ifdef USE_SENSOR
+        return temp_sensor_ptr_ != nullptr;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Publish the state, if mode, target or current temperature differ from the last published state (in steps of 0.1 °C),
+     *        or if the refresh interval is over. Every poll would cause an API state frame and a recorder write in Home Assistant.
+     */
+    void publish_if_changed()
+    {
+        const PublishedState state{ static_cast<uint8_t>(this->mode), to_tenths(this->target_temperature),
+                                    to_tenths(this->current_temperature) };
+        const uint32_t now = millis();
+        const bool refresh = (refresh_interval_ms_ > 0u) && ((now - last_publish_ms_) >= refresh_interval_ms_);
+
+        if (has_published_ && !refresh && (state.mode == published_state_.mode)
+            && (state.target_temperature == published_state_.target_temperature)
+            && (state.current_temperature == published_state_.current_temperature))
+        {
+            ++suppressed_publishes_;
+            return;
+        }
+
+        published_state_ = state;
+        has_published_   = true;
+        last_publish_ms_ = now;
+        ++publishes_;
+        this->publish_state();
+    }
+
+    /**
+     * @brief Record the published temperatures and the given readings in the history, if a value changed
+     *        and the history interval is over.
+     *
+     * @param valve_position Valve position in %, INT16_MIN if the backend does not report it.
+     * @param battery_voltage Battery voltage in mV, INT16_MIN if the backend does not report it.
+     */
+    void record_history(int16_t valve_position, int16_t battery_voltage)
+    {
+        if constexpr (HAS_HISTORY)
+        {
+            const int16_t values[]{ to_tenths(this->target_temperature), to_tenths(this->current_temperature), valve_position,
+                                    battery_voltage };
+            history_.Record(values);
+        }
+    }
+
+    /**
+     * @brief Publish the state saved before the reboot, before the thermostat is read.
+     *        The learned polling interval is used for the first reading, so a quiet thermostat is not queried at once.
+     */
+    void restore_state()
+    {
+        PersistedState state;
+
+        if (!state_preference_.load(&state))
+        {
+            return;
+        }
+
+        saved_state_      = state;
+        detected_backend_ = state.backend;
+
+        const ClimateMode mode = static_cast<ClimateMode>(state.mode);
+        const bool valid_mode  = (mode == ClimateMode::CLIMATE_MODE_AUTO) || (mode == ClimateMode::CLIMATE_MODE_HEAT)
+                                || (mode == ClimateMode::CLIMATE_MODE_OFF);
+
+        if (valid_mode && (state.target_temperature >= RESTORED_TEMPERATURE_MIN) && (state.target_temperature <= RESTORED_TEMPERATURE_MAX))
+        {
+            this->mode               = mode;
+            this->target_temperature = static_cast<float>(state.target_temperature) / 10.0f;
+            state_restored_          = true;
+            publish_if_changed();
+        }
+
+        // the first poll reconciles the restored state soon, the learned interval is resumed after it
+        if ((state.update_interval_ms >= fast_update_interval_ms_) && (state.update_interval_ms <= max_update_interval_ms_))
+        {
+            resume_update_interval_ms_ = state.update_interval_ms;
+        }
+
+        ESP_LOGI("honeywell", "'%s' restored: mode %u, target %.1f °C, backend %u, update interval %u ms", this->get_name().c_str(),
+                 static_cast<unsigned>(state.mode), static_cast<float>(state.target_temperature) / 10.0f,
+                 static_cast<unsigned>(state.backend), static_cast<unsigned>(state.update_interval_ms));
+    }
+
+    /**
+     * @brief Save the confirmed state, if it differs from the saved one. A changed polling interval alone is saved
+     *        at most once per STATE_SAVE_INTERVAL_MS, because the backoff changes it with every reading.
+     */
+    void save_state()
+    {
+        PersistedState state = saved_state_;
+        const uint32_t now   = millis();
+
+        state.backend            = detected_backend_;
+        state.update_interval_ms = (resume_update_interval_ms_ > 0u) ? resume_update_interval_ms_ : this->get_update_interval();
+
+        // a target temperature is only saved, if it was read from or confirmed by the thermostat
+        if (confirmed_target_temperature_.has_value())
+        {
+            state.mode               = static_cast<uint8_t>(this->mode);
+            state.target_temperature = static_cast<int16_t>(*confirmed_target_temperature_);
+        }
+
+        const bool changed = (state.backend != saved_state_.backend) || (state.mode != saved_state_.mode)
+                             || (state.target_temperature != saved_state_.target_temperature);
+        const bool interval_changed = (state.update_interval_ms != saved_state_.update_interval_ms);
+
+        if (!changed && (!interval_changed || ((now - last_state_save_ms_) < STATE_SAVE_INTERVAL_MS)))
+        {
+            return;
+        }
+
+        // the preferences only write the flash from time to time, the NVS of the ESP32 spreads the writes
+        if (state_preference_.save(&state))
+        {
+            saved_state_        = state;
+            last_state_save_ms_ = now;
+            ++state_saves_;
+        }
+    }
+
+    /// @brief Temperature in 1/10 °C, INT16_MIN if it is unknown (NAN)
+    static int16_t to_tenths(float temperature)
+    {
+        return std::isnan(temperature) ? INT16_MIN : static_cast<int16_t>(lroundf(temperature * 10.0f));
+    }
+
+    /**
+     * @brief Log a compact summary of the UART statistics and of the blocking time of the main loop.
+     */
+    void log_statistics()
+    {
+        HoneywellStatistics statistics;
+        honeywell_manager_.GetStatistics(statistics);
+
+        ESP_LOGI("honeywell", "Statistics of '%s':", this->get_name().c_str());
+        statistics.Log();
+        loop_blocking_us_.Log("loop() us");
+        update_blocking_us_.Log("update() us");
+        control_blocking_us_.Log("control() us");
+        ESP_LOGI("honeywell", "  state publishes: %u, suppressed: %u, saved: %u%s", static_cast<unsigned>(publishes_),
+                 static_cast<unsigned>(suppressed_publishes_), static_cast<unsigned>(state_saves_),
+                 state_restored_ ? " (restored after reboot)" : "");
+
+        if constexpr (HAS_HISTORY)
+        {
+            history_.Log();
+        }
+    }
+
+    /**
+     * @brief Publish the statistics to the diagnostic sensors.
+     */
+    void publish_statistics()
+    {
+#ifdef USE_SENSOR
+        HoneywellStatistics statistics;
+        honeywell_manager_.GetStatistics(statistics);
+
+        uint32_t max_blocking_us = loop_blocking_us_.Max();
+        max_blocking_us          = (update_blocking_us_.Max() > max_blocking_us) ? update_blocking_us_.Max() : max_blocking_us;
+        max_blocking_us          = (control_blocking_us_.Max() > max_blocking_us) ? control_blocking_us_.Max() : max_blocking_us;
+
+        const float values[static_cast<size_t>(HoneywellStatisticsSensor::E_COUNT)]{
+            static_cast<float>(statistics.Transactions()),   static_cast<float>(statistics.retries),
+            static_cast<float>(statistics.timeouts),         static_cast<float>(statistics.wrongResponses),
+            static_cast<float>(statistics.discardedBytes),   static_cast<float>(max_blocking_us) / 1000.0f,
+            static_cast<float>(suppressed_publishes_),
+        };
+
+        for (size_t i = 0; i < static_cast<size_t>(HoneywellStatisticsSensor::E_COUNT); ++i)
+        {
+            if (statistics_sensors_[i] != nullptr)
+            {
+                statistics_sensors_[i]->publish_state(values[i]);
+            }
+        }
+#endif
+    }
+
+    void publish_availability()
+    {
+        // ESPHome has no availability per entity, the component shows a warning and the optional binary sensor is off
+        if (available_)
+        {
+            ESP_LOGI("honeywell", "Thermostat is available");
+            this->status_clear_warning();
+        }
+        else
+        {
+            ESP_LOGW("honeywell", "Thermostat does not respond, it is probed only from time to time");
+            this->status_set_warning();
+        }
+
+#ifdef USE_BINARY_SENSOR
+        if (availability_sensor_ != nullptr)
+        {
+            availability_sensor_->publish_state(available_);
+        }
+#endif
     }
 
     esphome::optional<float> set_mode(ClimateMode mode)
     {
-        ErrorCode error_code = ErrorCode::E_NOT_OK;
         esphome::optional<float> target_temperature_opt;
 
-        // Send mode to hardware
+        // Send mode to hardware. The mode is only published, if the thermostat confirmed it and mode is supported
         if (mode == ClimateMode::CLIMATE_MODE_OFF)
         {
-            error_code = honeywell_manager_.SetMode(Mode::E_MANUAL);
+            honeywell_manager_.SetModeAsync(Mode::E_MANUAL, [this, mode](ErrorCode error_code) {
+                if (ErrorCode::E_OK == error_code)
+                {
+                    this->mode = mode;
+                    publish_if_changed();
+                    save_state();
+                }
+            });
         }
         else if (mode == ClimateMode::CLIMATE_MODE_HEAT)
         {
-            error_code             = ErrorCode::E_OK;
+            this->mode             = mode;
             target_temperature_opt = esphome::optional<float>(22.0);
         }
         else if (mode == ClimateMode::CLIMATE_MODE_AUTO)
         {
-            error_code = honeywell_manager_.SetMode(Mode::E_AUTOMATIC);
+            honeywell_manager_.SetModeAsync(Mode::E_AUTOMATIC, [this, mode](ErrorCode error_code) {
+                if (ErrorCode::E_OK == error_code)
+                {
+                    this->mode = mode;
+                    publish_if_changed();
+                    save_state();
+                }
+            });
 
-            int desiredTemperature = 0;
-            if (ErrorCode::E_OK == honeywell_manager_.GetDesiredTemperature(desiredTemperature))
-            {
-                this->target_temperature = static_cast<float>(desiredTemperature) / 10.0;
-            }
+            // the heating programm defines the desired temperature
+            honeywell_manager_.GetDesiredTemperatureAsync([this](ErrorCode error_code, int desiredTemperature) {
+                if (ErrorCode::E_OK == error_code)
+                {
+                    this->target_temperature = static_cast<float>(desiredTemperature) / 10.0;
+                    publish_if_changed();
+                }
+            });
         }
         else
         {
             // not supported modes
-            error_code = ErrorCode::E_NOT_OK;
-        }
-
-        // Publish updated state only if no error occured and mode is supported
-        if (ErrorCode::E_OK == error_code)
-        {
-            this->mode = mode;
         }
 
         return target_temperature_opt;
@@ -157,21 +708,211 @@ public:
 
     void set_target_temperature(float target_temperature)
     {
-        const int expected_temperature = static_cast<int>(target_temperature * 10.0);
-        ErrorCode error_code           = honeywell_manager_.SetDesiredTemperature(expected_temperature);
+        // e.g. dragging the slider calls control() for every value: only the latest one is written after the settle time
+        pending_target_temperature_ = static_cast<int>(target_temperature * 10.0);
+
+        if (write_settle_time_ms_ == 0u)
+        {
+            write_target_temperature();
+        }
+        else
+        {
+            // a new call with the same name replaces the pending timeout
+            this->set_timeout("write_target_temperature", write_settle_time_ms_, [this]() { write_target_temperature(); });
+        }
+    }
+
+    void write_target_temperature()
+    {
+        if (!pending_target_temperature_.has_value())
+        {
+            return;
+        }
+
+        const int expected_temperature = *pending_target_temperature_;
+        pending_target_temperature_.reset();
 
-        // only if setting the temeperature was successful, update the target temperature for the GUI
-        if (ErrorCode::E_OK == error_code)
+        // nothing to write, if the thermostat already confirmed this temperature and no other one is on the way
+        if (confirmed_target_temperature_.has_value() && (*confirmed_target_temperature_ == expected_temperature)
+            && !inflight_target_temperature_.has_value())
         {
-            this->target_temperature = target_temperature;
+            this->target_temperature = static_cast<float>(expected_temperature) / 10.0;
+            publish_if_changed();
+            return;
+        }
+
+        // the thermostat confirms the write after the reconciliation, till then a reading shall not reset the GUI
+        inflight_target_temperature_ = expected_temperature;
+
+        // only if the thermostat confirmed the temeperature, update the target temperature for the GUI
+        const ErrorCode queue_result = honeywell_manager_.SetDesiredTemperatureAsync(
+            expected_temperature, [this, expected_temperature](ErrorCode error_code) {
+                // an older write, which was replaced or is confirmed before the latest one, does not change the GUI
+                const bool latest = inflight_target_temperature_.has_value() && (*inflight_target_temperature_ == expected_temperature);
+
+                if (latest)
+                {
+                    inflight_target_temperature_.reset();
+                }
+
+                if (ErrorCode::E_OK == error_code)
+                {
+                    confirmed_target_temperature_ = expected_temperature;
+
+                    if (latest && !pending_target_temperature_.has_value())
+                    {
+                        this->target_temperature = static_cast<float>(expected_temperature) / 10.0;
+                        publish_if_changed();
+                    }
+
+                    save_state();
+                }
+            });
+
+        // the callback will not be called
+        if (ErrorCode::E_OK != queue_result)
+        {
+            inflight_target_temperature_.reset();
         }
     }
 
     /// @brief Honeywell Manager instance
-    HoneywellManager_OpenHR20 honeywell_manager_;
+    Backend honeywell_manager_;
 
+#ifdef USE_SENSOR
     /// @brief Pointer to an external temperature sensor to set the current temperature
-    // sensor::Sensor* temp_sensor_ptr_;
+    sensor::Sensor* temp_sensor_ptr_{ nullptr };
+#endif
+
+#ifdef USE_BINARY_SENSOR
+    /// @brief Pointer to an optional binary sensor, which shows if the thermostat responds
+    binary_sensor::BinarySensor* availability_sensor_{ nullptr };
+#endif
+
+    /// @brief Last published availability of the thermostat
+    bool available_{ true };
+
+    /// @brief Interval of the statistics log summary and sensors, 0 = off
+    uint32_t statistics_interval_ms_{ 10 * 60 * 1000 };
+
+#ifdef USE_SENSOR
+    /// @brief Optional diagnostic sensors, see HoneywellStatisticsSensor
+    sensor::Sensor* statistics_sensors_[static_cast<size_t>(HoneywellStatisticsSensor::E_COUNT)]{};
+#endif
+
+    /// @brief Blocking time of the main loop by loop(), update() and control() in µs
+    HoneywellHistogram loop_blocking_us_{ 64u };
+    HoneywellHistogram update_blocking_us_{ 64u };
+    HoneywellHistogram control_blocking_us_{ 64u };
+
+    /// @brief A bus advances the UART communication, otherwise loop() does it
+    bool on_bus_{ false };
+
+    /// @brief Parse the unsolicited status lines of the thermostat, the polling is only a fallback
+    bool passive_listening_{ true };
+
+    /// @brief Time without a new target temperature, till it is written to the thermostat
+    uint32_t write_settle_time_ms_{ 1500 };
+
+    /// @brief Max age of a received status line, which is used instead of requesting a new one (like HoneywellManager_OpenHR20)
+    static constexpr uint32_t STATUS_SNAPSHOT_MAX_AGE_MS{ 2000 };
+
+    /// @brief Default polling interval while the state changes
+    static constexpr uint32_t FAST_UPDATE_INTERVAL_MS{ 15 * 1000 };
+
+    /// @brief Polling interval while the state changes and the ceiling of the backoff
+    uint32_t fast_update_interval_ms_{ FAST_UPDATE_INTERVAL_MS };
+    uint32_t max_update_interval_ms_{ 10 * 60 * 1000 };
+
+    /// @brief Max time, which the UART communication may block one loop() call
+    uint32_t loop_budget_ms_{ 20 };
+
+    /// @brief Key of the saved state in the flash, combined with the hash of the climate name
+    static constexpr uint32_t STATE_PREFERENCE_KEY{ 0x48523231 };
+
+    /// @brief Min time between two saves, if only the polling interval changed
+    static constexpr uint32_t STATE_SAVE_INTERVAL_MS{ 60 * 60 * 1000 };
+
+    /// @brief Range of a restored target temperature in 1/10 °C, other values are not restored
+    static constexpr int16_t RESTORED_TEMPERATURE_MIN{ 40 };
+    static constexpr int16_t RESTORED_TEMPERATURE_MAX{ 300 };
+
+    /**
+     * @brief Last confirmed state, which is published at once after a reboot
+     */
+    struct PersistedState
+    {
+        /// @brief HoneywellBackendType, only used with HoneywellManager_AutoDetect
+        uint8_t backend{ 0 };
+
+        /// @brief ClimateMode
+        uint8_t mode{ 0 };
+
+        /// @brief Target temperature in 1/10 °C, INT16_MIN if unknown
+        int16_t target_temperature{ INT16_MIN };
+
+        /// @brief Learned polling interval
+        uint32_t update_interval_ms{ 0 };
+    };
+
+    ESPPreferenceObject state_preference_;
+    PersistedState saved_state_;
+
+    /// @brief Detected backend, only used with HoneywellManager_AutoDetect
+    uint8_t detected_backend_{ 0 };
+
+    /// @brief Time and number of saves of the state, true if a state was restored after the reboot
+    uint32_t last_state_save_ms_{ 0 };
+    uint32_t state_saves_{ 0 };
+    bool state_restored_{ false };
+
+    /// @brief Polling interval learned before the reboot, used after the first reading if nothing changed meanwhile. 0 = none
+    uint32_t resume_update_interval_ms_{ 0 };
+
+    /**
+     * @brief Compact copy of the last published state
+     */
+    struct PublishedState
+    {
+        uint8_t mode{ 0 };
+
+        /// @brief Temperatures in 1/10 °C, INT16_MIN if unknown
+        int16_t target_temperature{ INT16_MIN };
+        int16_t current_temperature{ INT16_MIN };
+    };
+
+    PublishedState published_state_;
+    bool has_published_{ false };
+
+    /// @brief Time of the last published state
+    uint32_t last_publish_ms_{ 0 };
+
+    /// @brief Max time without publishing the state, 0 = only changes are published
+    uint32_t refresh_interval_ms_{ 30 * 60 * 1000 };
+
+    /// @brief Published and suppressed (unchanged) states since the start
+    uint32_t publishes_{ 0 };
+    uint32_t suppressed_publishes_{ 0 };
+
+    /// @brief The history is only recorded, if it is given as template argument
+    static constexpr bool HAS_HISTORY{ !std::is_void<History>::value };
+
+    /// @brief Records the readings in the history, empty without history
+    HoneywellHistoryRecorder<History> history_;
+
+    /// @brief Last readings, to detect changes
+    esphome::optional<int> last_valve_position_;
+    esphome::optional<int> last_current_temperature_;
+    Mode last_mode_{ Mode::E_INVALID };
+
+    /// @brief Target temperature (celsius with factor 10), which waits for the end of the settle time
+    esphome::optional<int> pending_target_temperature_;
+
+    /// @brief Target temperature (celsius with factor 10), which is written but not confirmed by the thermostat yet
+    esphome::optional<int> inflight_target_temperature_;
+
+    /// @brief Last target temperature (celsius with factor 10), which was read from or confirmed by the thermostat
+    esphome::optional<int> confirmed_target_temperature_;
 };
 
 #endif
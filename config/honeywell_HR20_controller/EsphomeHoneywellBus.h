@@ -0,0 +1,88 @@
+#ifndef ESPHOME_HONEYWELL_BUS_H
+#define ESPHOME_HONEYWELL_BUS_H
+
+#include "EsphomeClimateHoneywellAdapter.h"
+#include "HoneywellBus.h"
+#include "esphome.h"
+
+/**
+ * ESPHome Custom Component to control several Honeywell HR20 rondostats from one µC, e.g. one on each hardware UART of an ESP32.
+ * The UART communication of all thermostats is advanced interleaved within one loop() call,
+ * which is limited by one shared loop budget instead of one budget per thermostat.
+ */
+class EsphomeHoneywellBus : public Component
+{
+public:
+    /**
+     * @brief Create a climate adapter for a thermostat on the given UART, which is driven by this bus.
+     *        The adapter has to be registered and returned by the climate lambda as usual.
+     *
+     * @param parent_component UART of the thermostat, every thermostat needs its own UART.
+     */
+    template <typename Backend>
+    EsphomeClimateHoneywellAdapter<Backend>* add_thermostat(UARTComponent* parent_component)
+    {
+        auto adapter = new EsphomeClimateHoneywellAdapter<Backend>(parent_component);
+        attach(adapter);
+
+        return adapter;
+    }
+
+#ifdef USE_SENSOR
+    /**
+     * @brief Create a climate adapter for a thermostat on the given UART, which is driven by this bus.
+     *
+     * @param parent_component UART of the thermostat, every thermostat needs its own UART.
+     * @param temp_sensor_ptr External temperature sensor.
+     */
+    template <typename Backend>
+    EsphomeClimateHoneywellAdapter<Backend>* add_thermostat(UARTComponent* parent_component, sensor::Sensor* temp_sensor_ptr)
+    {
+        auto adapter = new EsphomeClimateHoneywellAdapter<Backend>(parent_component, temp_sensor_ptr);
+        attach(adapter);
+
+        return adapter;
+    }
+#endif
+
+    /// @brief Max time, which the UART communication of all thermostats may block one loop() call (default: 20 ms), must be called before setup().
+    void set_loop_budget(uint32_t loop_budget_ms) { loop_budget_ms_ = loop_budget_ms; }
+
+    void setup() override
+    {
+        // This will be called by App.setup()
+        bus_.SetLoopBudget(loop_budget_ms_);
+    }
+
+    void loop() override
+    {
+        // advance the UART communication of all thermostats without blocking
+        bus_.Loop();
+    }
+
+private:
+    /**
+     * @brief Let the bus drive the adapter. If the bus is full, the adapter advances its thermostat in its own loop().
+     */
+    template <typename Adapter>
+    void attach(Adapter* adapter)
+    {
+        if (!adapter->set_bus(&bus_))
+        {
+            ESP_LOGW("honeywell", "Bus is full (max %u thermostats), the thermostat #%u is driven by its own loop()",
+                     static_cast<unsigned>(HoneywellBus::MAX_MANAGERS), static_cast<unsigned>(bus_.Size() + (++rejected_)));
+            this->status_set_warning();
+        }
+    }
+
+    /// @brief Scheduler of the managers
+    HoneywellBus bus_;
+
+    /// @brief Max time, which the UART communication of all thermostats may block one loop() call
+    uint32_t loop_budget_ms_{ 20 };
+
+    /// @brief Number of thermostats, which did not fit on the bus
+    uint32_t rejected_{ 0 };
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef HONEYWELL_BACKEND_TRAITS_H
+#define HONEYWELL_BACKEND_TRAITS_H
+
+/**
+ * @file HoneywellBackendTraits.h
+ *
+ * @brief Capabilities of the Honeywell manager backends at compile time.
+ *        The climate adapter is a template over the backend and uses these traits to compile away unsupported features.
+ *
+ */
+
+#include <cstdint>
+
+class HoneywellManager_OpenHR20;
+class HoneywellManager_HR20_V1;
+class HoneywellManager_AutoDetect;
+template <typename Backend>
+class HoneywellIoTask;
+
+/**
+ * @brief Backend detected by HoneywellManager_AutoDetect. The values are stored in the flash, do not change them.
+ */
+enum class HoneywellBackendType : uint8_t
+{
+    E_UNKNOWN   = 0,
+    E_OPEN_HR20 = 1,
+    E_HR20_V1   = 2
+};
+
+/**
+ * @brief Capabilities of a Honeywell manager backend. Must be specialized for every backend.
+ */
+template <typename Backend>
+struct HoneywellBackendTraits;
+
+/**
+ * @brief Hardware Revision 2 with OpenHR20 firmware
+ */
+template <>
+struct HoneywellBackendTraits<HoneywellManager_OpenHR20>
+{
+    /// @brief The thermostat measures the room temperature.
+    static constexpr bool SUPPORTS_CURRENT_TEMPERATURE{ true };
+
+    /// @brief The thermostat reports the position of the valve.
+    static constexpr bool SUPPORTS_VALVE_POSITION{ true };
+
+    /// @brief The thermostat reports its whole state in status lines (StatusSnapshot), also unsolicited.
+    static constexpr bool SUPPORTS_STATUS_LINES{ true };
+
+    /// @brief The backend is fixed at compile time.
+    static constexpr bool DETECTS_BACKEND{ false };
+};
+
+/**
+ * @brief Hardware Revision 1, controlled over the memory protocol
+ */
+template <>
+struct HoneywellBackendTraits<HoneywellManager_HR20_V1>
+{
+    /// @brief The format of the measured room temperature is unknown, an external sensor can be used.
+    static constexpr bool SUPPORTS_CURRENT_TEMPERATURE{ false };
+
+    /// @brief The memory location of the valve position is unknown.
+    static constexpr bool SUPPORTS_VALVE_POSITION{ false };
+
+    /// @brief The thermostat only answers to read commands.
+    static constexpr bool SUPPORTS_STATUS_LINES{ false };
+
+    /// @brief The backend is fixed at compile time.
+    static constexpr bool DETECTS_BACKEND{ false };
+};
+
+/**
+ * @brief Hardware Revision 1 or 2, the protocol is detected at runtime.
+ *        Features of the OpenHR20 firmware are only used, if the OpenHR20 firmware was detected.
+ */
+template <>
+struct HoneywellBackendTraits<HoneywellManager_AutoDetect>
+{
+    /// @brief The room temperature is reported by the OpenHR20 firmware, an external sensor can be used.
+    static constexpr bool SUPPORTS_CURRENT_TEMPERATURE{ true };
+
+    /// @brief The position of the valve is reported by the OpenHR20 firmware.
+    static constexpr bool SUPPORTS_VALVE_POSITION{ true };
+
+    /// @brief Status lines are used, if the OpenHR20 firmware was detected (IsListenMode()).
+    static constexpr bool SUPPORTS_STATUS_LINES{ true };
+
+    /// @brief The protocol is probed at runtime and the result is cached in the flash.
+    static constexpr bool DETECTS_BACKEND{ true };
+};
+
+/**
+ * @brief A backend on its own I/O task has the same capabilities as the backend itself.
+ */
+template <typename Backend>
+struct HoneywellBackendTraits<HoneywellIoTask<Backend>> : HoneywellBackendTraits<Backend>
+{
+};
+
+#endif
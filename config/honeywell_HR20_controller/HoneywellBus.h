@@ -0,0 +1,144 @@
+#ifndef HONEYWELL_BUS_H
+#define HONEYWELL_BUS_H
+
+/**
+ * @file HoneywellBus.h
+ *
+ * @brief Drives several Honeywell managers, e.g. one thermostat on each hardware UART of an ESP32.
+ *        The managers are advanced round robin within one shared loop budget. While one thermostat is
+ *        waking up or transmitting its response, the transactions of the other thermostats are advanced.
+ *
+ */
+
+#include "IHoneywellManager.h"
+#include "esphome.h"
+#include <cstddef>
+#include <cstdint>
+
+class HoneywellBus
+{
+public:
+    /**
+     * @brief Add a manager, which is advanced by Loop() from now on. The manager is not owned by the bus.
+     *
+     * @param manager Manager with its own UART.
+     * @return E_NOT_OK if the bus is full.
+     */
+    ErrorCode AddManager(IHoneywellManager& manager);
+
+    /**
+     * @brief Limit the time, which one call of Loop() may block for all managers together.
+     *        Every manager gets an equal share of the budget.
+     *
+     * @param budgetMs Max time of one Loop() call in ms, 0 = no limit.
+     */
+    void SetLoopBudget(uint32_t budgetMs);
+
+    /**
+     * @brief Advance the communication of all managers. The first manager changes with every call,
+     *        so no manager is starved if the budget is used up.
+     */
+    void Loop(void);
+
+    /**
+     * @brief Check if asynchronous commands of any manager are active or queued.
+     */
+    bool IsBusy(void) const;
+
+    /**
+     * @brief Number of managers on the bus.
+     */
+    size_t Size(void) const { return count_; }
+
+    /// @brief Max number of managers, the ESP32 has 3 hardware UARTs.
+    static constexpr size_t MAX_MANAGERS{ 4 };
+
+private:
+    /**
+     * @brief Split the loop budget between the managers.
+     */
+    void distributeLoopBudget(void);
+
+    /// @brief Managers on the bus
+    IHoneywellManager* managers_[MAX_MANAGERS]{};
+
+    /// @brief Number of managers on the bus
+    size_t count_{ 0 };
+
+    /// @brief First manager of the next Loop() call
+    size_t next_{ 0 };
+
+    /// @brief Loop budget of all managers together in ms, 0 = no limit
+    uint32_t loop_budget_ms_{ 0 };
+};
+
+// Public functions
+
+ErrorCode HoneywellBus::AddManager(IHoneywellManager& manager)
+{
+    if (count_ >= MAX_MANAGERS)
+    {
+        return ErrorCode::E_NOT_OK;
+    }
+
+    managers_[count_++] = &manager;
+    distributeLoopBudget();
+
+    return ErrorCode::E_OK;
+}
+
+void HoneywellBus::SetLoopBudget(uint32_t budgetMs)
+{
+    loop_budget_ms_ = budgetMs;
+    distributeLoopBudget();
+}
+
+void HoneywellBus::Loop(void)
+{
+    const uint32_t start = micros();
+    size_t served        = 0;
+
+    while (served < count_)
+    {
+        managers_[(next_ + served) % count_]->Loop();
+        ++served;
+
+        if ((loop_budget_ms_ > 0u) && ((micros() - start) >= (loop_budget_ms_ * 1000u)))
+        {
+            break;
+        }
+    }
+
+    // the manager after the last served one starts the next call
+    if (count_ > 0u)
+    {
+        next_ = (next_ + ((served < count_) ? served : 1u)) % count_;
+    }
+}
+
+bool HoneywellBus::IsBusy(void) const
+{
+    for (size_t i = 0; i < count_; ++i)
+    {
+        if (managers_[i]->IsBusy())
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Private functions
+
+void HoneywellBus::distributeLoopBudget(void)
+{
+    for (size_t i = 0; i < count_; ++i)
+    {
+        // at least 1 ms, 0 would disable the limit
+        const uint32_t share = loop_budget_ms_ / static_cast<uint32_t>(count_);
+        managers_[i]->SetLoopBudget(((loop_budget_ms_ > 0u) && (share == 0u)) ? 1u : share);
+    }
+}
+
+#endif
@@ -0,0 +1,260 @@
+#ifndef HONEYWELL_CODEC_H
+#define HONEYWELL_CODEC_H
+
+/**
+ * @file HoneywellCodec.h
+ *
+ * @brief Allocation-free encoder of the command frames and decoder of the numeric fields of both protocols.
+ *        It replaces sprintf(), strtol() and atoi(), so their code is not linked for the managers.
+ *        A frame is built in a fixed buffer by constexpr functions: with constant values the frame is built at compile time,
+ *        hex digits of values known at run time are encoded without branches.
+ *        The decoder works directly on the received frame (FrameView), checks every character and the range of the value.
+ *
+ */
+
+#include "HoneywellLineFramer.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Command frame in a fixed buffer, always null terminated.
+ *        Characters which do not fit are dropped and the frame is marked as truncated.
+ *
+ * @tparam N Size of the buffer including the null terminator.
+ */
+template <size_t N>
+class HoneywellFrame
+{
+public:
+    static_assert(N > 1u, "the frame needs space for one character and the null terminator");
+
+    constexpr HoneywellFrame() = default;
+
+    /**
+     * @brief Append one character.
+     */
+    constexpr HoneywellFrame& Char(char c)
+    {
+        if (length_ < (N - 1u))
+        {
+            data_[length_++] = c;
+            data_[length_]   = '\0';
+        }
+        else
+        {
+            truncated_ = true;
+        }
+
+        return *this;
+    }
+
+    /**
+     * @brief Append a null terminated string.
+     */
+    constexpr HoneywellFrame& Text(const char* text)
+    {
+        for (size_t i = 0; text[i] != '\0'; ++i)
+        {
+            Char(text[i]);
+        }
+
+        return *this;
+    }
+
+    /**
+     * @brief Append a value as hex number with a fixed number of digits, like "%0<digits>x" or "%0<digits>X".
+     *        Digits above the given number are cut off.
+     *
+     * @param value The value.
+     * @param digits Number of hex digits (1 ... 8).
+     * @param upper true for the capital letters A ... F.
+     */
+    constexpr HoneywellFrame& Hex(uint32_t value, size_t digits, bool upper = false)
+    {
+        for (size_t i = digits; i > 0u; --i)
+        {
+            Char(HexDigit((value >> ((i - 1u) * 4u)) & 0x0Fu, upper));
+        }
+
+        return *this;
+    }
+
+    /**
+     * @brief Append a value as hex number without leading zeros, like "%x".
+     */
+    constexpr HoneywellFrame& Hex(uint32_t value)
+    {
+        size_t digits = 1;
+
+        while ((digits < 8u) && ((value >> (digits * 4u)) != 0u))
+        {
+            ++digits;
+        }
+
+        return Hex(value, digits);
+    }
+
+    /**
+     * @brief Hex digit of a nibble. The offset to the letters is added without a branch, if the nibble is above 9.
+     */
+    static constexpr char HexDigit(uint32_t nibble, bool upper)
+    {
+        // (9 - nibble) wraps around for 10 ... 15, so its upper bits select the offset from '9' + 1 to 'A' (7) or 'a' (39)
+        return static_cast<char>('0' + nibble + (((9u - nibble) >> 8) & (upper ? 7u : 39u)));
+    }
+
+    /// @brief The null terminated frame
+    constexpr const char* CStr(void) const { return data_; }
+
+    /// @brief Number of characters without the null terminator
+    constexpr size_t Length(void) const { return length_; }
+
+    /// @brief true if characters were dropped, because the buffer is full
+    constexpr bool IsTruncated(void) const { return truncated_; }
+
+    /**
+     * @brief Check if the frame is equal to the given frame.
+     */
+    template <size_t M>
+    constexpr bool Equals(const HoneywellFrame<M>& other) const
+    {
+        if (length_ != other.Length())
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < length_; ++i)
+        {
+            if (data_[i] != other.CStr()[i])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Copy the frame including the null terminator into a buffer, which is large enough for every frame of this size.
+     */
+    template <size_t M>
+    void CopyTo(char (&buffer)[M]) const
+    {
+        static_assert(N <= M, "the buffer is smaller than the frame");
+
+        for (size_t i = 0; i <= length_; ++i)
+        {
+            buffer[i] = data_[i];
+        }
+    }
+
+private:
+    char data_[N]{};
+    size_t length_{ 0 };
+    bool truncated_{ false };
+};
+
+// frames with constant values are built by the compiler
+static_assert(HoneywellFrame<12>().Char('W').Hex(0x136u, 3u, true).Hex(0x9Bu, 4u, true).Equals(HoneywellFrame<9>().Text("W136009B")),
+              "the encoder must be usable at compile time");
+
+/**
+ * @brief Bounds-checked decoder of the numeric fields of a received frame.
+ */
+class HoneywellDecoder
+{
+public:
+    /// @brief Max number of digits of a field, more digits could overflow the result
+    static constexpr size_t MAX_DIGITS{ 9 };
+
+    /**
+     * @brief Decode a decimal or hexadecimal number without sign.
+     *
+     * @param field The digits, without any other character.
+     * @param base 10 or 16.
+     * @param maxValue Largest valid value.
+     * @param value The decoded number, only set if all characters are valid digits and the value is in range.
+     * @return false if the field is empty, too long, contains another character or the value is out of range.
+     */
+    static bool DecodeUnsigned(const FrameView& field, uint32_t base, uint32_t maxValue, uint32_t& value)
+    {
+        uint32_t result{ 0 };
+
+        if (field.IsEmpty() || (field.length > MAX_DIGITS))
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < field.length; ++i)
+        {
+            const uint32_t digit = digitValue(field.data[i]);
+
+            if (digit >= base)
+            {
+                return false;
+            }
+
+            result = (result * base) + digit;
+        }
+
+        if (result > maxValue)
+        {
+            return false;
+        }
+
+        value = result;
+
+        return true;
+    }
+
+    /**
+     * @brief Decode a decimal fixed-point number with an optional minus sign and convert it to a coarser unit,
+     *        e.g. a temperature in 1/100 °C to 1/10 °C with a divisor of 10. The result is rounded towards zero.
+     *
+     * @param field The digits with an optional leading '-'.
+     * @param divisor Ratio between the unit of the field and the unit of the result.
+     * @param minValue Smallest valid result.
+     * @param maxValue Largest valid result.
+     * @param value The converted number, only set if the field is valid and the result is in range.
+     * @return false if the field is not a valid number or the result is out of range.
+     */
+    static bool DecodeFixedPoint(const FrameView& field, uint32_t divisor, int32_t minValue, int32_t maxValue, int32_t& value)
+    {
+        const bool negative = (field.At(0) == '-');
+        uint32_t magnitude{ 0 };
+
+        if ((divisor == 0u) || !DecodeUnsigned(field.SubView(negative ? 1u : 0u), 10u, UINT32_MAX, magnitude))
+        {
+            return false;
+        }
+
+        // at most 9 digits, so the magnitude always fits into the signed result
+        const int32_t scaled = static_cast<int32_t>(magnitude / divisor);
+        const int32_t result = negative ? -scaled : scaled;
+
+        if ((result < minValue) || (result > maxValue))
+        {
+            return false;
+        }
+
+        value = result;
+
+        return true;
+    }
+
+private:
+    /**
+     * @brief Value of a decimal or hex digit, 16 or more for any other character.
+     */
+    static uint32_t digitValue(char c)
+    {
+        const uint32_t decimal = static_cast<uint32_t>(static_cast<uint8_t>(c)) - '0';
+
+        // the letters are folded to lower case, all other characters wrap around to large values
+        const uint32_t letter = (static_cast<uint32_t>(static_cast<uint8_t>(c)) | 0x20u) - 'a';
+
+        return (decimal < 10u) ? decimal : ((letter < 6u) ? (letter + 10u) : 16u);
+    }
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef HONEYWELL_HISTORY_H
+#define HONEYWELL_HISTORY_H
+
+/**
+ * @file HoneywellHistory.h
+ *
+ * @brief History of the readings of a thermostat, which is sent to Home Assistant after the API was disconnected.
+ *        It is enabled with the second template argument of the climate adapter,
+ *        e.g. EsphomeClimateHoneywellAdapter<HoneywellManager_OpenHR20, HoneywellHistory>. A node without history
+ *        does not include this header, so neither the DeltaHistory nor its backfill are compiled in.
+ *
+ */
+
+#include "DeltaHistory.h"
+#include "esphome.h"
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+/**
+ * @brief History of a thermostat: target and current temperature (1/10 °C), valve position (%) and battery voltage (mV),
+ *        about 10 hours with one changed sample per minute in 4 KB.
+ */
+using HoneywellHistory = DeltaHistory<4>;
+
+/**
+ * @brief Records the readings of the climate adapter in a history, if a value changed and the history interval is over.
+ *        The samples recorded while no Home Assistant client was connected are sent after reconnecting.
+ */
+template <typename History>
+class HoneywellHistoryRecorder
+{
+public:
+    /**
+     * @brief Set the history, must be called before Setup().
+     *
+     * @param history The history, nullptr = no history. It may be placed in RTC memory (see DeltaHistory).
+     * @param intervalMs Min time between two samples.
+     */
+    void Set(History* history, uint32_t intervalMs)
+    {
+        history_    = history;
+        intervalMs_ = intervalMs;
+    }
+
+    /**
+     * @brief Validate the history after a boot and attach the backfill.
+     *
+     * @param name Name of the climate, used as device of the backfill events.
+     */
+    void Setup(const std::string& name)
+    {
+        if (history_ == nullptr)
+        {
+            return;
+        }
+
+        if (history_->Restore())
+        {
+            ESP_LOGI("honeywell", "History of '%s' restored: %u samples", name.c_str(), static_cast<unsigned>(history_->Count()));
+        }
+#ifdef USE_API
+        backfill_.Attach(history_, "esphome.honeywell_history", name);
+#endif
+    }
+
+    /**
+     * @brief Record a sample, if a value changed and the history interval is over.
+     *
+     * @param values Target and current temperature, valve position and battery voltage, History::UNKNOWN if not known.
+     */
+    void Record(const int16_t (&values)[4])
+    {
+        const uint32_t now = millis();
+
+        if ((history_ == nullptr) || (hasSample_ && ((now - lastMs_) < intervalMs_)) || (0 == memcmp(values, values_, sizeof(values))))
+        {
+            return;
+        }
+
+        history_->Add(static_cast<uint32_t>(::time(nullptr)), 0u, values);
+        memcpy(values_, values, sizeof(values));
+        hasSample_ = true;
+        lastMs_    = now;
+    }
+
+    /**
+     * @brief Send the next batch of the backfill, called from loop() of the adapter.
+     */
+    void Loop(void)
+    {
+#ifdef USE_API
+        backfill_.Loop();
+#endif
+    }
+
+    /**
+     * @brief Log the fill level of the history.
+     */
+    void Log(void) const
+    {
+        if (history_ != nullptr)
+        {
+            ESP_LOGI("honeywell", "  history: %u samples in %u of %u bytes, %u lost", static_cast<unsigned>(history_->Count()),
+                     static_cast<unsigned>(history_->UsedBytes()), static_cast<unsigned>(History::Capacity()),
+                     static_cast<unsigned>(history_->Lost()));
+        }
+    }
+
+private:
+    /// @brief History of the readings, nullptr if not used
+    History* history_{ nullptr };
+    uint32_t intervalMs_{ 60 * 1000 };
+
+    /// @brief Time and values of the last recorded sample
+    bool hasSample_{ false };
+    uint32_t lastMs_{ 0 };
+    int16_t values_[4]{ History::UNKNOWN, History::UNKNOWN, History::UNKNOWN, History::UNKNOWN };
+
+#ifdef USE_API
+    /// @brief Sends the samples recorded during an outage of the API
+    DeltaHistoryBackfill<History> backfill_;
+#endif
+};
+
+#endif
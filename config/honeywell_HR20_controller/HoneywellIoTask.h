@@ -0,0 +1,503 @@
+#ifndef HONEYWELL_IO_TASK_H
+#define HONEYWELL_IO_TASK_H
+
+/**
+ * @file HoneywellIoTask.h
+ *
+ * @brief Runs a Honeywell manager on its own FreeRTOS task, pinned to the core which is not used by the ESPHome main loop (ESP32 only).
+ *        On single core chips (e.g. ESP32-C3/S2) the task is not pinned, it shares the core and yields after every pass.
+ *        Commands are passed to the I/O task and results are passed back through one lock-free queue in each direction,
+ *        all callbacks are called from Loop() on the main loop task. So the main loop never blocks on the UART.
+ *        Also the log messages of the manager are passed back (see HoneywellLog.h), the ESPHome logger is only called by the main loop.
+ *        Without FreeRTOS (e.g. ESP8266 or the host simulation) the manager is advanced from Loop() instead, with the same queues.
+ *
+ */
+
+#include "HoneywellLog.h"
+#include "HoneywellRetryPolicy.h"
+#include "HoneywellSpscQueue.h"
+#include "HoneywellStatistics.h"
+#include "IHoneywellManager.h"
+#include "esphome.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#ifdef USE_ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+template <typename Backend>
+class HoneywellIoTask final : public IHoneywellManager
+{
+public:
+    HoneywellIoTask() = delete;
+
+    /**
+     * @brief Construct the manager, which is used by the I/O task.
+     *
+     * @param parent_component UART component definded by the ESPHome implementation.
+     */
+    explicit HoneywellIoTask(UARTComponent* parent_component)
+        : backend_(parent_component)
+    {
+    }
+
+    ~HoneywellIoTask() override = default;
+
+    /**
+     * @brief Blocking commands are not supported, they would access the manager from the main loop task.
+     *
+     * @return E_NOT_OK
+     */
+    ErrorCode SetDesiredTemperature(int) override { return ErrorCode::E_NOT_OK; }
+
+    /// @copydoc SetDesiredTemperature
+    ErrorCode GetDesiredTemperature(int&) override { return ErrorCode::E_NOT_OK; }
+
+    /// @copydoc SetDesiredTemperature
+    ErrorCode SetMode(Mode) override { return ErrorCode::E_NOT_OK; }
+
+    /// @copydoc SetDesiredTemperature
+    ErrorCode GetMode(Mode&) override { return ErrorCode::E_NOT_OK; }
+
+    /**
+     * @brief Start the I/O task on the first call. Afterwards call the callbacks of all results, which were passed back by the I/O task.
+     */
+    void Loop(void) override;
+
+    /**
+     * @brief Limit the time, which one Loop() call of the manager may block the I/O task. Must be called before the first Loop().
+     */
+    void SetLoopBudget(uint32_t budgetMs) override { backend_.SetLoopBudget(budgetMs); }
+
+    /**
+     * @brief Set the backoff of repeated requests and the circuit breaker. Must be called before the first Loop().
+     */
+    void SetRetryPolicy(const RetryPolicy& policy) override { backend_.SetRetryPolicy(policy); }
+
+    /**
+     * @brief Check if the thermostat is available, as last reported by the I/O task.
+     */
+    bool IsAvailable(void) const override { return available_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Copy the statistics, as last passed back by the I/O task (at most STATISTICS_INTERVAL_MS old).
+     */
+    void GetStatistics(HoneywellStatistics& statistics) const override { statistics = statistics_; }
+
+    /**
+     * @brief Check if commands are queued or active on the I/O task, or results are not yet reported.
+     */
+    bool IsBusy(void) const override { return pending_commands_ > 0u; }
+
+    /// @copydoc IHoneywellManager::SetDesiredTemperatureAsync
+    ErrorCode SetDesiredTemperatureAsync(int temperature, CompletionCallback callback) override
+    {
+        return queueCommand([this, temperature, callback](Backend& backend) {
+            return backend.SetDesiredTemperatureAsync(temperature, [this, callback](ErrorCode errorCode) {
+                queueCompletion([callback, errorCode]() { callback(errorCode); }, static_cast<bool>(callback));
+            });
+        });
+    }
+
+    /// @copydoc IHoneywellManager::GetDesiredTemperatureAsync
+    ErrorCode GetDesiredTemperatureAsync(TemperatureCallback callback) override
+    {
+        return queueCommand([this, callback](Backend& backend) {
+            return backend.GetDesiredTemperatureAsync([this, callback](ErrorCode errorCode, int temperature) {
+                queueCompletion([callback, errorCode, temperature]() { callback(errorCode, temperature); }, static_cast<bool>(callback));
+            });
+        });
+    }
+
+    /// @copydoc IHoneywellManager::SetModeAsync
+    ErrorCode SetModeAsync(Mode mode, CompletionCallback callback) override
+    {
+        return queueCommand([this, mode, callback](Backend& backend) {
+            return backend.SetModeAsync(mode, [this, callback](ErrorCode errorCode) {
+                queueCompletion([callback, errorCode]() { callback(errorCode); }, static_cast<bool>(callback));
+            });
+        });
+    }
+
+    /// @copydoc IHoneywellManager::GetModeAsync
+    ErrorCode GetModeAsync(ModeCallback callback) override
+    {
+        return queueCommand([this, callback](Backend& backend) {
+            return backend.GetModeAsync([this, callback](ErrorCode errorCode, Mode mode) {
+                queueCompletion([callback, errorCode, mode]() { callback(errorCode, mode); }, static_cast<bool>(callback));
+            });
+        });
+    }
+
+    /// @copydoc IHoneywellManager::GetStateAsync
+    ErrorCode GetStateAsync(StateCallback callback) override
+    {
+        return queueCommand([this, callback](Backend& backend) {
+            return backend.GetStateAsync([this, callback](ErrorCode errorCode, int temperature, Mode mode) {
+                queueCompletion([callback, errorCode, temperature, mode]() { callback(errorCode, temperature, mode); },
+                                static_cast<bool>(callback));
+            });
+        });
+    }
+
+    /// @copydoc IHoneywellManager::GetScheduleAsync
+    ErrorCode GetScheduleAsync(ScheduleCallback callback) override
+    {
+        return queueCommand([this, callback](Backend& backend) {
+            return backend.GetScheduleAsync([this, callback](ErrorCode errorCode, const WeeklySchedule& schedule) {
+                queueCompletion([callback, errorCode, schedule]() { callback(errorCode, schedule); }, static_cast<bool>(callback));
+            });
+        });
+    }
+
+    /// @copydoc IHoneywellManager::SetScheduleAsync
+    ErrorCode SetScheduleAsync(const WeeklySchedule& schedule, CompletionCallback callback) override
+    {
+        return queueCommand([this, schedule, callback](Backend& backend) {
+            return backend.SetScheduleAsync(schedule, [this, callback](ErrorCode errorCode) {
+                queueCompletion([callback, errorCode]() { callback(errorCode); }, static_cast<bool>(callback));
+            });
+        });
+    }
+
+    /**
+     * @brief Request a status snapshot, only for backends with status lines.
+     *
+     * @return E_OK if the request was queued. The callback is not called, if the backend rejects the request.
+     */
+    template <typename Callback>
+    ErrorCode GetStatusSnapshotAsync(Callback callback, uint32_t maxAgeMs)
+    {
+        return queueCommand([this, callback, maxAgeMs](Backend& backend) {
+            return backend.GetStatusSnapshotAsync(
+                [this, callback](ErrorCode errorCode, const typename Backend::StatusSnapshot& snapshot) {
+                    queueCompletion([callback, errorCode, snapshot]() { callback(errorCode, snapshot); }, true);
+                },
+                maxAgeMs);
+        });
+    }
+
+    /**
+     * @brief Enable or disable the passive listen mode, only for backends with status lines. Must be called before the first Loop().
+     */
+    void SetListenMode(bool enabled)
+    {
+        backend_.SetListenMode(enabled);
+        listen_mode_probe_ = [this]() { return backend_.IsListenMode(); };
+    }
+
+    /**
+     * @brief Check if unsolicited status lines are parsed, as last reported by the I/O task.
+     */
+    bool IsListenMode(void) const { return listen_mode_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Set an observer for new status snapshots, which is called from Loop(). Must be called before the first Loop().
+     */
+    template <typename Observer>
+    void SetStatusObserver(Observer observer)
+    {
+        backend_.SetStatusObserver([this, observer](ErrorCode errorCode, const typename Backend::StatusSnapshot& snapshot) {
+            queueNotification([observer, errorCode, snapshot]() { observer(errorCode, snapshot); });
+        });
+    }
+
+    /**
+     * @brief Use a backend without probing, only for backends with protocol detection. Must be called before the first Loop().
+     */
+    template <typename BackendType>
+    void SetBackendHint(BackendType backend)
+    {
+        backend_.SetBackendHint(backend);
+    }
+
+    /**
+     * @brief Set an observer for a detected backend, which is called from Loop(). Must be called before the first Loop().
+     */
+    template <typename Observer>
+    void SetDetectionObserver(Observer observer)
+    {
+        backend_.SetDetectionObserver([this, observer](decltype(backend_.GetBackend()) backend) {
+            queueNotification([observer, backend]() { observer(backend); });
+        });
+    }
+
+    /// @brief Max number of commands, which wait for the I/O task
+    static constexpr size_t COMMAND_QUEUE_SIZE{ 8 };
+
+    /// @brief Max number of results, which wait for the main loop
+    static constexpr size_t RESULT_QUEUE_SIZE{ 16 };
+
+    /// @brief Stack size of the I/O task in bytes
+    static constexpr uint32_t TASK_STACK_SIZE{ 4096 };
+
+    /// @brief Priority of the I/O task, above the idle task
+    static constexpr uint32_t TASK_PRIORITY{ 5 };
+
+    /// @brief Interval, in which the I/O task passes the statistics back to the main loop
+    static constexpr uint32_t STATISTICS_INTERVAL_MS{ 1000 };
+
+private:
+    /// @brief Command for the manager, executed by the I/O task. Returns the result of the asynchronous call.
+    using Command = std::function<ErrorCode(Backend& backend)>;
+
+    /// @brief Result for the main loop task
+    struct Result
+    {
+        /// @brief Calls the callback of the caller
+        std::function<void()> handler;
+
+        /// @brief true if a command is completed, false for a notification of an observer
+        bool completes{ false };
+    };
+
+    /**
+     * @brief Pass a command to the I/O task, called from the main loop task.
+     */
+    ErrorCode queueCommand(Command command);
+
+    /**
+     * @brief Pass the completion of a command to the main loop task, called from the I/O task.
+     *
+     * @param handler Calls the callback of the caller.
+     * @param valid false if there is no callback, only the command is completed.
+     */
+    void queueCompletion(std::function<void()> handler, bool valid);
+
+    /**
+     * @brief Pass a notification of an observer to the main loop task, called from the I/O task.
+     */
+    void queueNotification(std::function<void()> handler);
+
+    /**
+     * @brief Pass a result to the main loop task, waits if the queue is full.
+     */
+    void queueResult(Result& result);
+
+    /**
+     * @brief Call the handlers of all passed results, called from the main loop task.
+     */
+    void processResults(void);
+
+    /**
+     * @brief Execute the queued commands and advance the communication of the manager, called from the I/O task.
+     */
+    void ioLoop(void);
+
+#ifdef USE_ESP32
+    /**
+     * @brief Entry function of the I/O task.
+     */
+    static void ioTask(void* parameter);
+
+    /**
+     * @brief Pass a log message of the manager to the main loop task, the log sink of the I/O task.
+     */
+    static void queueLog(void* context, HoneywellLog::Level level, const char* message);
+
+    /// @brief Handle of the I/O task, nullptr if the task was not started or could not be created
+    TaskHandle_t task_handle_{ nullptr };
+
+    /// @brief Set by the I/O task when it is started, only accessed by the I/O task
+    bool on_io_task_{ false };
+#endif
+
+    /// @brief Manager, only accessed by the I/O task after the first Loop()
+    Backend backend_;
+
+    /// @brief Commands from the main loop task to the I/O task
+    HoneywellSpscQueue<Command, COMMAND_QUEUE_SIZE> commands_;
+
+    /// @brief Results from the I/O task to the main loop task
+    HoneywellSpscQueue<Result, RESULT_QUEUE_SIZE> results_;
+
+    /// @brief Commands which are not yet completed, only accessed by the main loop task
+    uint32_t pending_commands_{ 0 };
+
+    /// @brief true after the first Loop()
+    bool started_{ false };
+
+    /// @brief Listen mode of the manager, written by the I/O task
+    std::atomic<bool> listen_mode_{ false };
+
+    /// @brief Availability of the thermostat, written by the I/O task
+    std::atomic<bool> available_{ true };
+
+    /// @brief Reads the listen mode of the manager, empty for backends without status lines
+    std::function<bool()> listen_mode_probe_;
+
+    /// @brief Last statistics passed back by the I/O task, only accessed by the main loop task
+    HoneywellStatistics statistics_;
+
+    /// @brief millis() time stamp when the statistics were passed back, only accessed by the I/O task
+    uint32_t statistics_timestamp_{ 0 };
+};
+
+// Public functions
+
+template <typename Backend>
+void HoneywellIoTask<Backend>::Loop(void)
+{
+    if (!started_)
+    {
+        started_ = true;
+#ifdef USE_ESP32
+#if CONFIG_FREERTOS_UNICORE || (portNUM_PROCESSORS == 1)
+        // there is no other core, the task yields to the main loop after every pass
+        const BaseType_t core = tskNO_AFFINITY;
+#else
+        // the ESPHome main loop runs on the other core
+        const BaseType_t core = (xPortGetCoreID() == 0) ? 1 : 0;
+#endif
+
+        if (pdPASS != xTaskCreatePinnedToCore(&HoneywellIoTask::ioTask, "honeywell_io", TASK_STACK_SIZE, this, TASK_PRIORITY, &task_handle_, core))
+        {
+            ESP_LOGE("honeywell", "Could not create the I/O task, the UART is served by the main loop");
+            task_handle_ = nullptr;
+        }
+#endif
+    }
+
+#ifdef USE_ESP32
+    if (task_handle_ == nullptr)
+    {
+        ioLoop();
+    }
+#else
+    ioLoop();
+#endif
+
+    processResults();
+}
+
+// Private functions
+
+template <typename Backend>
+ErrorCode HoneywellIoTask<Backend>::queueCommand(Command command)
+{
+    if (!commands_.Push(command))
+    {
+        return ErrorCode::E_NOT_OK;
+    }
+
+    ++pending_commands_;
+    return ErrorCode::E_OK;
+}
+
+template <typename Backend>
+void HoneywellIoTask<Backend>::queueCompletion(std::function<void()> handler, bool valid)
+{
+    Result result;
+    result.handler   = valid ? handler : nullptr;
+    result.completes = true;
+    queueResult(result);
+}
+
+template <typename Backend>
+void HoneywellIoTask<Backend>::queueNotification(std::function<void()> handler)
+{
+    Result result;
+    result.handler = handler;
+    queueResult(result);
+}
+
+template <typename Backend>
+void HoneywellIoTask<Backend>::queueResult(Result& result)
+{
+    while (!results_.Push(result))
+    {
+#ifdef USE_ESP32
+        if (on_io_task_)
+        {
+            // the main loop will take the results
+            vTaskDelay(1);
+            continue;
+        }
+#endif
+        // the manager is advanced by the main loop task itself
+        processResults();
+    }
+}
+
+template <typename Backend>
+void HoneywellIoTask<Backend>::processResults(void)
+{
+    Result result;
+
+    while (results_.Pop(result))
+    {
+        if (result.completes && (pending_commands_ > 0u))
+        {
+            --pending_commands_;
+        }
+
+        if (result.handler)
+        {
+            result.handler();
+        }
+    }
+}
+
+template <typename Backend>
+void HoneywellIoTask<Backend>::ioLoop(void)
+{
+    Command command;
+
+    while (commands_.Pop(command))
+    {
+        if (ErrorCode::E_OK != command(backend_))
+        {
+            // rejected by the manager, the callback will not be called
+            queueCompletion(nullptr, false);
+        }
+    }
+
+    backend_.Loop();
+    available_.store(backend_.IsAvailable(), std::memory_order_relaxed);
+
+    // the statistics are copied to the main loop task, so it never reads them while they are written
+    if ((millis() - statistics_timestamp_) >= STATISTICS_INTERVAL_MS)
+    {
+        HoneywellStatistics statistics;
+        backend_.GetStatistics(statistics);
+        statistics_timestamp_ = millis();
+        queueNotification([this, statistics]() { statistics_ = statistics; });
+    }
+
+    if (listen_mode_probe_)
+    {
+        listen_mode_.store(listen_mode_probe_(), std::memory_order_relaxed);
+    }
+}
+
+#ifdef USE_ESP32
+template <typename Backend>
+void HoneywellIoTask<Backend>::ioTask(void* parameter)
+{
+    HoneywellIoTask* ioTask = static_cast<HoneywellIoTask*>(parameter);
+    ioTask->on_io_task_     = true;
+    HoneywellLog::SetTaskSink(&HoneywellIoTask::queueLog, ioTask);
+
+    for (;;)
+    {
+        ioTask->ioLoop();
+
+        // 1 tick, the thermostat is not faster anyway
+        vTaskDelay(1);
+    }
+}
+
+template <typename Backend>
+void HoneywellIoTask<Backend>::queueLog(void* context, HoneywellLog::Level level, const char* message)
+{
+    std::string text(message);
+    static_cast<HoneywellIoTask*>(context)->queueNotification([level, text]() { HoneywellLog::Write(level, text.c_str()); });
+}
+#endif
+
+#endif
@@ -0,0 +1,223 @@
+#ifndef HONEYWELL_LINE_FRAMER_H
+#define HONEYWELL_LINE_FRAMER_H
+
+/**
+ * @file HoneywellLineFramer.h
+ *
+ * @brief Fixed-size ring buffer, which splits the received UART bytes into line frames ("\n" or "\r" terminated).
+ *        The frames are handed out as views (pointer + length) into the buffer, so parsers are able to pick any field
+ *        out of the last complete frame without copying it and without extra I/O.
+ *        The buffer wraps only at frame boundaries, so every frame is stored contiguously.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Read-only view of characters, e.g. a frame or a field of a frame. Not null terminated.
+ */
+struct FrameView
+{
+    /// @brief First character of the view
+    const char* data{ nullptr };
+
+    /// @brief Number of characters
+    size_t length{ 0 };
+
+    /**
+     * @brief true if the view does not contain any character.
+     */
+    bool IsEmpty(void) const { return length == 0u; }
+
+    /**
+     * @brief Character at the given index, '\0' if the index is out of range.
+     */
+    char At(size_t index) const { return (index < length) ? data[index] : '\0'; }
+
+    /**
+     * @brief Part of this view.
+     *
+     * @param offset Index of the first character of the part.
+     * @param count Max number of characters of the part.
+     */
+    FrameView SubView(size_t offset, size_t count = SIZE_MAX) const
+    {
+        if (offset >= length)
+        {
+            return FrameView{ data + length, 0u };
+        }
+
+        const size_t remaining = length - offset;
+        return FrameView{ data + offset, (count < remaining) ? count : remaining };
+    }
+
+    /**
+     * @brief Check if the view starts with the given C-String.
+     */
+    bool StartsWith(const char* prefix) const
+    {
+        size_t i = 0;
+
+        for (; prefix[i] != '\0'; ++i)
+        {
+            if ((i >= length) || (data[i] != prefix[i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Check if the view is equal to the given C-String.
+     */
+    bool Equals(const char* str) const { return StartsWith(str) && (str[length] == '\0'); }
+
+    /**
+     * @brief Get the next token, which is delimited by the separator. Repeated separators are skipped.
+     *
+     * @param position Index where the search starts. It is moved behind the token.
+     * @param separator Separator between the tokens.
+     * @return The token, or an empty view if the end is reached.
+     */
+    FrameView NextToken(size_t& position, char separator = ' ') const
+    {
+        while ((position < length) && (data[position] == separator))
+        {
+            ++position;
+        }
+
+        const size_t start = position;
+
+        while ((position < length) && (data[position] != separator))
+        {
+            ++position;
+        }
+
+        return FrameView{ data + start, position - start };
+    }
+};
+
+class HoneywellLineFramer
+{
+public:
+    /// @brief Max length of one frame without the line terminator. Longer frames are discarded.
+    static constexpr size_t MAX_FRAME_LENGTH{ 128 };
+
+    /// @brief Size of the ring buffer. The last complete frame is kept valid while the next frame is received.
+    static constexpr size_t BUFFER_SIZE{ 3 * MAX_FRAME_LENGTH };
+
+    /**
+     * @brief Append one received byte.
+     *
+     * @param receivedChar The received byte.
+     * @return true if a frame was completed with this byte, it is available with LastFrame().
+     */
+    bool Push(char receivedChar);
+
+    /**
+     * @brief Last complete frame without the line terminator. The view is valid till the next frame is complete.
+     */
+    FrameView LastFrame(void) const { return FrameView{ &buffer_[lastStart_], lastLength_ }; }
+
+    /**
+     * @brief Characters of the frame which is received at the moment (no line terminator received yet).
+     */
+    FrameView CurrentFrame(void) const { return FrameView{ &buffer_[frameStart_], frameLength_ }; }
+
+    /**
+     * @brief Number of completed frames. Can be used to detect a new frame.
+     */
+    uint32_t FrameCount(void) const { return frameCount_; }
+
+    /**
+     * @brief Number of frames, which were discarded because they were longer than MAX_FRAME_LENGTH.
+     */
+    uint32_t OverflowCount(void) const { return overflowCount_; }
+
+    /**
+     * @brief Discard the frame which is received at the moment.
+     */
+    void DiscardCurrentFrame(void) { frameLength_ = 0; }
+
+private:
+    static_assert(BUFFER_SIZE >= (3 * MAX_FRAME_LENGTH), "the next frame must not overwrite the last complete frame");
+
+    /// @brief The received characters
+    char buffer_[BUFFER_SIZE]{};
+
+    /// @brief Index and length of the frame, which is received at the moment
+    size_t frameStart_{ 0 };
+    size_t frameLength_{ 0 };
+
+    /// @brief Index and length of the last complete frame
+    size_t lastStart_{ 0 };
+    size_t lastLength_{ 0 };
+
+    /// @brief The current frame is too long and discarded till the next line terminator.
+    bool overflow_{ false };
+
+    /// @brief Statistics
+    uint32_t frameCount_{ 0 };
+    uint32_t overflowCount_{ 0 };
+};
+
+/*
+ * public functions
+ */
+
+bool HoneywellLineFramer::Push(char receivedChar)
+{
+    if ((receivedChar == '\n') || (receivedChar == '\r'))
+    {
+        if (overflow_)
+        {
+            // resynchronized at the end of the discarded frame
+            overflow_    = false;
+            frameLength_ = 0;
+            return false;
+        }
+
+        if (frameLength_ == 0u)
+        {
+            // empty line, e.g. "\r\n"
+            return false;
+        }
+
+        lastStart_  = frameStart_;
+        lastLength_ = frameLength_;
+        ++frameCount_;
+
+        // the next frame starts behind this one, or at the beginning if a frame of max length does not fit anymore
+        frameStart_ += frameLength_;
+        if ((BUFFER_SIZE - frameStart_) < MAX_FRAME_LENGTH)
+        {
+            frameStart_ = 0;
+        }
+        frameLength_ = 0;
+
+        return true;
+    }
+
+    if (overflow_)
+    {
+        return false;
+    }
+
+    if (frameLength_ >= MAX_FRAME_LENGTH)
+    {
+        overflow_    = true;
+        frameLength_ = 0;
+        ++overflowCount_;
+        return false;
+    }
+
+    buffer_[frameStart_ + frameLength_] = receivedChar;
+    ++frameLength_;
+
+    return false;
+}
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef HONEYWELL_LOG_H
+#define HONEYWELL_LOG_H
+
+/**
+ * @file HoneywellLog.h
+ *
+ * @brief Log messages of the Honeywell managers. The ESPHome logger also sends every message to the connected API clients,
+ *        which is only safe on the main loop task. A task which advances a manager (the I/O task of HoneywellIoTask) registers
+ *        a sink, which passes the formatted messages back to the main loop. Without a sink the messages are logged at once.
+ *
+ */
+
+#include "esphome.h"
+#include <cstdarg>
+#include <cstdio>
+
+class HoneywellLog
+{
+public:
+    /// @brief Level of a deferred message
+    enum class Level : uint8_t
+    {
+        E_DEBUG,
+        E_INFO,
+        E_WARNING
+    };
+
+    /// @brief Receives a formatted message on the task, which logged it. The message is only valid during the call.
+    using Sink = void (*)(void* context, Level level, const char* message);
+
+    /// @brief Max length of a deferred message, longer messages are truncated
+    static constexpr size_t MAX_MESSAGE_LENGTH{ 128 };
+
+    /**
+     * @brief Register the sink of the calling task, nullptr logs the messages of this task at once.
+     */
+    static void SetTaskSink(Sink sink, void* context)
+    {
+        TaskSink& taskSink = currentTaskSink();
+        taskSink.sink      = sink;
+        taskSink.context   = context;
+    }
+
+    /**
+     * @brief Pass a message to the sink of the calling task.
+     *
+     * @return false if the calling task has no sink, the message must be logged at once.
+     */
+    __attribute__((format(printf, 2, 3))) static bool Defer(Level level, const char* format, ...)
+    {
+        const TaskSink& taskSink = currentTaskSink();
+        char message[MAX_MESSAGE_LENGTH];
+        va_list args;
+
+        if (taskSink.sink == nullptr)
+        {
+            return false;
+        }
+
+        va_start(args, format);
+        vsnprintf(message, sizeof(message), format, args);
+        va_end(args);
+
+        taskSink.sink(taskSink.context, level, message);
+        return true;
+    }
+
+    /**
+     * @brief Log a deferred message, called from the main loop task.
+     */
+    static void Write(Level level, const char* message)
+    {
+        switch (level)
+        {
+        case Level::E_WARNING:
+            ESP_LOGW("honeywell", "%s", message);
+            break;
+        case Level::E_INFO:
+            ESP_LOGI("honeywell", "%s", message);
+            break;
+        default:
+            ESP_LOGD("honeywell", "%s", message);
+            break;
+        }
+    }
+
+private:
+    /// @brief Sink of one task
+    struct TaskSink
+    {
+        Sink sink{ nullptr };
+        void* context{ nullptr };
+    };
+
+    /**
+     * @brief Sink of the calling task.
+     */
+    static TaskSink& currentTaskSink(void)
+    {
+        static thread_local TaskSink taskSink;
+        return taskSink;
+    }
+};
+
+/// @brief Log a debug message of a manager, see HoneywellLog
+#define HONEYWELL_LOGD(format, ...)                                                                 \
+    do                                                                                              \
+    {                                                                                               \
+        if (!HoneywellLog::Defer(HoneywellLog::Level::E_DEBUG, format, ##__VA_ARGS__))              \
+        {                                                                                           \
+            ESP_LOGD("honeywell", format, ##__VA_ARGS__);                                           \
+        }                                                                                           \
+    } while (0)
+
+/// @brief Log an info message of a manager, see HoneywellLog
+#define HONEYWELL_LOGI(format, ...)                                                                 \
+    do                                                                                              \
+    {                                                                                               \
+        if (!HoneywellLog::Defer(HoneywellLog::Level::E_INFO, format, ##__VA_ARGS__))               \
+        {                                                                                           \
+            ESP_LOGI("honeywell", format, ##__VA_ARGS__);                                           \
+        }                                                                                           \
+    } while (0)
+
+/// @brief Log a warning of a manager, see HoneywellLog
+#define HONEYWELL_LOGW(format, ...)                                                                 \
+    do                                                                                              \
+    {                                                                                               \
+        if (!HoneywellLog::Defer(HoneywellLog::Level::E_WARNING, format, ##__VA_ARGS__))            \
+        {                                                                                           \
+            ESP_LOGW("honeywell", format, ##__VA_ARGS__);                                           \
+        }                                                                                           \
+    } while (0)
+
+#endif
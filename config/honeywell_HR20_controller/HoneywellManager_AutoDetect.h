@@ -0,0 +1,479 @@
+#ifndef HONEYWELL_MANAGER_AUTO_DETECT_H
+#define HONEYWELL_MANAGER_AUTO_DETECT_H
+
+/**
+ * @file HoneywellManager_AutoDetect.h
+ *
+ * @brief This class detects at runtime, if the thermostat "Honeywell HR20" is a Hardware Revision V1 (memory protocol)
+ *        or a Hardware Revision 2 with OpenHR20 firmware (text protocol). All commands are forwarded to the matching manager.
+ *        The same firmware can be used for all thermostats.
+ *
+ */
+
+#include "HoneywellBackendTraits.h"
+#include "HoneywellLog.h"
+#include "HoneywellManager_HR20_V1.h"
+#include "HoneywellManager_OpenHR20.h"
+#include "IHoneywellManager.h"
+#include "esphome.h"
+#include <cstdint>
+#include <functional>
+
+class HoneywellManager_AutoDetect final : public IHoneywellManager
+{
+public:
+    /// @brief Status of the OpenHR20 firmware, only available if the OpenHR20 firmware was detected.
+    using StatusSnapshot = HoneywellManager_OpenHR20::StatusSnapshot;
+
+    /// @brief Callback with a status snapshot.
+    using StatusSnapshotCallback = HoneywellManager_OpenHR20::StatusSnapshotCallback;
+
+    /// @brief Callback which is called when a backend was detected by probing.
+    using DetectionCallback = std::function<void(HoneywellBackendType backend)>;
+
+    HoneywellManager_AutoDetect() = delete;
+
+    /**
+     * @brief Construct a new Honeywell Manager. Both protocol managers are using the same UART.
+     *
+     * @param parent_component UART component definded by the ESPHome implementation.
+     */
+    explicit HoneywellManager_AutoDetect(UARTComponent* parent_component)
+        : open_hr20_(parent_component)
+        , hr20_v1_(parent_component)
+    {
+    }
+
+    ~HoneywellManager_AutoDetect() override = default;
+
+    /**
+     * @brief Use a backend without probing, e.g. the result of a previous detection.
+     *        If the thermostat does not answer to the first requests, the backend is probed again.
+     *        Must be called before the first Loop().
+     *
+     * @param backend Backend to use, E_UNKNOWN is ignored.
+     */
+    void SetBackendHint(HoneywellBackendType backend);
+
+    /**
+     * @brief Set an observer, which is called when a backend was detected by probing, which differs from the hint.
+     *
+     * @param observer Observer or nullptr.
+     */
+    void SetDetectionObserver(DetectionCallback observer) { detection_observer_ = observer; }
+
+    /**
+     * @brief Get the backend, which is used.
+     *
+     * @return E_UNKNOWN while probing.
+     */
+    HoneywellBackendType GetBackend(void) const { return backend_; }
+
+    /// @copydoc IHoneywellManager::SetDesiredTemperature
+    ErrorCode SetDesiredTemperature(int temperature) override;
+
+    /// @copydoc IHoneywellManager::GetDesiredTemperature
+    ErrorCode GetDesiredTemperature(int& temperature) override;
+
+    /// @copydoc IHoneywellManager::SetMode
+    ErrorCode SetMode(Mode mode) override;
+
+    /// @copydoc IHoneywellManager::GetMode
+    ErrorCode GetMode(Mode& mode) override;
+
+    /**
+     * @brief Probe the protocols till the thermostat answers, afterwards advance the communication of the detected backend.
+     */
+    void Loop(void) override;
+
+    /// @copydoc IHoneywellManager::SetLoopBudget
+    void SetLoopBudget(uint32_t budgetMs) override;
+
+    /// @copydoc IHoneywellManager::SetRetryPolicy
+    void SetRetryPolicy(const RetryPolicy& policy) override;
+
+    /**
+     * @brief Check if the detected thermostat is available. While probing it is unavailable after both protocols failed.
+     */
+    bool IsAvailable(void) const override;
+
+    /**
+     * @brief Copy the statistics of both protocols, the probing of the wrong protocol is included.
+     */
+    void GetStatistics(HoneywellStatistics& statistics) const override;
+
+    /**
+     * @brief Check if asynchronous commands are active or queued. Always true while probing.
+     */
+    bool IsBusy(void) const override;
+
+    /// @copydoc IHoneywellManager::SetDesiredTemperatureAsync
+    ErrorCode SetDesiredTemperatureAsync(int temperature, CompletionCallback callback) override;
+
+    /// @copydoc IHoneywellManager::GetDesiredTemperatureAsync
+    ErrorCode GetDesiredTemperatureAsync(TemperatureCallback callback) override;
+
+    /// @copydoc IHoneywellManager::SetModeAsync
+    ErrorCode SetModeAsync(Mode mode, CompletionCallback callback) override;
+
+    /// @copydoc IHoneywellManager::GetModeAsync
+    ErrorCode GetModeAsync(ModeCallback callback) override;
+
+    /// @copydoc IHoneywellManager::GetStateAsync
+    ErrorCode GetStateAsync(StateCallback callback) override;
+
+    /// @copydoc IHoneywellManager::GetScheduleAsync
+    ErrorCode GetScheduleAsync(ScheduleCallback callback) override;
+
+    /// @copydoc IHoneywellManager::SetScheduleAsync
+    ErrorCode SetScheduleAsync(const WeeklySchedule& schedule, CompletionCallback callback) override;
+
+    /**
+     * @brief Request a status snapshot, only available if the OpenHR20 firmware was detected.
+     *        See HoneywellManager_OpenHR20::GetStatusSnapshotAsync().
+     *
+     * @return E_OK if the request was queued, otherwise the callback will not be called.
+     */
+    ErrorCode GetStatusSnapshotAsync(StatusSnapshotCallback callback,
+                                     uint32_t maxAgeMs = HoneywellManager_OpenHR20::STATUS_SNAPSHOT_MAX_AGE_MS);
+
+    /**
+     * @brief Enable or disable the passive listen mode. Takes effect as soon as the OpenHR20 firmware was detected.
+     *
+     * @param enabled true to parse unsolicited status lines.
+     */
+    void SetListenMode(bool enabled);
+
+    /**
+     * @brief Check if unsolicited status lines are parsed, i.e. listen mode is enabled and the OpenHR20 firmware was detected.
+     */
+    bool IsListenMode(void) const { return listen_mode_ && (backend_ == HoneywellBackendType::E_OPEN_HR20); }
+
+    /**
+     * @brief Set an observer for new status snapshots of the OpenHR20 firmware.
+     *
+     * @param observer Observer or nullptr.
+     */
+    void SetStatusObserver(StatusSnapshotCallback observer) { open_hr20_.SetStatusObserver(observer); }
+
+    /// @brief Time after a failed probe of both protocols, till the next probe is started.
+    static constexpr uint32_t PROBE_RETRY_INTERVAL_MS{ 30000 };
+
+    /// @brief Number of failed state requests without any answer, till a backend from the hint is probed again.
+    static constexpr uint8_t MAX_UNCONFIRMED_FAILURES{ 3 };
+
+private:
+    /// @brief Steps of the detection
+    enum class ProbeState : uint8_t
+    {
+        E_START,
+        E_PROBE_OPEN_HR20,
+        E_PROBE_HR20_V1,
+        E_WAIT_RETRY,
+        E_DETECTED
+    };
+
+    /**
+     * @brief Send a state request with the protocol of the given backend.
+     */
+    void startProbe(HoneywellBackendType backend);
+
+    /**
+     * @brief Use the given backend for all further commands.
+     *
+     * @param probed true if the backend was detected by probing, false for a hint.
+     */
+    void selectBackend(HoneywellBackendType backend, bool probed);
+
+    /**
+     * @brief Check the result of a state request, a hint which is never answered is probed again.
+     */
+    void confirmBackend(ErrorCode errorCode);
+
+    /**
+     * @brief Get the manager of the detected backend.
+     *
+     * @return nullptr while probing.
+     */
+    IHoneywellManager* active(void) const { return (probe_state_ == ProbeState::E_DETECTED) ? active_ : nullptr; }
+
+    /// @brief Manager for the OpenHR20 firmware
+    HoneywellManager_OpenHR20 open_hr20_;
+
+    /// @brief Manager for the Hardware Revision V1
+    HoneywellManager_HR20_V1 hr20_v1_;
+
+    /// @brief Manager of the detected or probed backend
+    IHoneywellManager* active_{ nullptr };
+
+    /// @brief Detected backend
+    HoneywellBackendType backend_{ HoneywellBackendType::E_UNKNOWN };
+
+    /// @brief Backend from the hint or the last detection
+    HoneywellBackendType hint_{ HoneywellBackendType::E_UNKNOWN };
+
+    /// @brief Step of the detection
+    ProbeState probe_state_{ ProbeState::E_START };
+
+    /// @brief true as soon as the thermostat answered with the selected protocol
+    bool confirmed_{ false };
+
+    /// @brief Failed state requests since the backend was selected from the hint
+    uint8_t unconfirmed_failures_{ 0 };
+
+    /// @brief Start of the wait time after a failed probe
+    uint32_t probe_failed_ms_{ 0 };
+
+    /// @brief Requested listen mode
+    bool listen_mode_{ false };
+
+    /// @brief Observer of the detection
+    DetectionCallback detection_observer_;
+};
+
+// Public functions
+
+void HoneywellManager_AutoDetect::SetBackendHint(HoneywellBackendType backend)
+{
+    if ((backend == HoneywellBackendType::E_OPEN_HR20) || (backend == HoneywellBackendType::E_HR20_V1))
+    {
+        selectBackend(backend, false);
+    }
+}
+
+ErrorCode HoneywellManager_AutoDetect::SetDesiredTemperature(int temperature)
+{
+    return (active() != nullptr) ? active()->SetDesiredTemperature(temperature) : ErrorCode::E_NOT_OK;
+}
+
+ErrorCode HoneywellManager_AutoDetect::GetDesiredTemperature(int& temperature)
+{
+    return (active() != nullptr) ? active()->GetDesiredTemperature(temperature) : ErrorCode::E_NOT_OK;
+}
+
+ErrorCode HoneywellManager_AutoDetect::SetMode(Mode mode)
+{
+    return (active() != nullptr) ? active()->SetMode(mode) : ErrorCode::E_NOT_OK;
+}
+
+ErrorCode HoneywellManager_AutoDetect::GetMode(Mode& mode)
+{
+    return (active() != nullptr) ? active()->GetMode(mode) : ErrorCode::E_NOT_OK;
+}
+
+void HoneywellManager_AutoDetect::Loop(void)
+{
+    switch (probe_state_)
+    {
+    case ProbeState::E_START:
+        // the probes of the wrong protocol fail, so their circuit breakers would reject the probes of the next rounds
+        open_hr20_.ResetAvailability();
+        hr20_v1_.ResetAvailability();
+
+        // the OpenHR20 firmware answers immediately, the HR20_V1 has to be woken up first
+        startProbe(HoneywellBackendType::E_OPEN_HR20);
+        break;
+
+    case ProbeState::E_WAIT_RETRY:
+        if ((millis() - probe_failed_ms_) >= PROBE_RETRY_INTERVAL_MS)
+        {
+            probe_state_ = ProbeState::E_START;
+        }
+        break;
+
+    default:
+        active_->Loop();
+        break;
+    }
+}
+
+void HoneywellManager_AutoDetect::SetLoopBudget(uint32_t budgetMs)
+{
+    open_hr20_.SetLoopBudget(budgetMs);
+    hr20_v1_.SetLoopBudget(budgetMs);
+}
+
+void HoneywellManager_AutoDetect::SetRetryPolicy(const RetryPolicy& policy)
+{
+    open_hr20_.SetRetryPolicy(policy);
+    hr20_v1_.SetRetryPolicy(policy);
+}
+
+bool HoneywellManager_AutoDetect::IsAvailable(void) const
+{
+    if (active() == nullptr)
+    {
+        return probe_state_ != ProbeState::E_WAIT_RETRY;
+    }
+
+    return active()->IsAvailable();
+}
+
+void HoneywellManager_AutoDetect::GetStatistics(HoneywellStatistics& statistics) const
+{
+    HoneywellStatistics hr20V1Statistics;
+
+    open_hr20_.GetStatistics(statistics);
+    hr20_v1_.GetStatistics(hr20V1Statistics);
+    statistics.Merge(hr20V1Statistics);
+}
+
+bool HoneywellManager_AutoDetect::IsBusy(void) const
+{
+    return (active() == nullptr) || active()->IsBusy();
+}
+
+ErrorCode HoneywellManager_AutoDetect::SetDesiredTemperatureAsync(int temperature, CompletionCallback callback)
+{
+    return (active() != nullptr) ? active()->SetDesiredTemperatureAsync(temperature, callback) : ErrorCode::E_NOT_OK;
+}
+
+ErrorCode HoneywellManager_AutoDetect::GetDesiredTemperatureAsync(TemperatureCallback callback)
+{
+    return (active() != nullptr) ? active()->GetDesiredTemperatureAsync(callback) : ErrorCode::E_NOT_OK;
+}
+
+ErrorCode HoneywellManager_AutoDetect::SetModeAsync(Mode mode, CompletionCallback callback)
+{
+    return (active() != nullptr) ? active()->SetModeAsync(mode, callback) : ErrorCode::E_NOT_OK;
+}
+
+ErrorCode HoneywellManager_AutoDetect::GetModeAsync(ModeCallback callback)
+{
+    return (active() != nullptr) ? active()->GetModeAsync(callback) : ErrorCode::E_NOT_OK;
+}
+
+ErrorCode HoneywellManager_AutoDetect::GetStateAsync(StateCallback callback)
+{
+    if (active() == nullptr)
+    {
+        return ErrorCode::E_NOT_OK;
+    }
+
+    return active()->GetStateAsync([this, callback](ErrorCode errorCode, int temperature, Mode mode) {
+        confirmBackend(errorCode);
+
+        if (callback)
+        {
+            callback(errorCode, temperature, mode);
+        }
+    });
+}
+
+ErrorCode HoneywellManager_AutoDetect::GetScheduleAsync(ScheduleCallback callback)
+{
+    return (active() != nullptr) ? active()->GetScheduleAsync(callback) : ErrorCode::E_NOT_OK;
+}
+
+ErrorCode HoneywellManager_AutoDetect::SetScheduleAsync(const WeeklySchedule& schedule, CompletionCallback callback)
+{
+    return (active() != nullptr) ? active()->SetScheduleAsync(schedule, callback) : ErrorCode::E_NOT_OK;
+}
+
+ErrorCode HoneywellManager_AutoDetect::GetStatusSnapshotAsync(StatusSnapshotCallback callback, uint32_t maxAgeMs)
+{
+    if ((active() == nullptr) || (backend_ != HoneywellBackendType::E_OPEN_HR20))
+    {
+        return ErrorCode::E_NOT_OK;
+    }
+
+    return open_hr20_.GetStatusSnapshotAsync(
+        [this, callback](ErrorCode errorCode, const StatusSnapshot& snapshot) {
+            confirmBackend(errorCode);
+
+            if (callback)
+            {
+                callback(errorCode, snapshot);
+            }
+        },
+        maxAgeMs);
+}
+
+void HoneywellManager_AutoDetect::SetListenMode(bool enabled)
+{
+    listen_mode_ = enabled;
+    open_hr20_.SetListenMode(IsListenMode());
+}
+
+// Private functions
+
+void HoneywellManager_AutoDetect::startProbe(HoneywellBackendType backend)
+{
+    const bool openHR20 = (backend == HoneywellBackendType::E_OPEN_HR20);
+
+    backend_     = HoneywellBackendType::E_UNKNOWN;
+    active_      = openHR20 ? static_cast<IHoneywellManager*>(&open_hr20_) : static_cast<IHoneywellManager*>(&hr20_v1_);
+    probe_state_ = openHR20 ? ProbeState::E_PROBE_OPEN_HR20 : ProbeState::E_PROBE_HR20_V1;
+    open_hr20_.SetListenMode(false);
+
+    // a state request is supported by both protocols and answered only by the matching firmware
+    const ErrorCode errorCode = active_->GetStateAsync([this, backend, openHR20](ErrorCode result, int, Mode) {
+        if (ErrorCode::E_OK == result)
+        {
+            HONEYWELL_LOGI("Detected %s protocol", openHR20 ? "OpenHR20" : "HR20_V1");
+            selectBackend(backend, true);
+        }
+        else if (openHR20)
+        {
+            startProbe(HoneywellBackendType::E_HR20_V1);
+        }
+        else
+        {
+            HONEYWELL_LOGW("No answer to the OpenHR20 and the HR20_V1 protocol, retry in %u s",
+                           static_cast<unsigned>(PROBE_RETRY_INTERVAL_MS / 1000u));
+            probe_state_     = ProbeState::E_WAIT_RETRY;
+            probe_failed_ms_ = millis();
+        }
+    });
+
+    if (ErrorCode::E_OK != errorCode)
+    {
+        probe_state_     = ProbeState::E_WAIT_RETRY;
+        probe_failed_ms_ = millis();
+    }
+}
+
+void HoneywellManager_AutoDetect::selectBackend(HoneywellBackendType backend, bool probed)
+{
+    const bool openHR20 = (backend == HoneywellBackendType::E_OPEN_HR20);
+
+    backend_              = backend;
+    active_               = openHR20 ? static_cast<IHoneywellManager*>(&open_hr20_) : static_cast<IHoneywellManager*>(&hr20_v1_);
+    probe_state_          = ProbeState::E_DETECTED;
+    confirmed_            = probed;
+    unconfirmed_failures_ = 0;
+    open_hr20_.SetListenMode(IsListenMode());
+
+    if (probed && (backend != hint_) && detection_observer_)
+    {
+        detection_observer_(backend);
+    }
+
+    hint_ = backend;
+}
+
+void HoneywellManager_AutoDetect::confirmBackend(ErrorCode errorCode)
+{
+    if (confirmed_ || (probe_state_ != ProbeState::E_DETECTED))
+    {
+        return;
+    }
+
+    if (ErrorCode::E_OK == errorCode)
+    {
+        confirmed_ = true;
+    }
+    else if ((ErrorCode::E_RESPONSE_TIMEOUT == errorCode) || (ErrorCode::E_RESPONSE_WRONG == errorCode))
+    {
+        if (++unconfirmed_failures_ >= MAX_UNCONFIRMED_FAILURES)
+        {
+            // e.g. the thermostat was replaced, the cached backend is outdated
+            HONEYWELL_LOGW("No answer with the cached protocol, probing again");
+            open_hr20_.SetListenMode(false);
+            backend_     = HoneywellBackendType::E_UNKNOWN;
+            probe_state_ = ProbeState::E_START;
+        }
+    }
+}
+
+#endif
@@ -10,29 +10,110 @@
  *
  */
 
+#include "HoneywellCodec.h"
+#include "HoneywellTransactionEngine.h"
 #include "IHoneywellManager.h"
 #include "esphome.h"
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <stdint.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
 
 /*
  * constants
  */
 
-/// @brief 8 char + null terminator
-constexpr size_t WRITE_COMMAND_CHAR_COUNT{ 9 };
+/// @brief A read response contains 4 hex characters (2 bytes).
+constexpr size_t READ_VALUE_CHAR_COUNT{ 4 };
 
-/// @brief 4 char + null terminator
-constexpr size_t READ_COMMAND_CHAR_COUNT{ 5 };
+/// @brief Send empty commands till the Honeywell is responding.
+constexpr WakeupSequence HR20_V1_WAKEUP_SEQUENCE{ "K\r\n", 50u, 20u };
+
+/**
+ * @brief One read or write command of the memory protocol.
+ */
+struct MemoryOperation
+{
+    /// @brief true = write "Waaadddd", false = read "Raaa"
+    bool write{ false };
+
+    /// @brief Memory address (12 bit)
+    uint16_t address{ 0 };
+
+    /// @brief Value to write, or the read value after the execution (2 bytes)
+    uint16_t value{ 0 };
+
+    /// @brief Result of this command after the execution
+    ErrorCode result{ ErrorCode::E_NOT_OK };
+};
+
+/**
+ * @brief List of read and write commands, which are executed in one session after one wake up.
+ */
+struct MemoryBatch
+{
+    /// @brief Max number of commands in one session
+    static constexpr size_t MAX_OPERATIONS{ 8 };
+
+    /// @brief The commands in the order of execution
+    MemoryOperation operations[MAX_OPERATIONS];
+
+    /// @brief Number of commands
+    size_t count{ 0 };
+
+    /**
+     * @brief Append a read command.
+     * @return false if the batch is full.
+     */
+    bool AddRead(uint16_t address) { return add(false, address, 0u); }
+
+    /**
+     * @brief Append a write command.
+     * @return false if the batch is full.
+     */
+    bool AddWrite(uint16_t address, uint16_t value) { return add(true, address, value); }
+
+    /**
+     * @brief Result of the whole batch: E_OK if all commands were successful, otherwise the first error.
+     */
+    ErrorCode Result(void) const
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (operations[i].result != ErrorCode::E_OK)
+            {
+                return operations[i].result;
+            }
+        }
+
+        return (count > 0u) ? ErrorCode::E_OK : ErrorCode::E_NOT_OK;
+    }
+
+private:
+    bool add(bool write, uint16_t address, uint16_t value)
+    {
+        if (count >= MAX_OPERATIONS)
+        {
+            return false;
+        }
+
+        operations[count] = MemoryOperation{ write, address, value, ErrorCode::E_NOT_OK };
+        ++count;
+
+        return true;
+    }
+};
+
+/**
+ * @brief Callback to report the results of all commands of a batch.
+ */
+using BatchCallback = std::function<void(ErrorCode errorCode, const MemoryBatch& batch)>;
 
 /*
  * class definition
  */
-class HoneywellManager_HR20_V1 : public IHoneywellManager
+class HoneywellManager_HR20_V1 final : public IHoneywellManager
 {
 public:
     /**
@@ -71,36 +152,153 @@ public:
      */
     ErrorCode SetMode(Mode mode) override;
 
-private:
     /**
-     * @brief Send some dummy command and wait till Honeywell replied with a response command.
+     * @brief Advance the asynchronous communication with the thermostat. Shall be called cyclically, e.g. from the ESPHome loop().
+     */
+    void Loop(void) override;
+
+    /**
+     * @brief Limit the time, which one call of Loop() may block. The requests are not flushed with a limit.
+     *
+     * @param budgetMs Max time of one Loop() call in ms, 0 = no limit.
+     */
+    void SetLoopBudget(uint32_t budgetMs) override;
+
+    /// @copydoc IHoneywellManager::SetRetryPolicy
+    void SetRetryPolicy(const RetryPolicy& policy) override;
+
+    /// @copydoc IHoneywellManager::IsAvailable
+    bool IsAvailable(void) const override;
+
+    /**
+     * @brief Let the next request through, also if the thermostat was unavailable. Used before the protocol is probed.
+     */
+    void ResetAvailability(void);
+
+    /// @copydoc IHoneywellManager::GetStatistics
+    void GetStatistics(HoneywellStatistics& statistics) const override;
+
+    /**
+     * @brief Check if asynchronous commands are active or queued.
      */
-    void waitForAnyResponse(void);
+    bool IsBusy(void) const override;
 
     /**
-     * @brief Send an commmand string to the honeywell controler over UART.
-     * @param command C-String of the command to send.
+     * @brief Queue the write commands of the desired temperature to display and motor RAM. Returns immediately.
+     *
+     * @param temperature Temperature value in celsius and with factor 10 offset (e.g.: 225 => 22.5°C)
+     * @param callback Called from Loop() as soon as both write commands are confirmed or failed.
+     * @return E_OK if the command was queued, otherwise the callback will not be called.
      */
-    ErrorCode sendToHoneywell(char* command);
+    ErrorCode SetDesiredTemperatureAsync(int temperature, CompletionCallback callback) override;
 
-    ErrorCode readFromHoneywell(char* command, char* readValue);
+    /**
+     * @brief Queue a read command of the desired temperature. Returns immediately.
+     *
+     * @param callback Called from Loop() with the desired temperature as soon as the request is done.
+     * @return E_OK if the request was queued, otherwise the callback will not be called.
+     */
+    ErrorCode GetDesiredTemperatureAsync(TemperatureCallback callback) override;
 
     /**
-     * @brief Check if the Honeywell controller replied with the expected response message within a specified timeout
-     * @param expectedResponse C-String of the expected response command
+     * @brief Queue a write command of manual or automatic mode. Returns immediately.
+     *
+     * @param mode manual or automatic mode.
+     * @param callback Called from Loop() as soon as the command is confirmed or failed.
+     * @return E_OK if the command was queued, otherwise the callback will not be called.
      */
-    ErrorCode checkHoneywellReponse(char* expectedResponse);
+    ErrorCode SetModeAsync(Mode mode, CompletionCallback callback) override;
 
     /**
-     * @brief Find a given substring in the received UART messages.
-     * @param expectedResponse C-String of the expected substring
+     * @brief Queue a read command of manual or automatic mode. Returns immediately.
+     *
+     * @param callback Called from Loop() with the mode as soon as the request is done.
+     * @return E_OK if the request was queued, otherwise the callback will not be called.
      */
-    ErrorCode findResponseString(char* expectedResponse);
+    ErrorCode GetModeAsync(ModeCallback callback) override;
+
+    /**
+     * @brief Queue a read of the desired temperature and the mode in one session. Returns immediately.
+     *
+     * @param callback Called from Loop() with the desired temperature and the mode as soon as both reads are done.
+     * @return E_OK if the request was queued, otherwise the callback will not be called.
+     */
+    ErrorCode GetStateAsync(StateCallback callback) override;
+
+    /**
+     * @brief Not supported, the memory location of the heating programm is unknown.
+     *
+     * @return E_NOT_OK
+     */
+    ErrorCode GetScheduleAsync(ScheduleCallback callback) override;
+
+    /**
+     * @brief Not supported, the memory location of the heating programm is unknown.
+     *
+     * @return E_NOT_OK
+     */
+    ErrorCode SetScheduleAsync(const WeeklySchedule& schedule, CompletionCallback callback) override;
+
+    /**
+     * @brief Execute read and write commands in one session. The Honeywell is woken up once and the commands
+     *        are sent back-to-back. This is blocking!
+     *
+     * @param batch The commands, the results and read values are stored in it.
+     * @return E_OK if all commands were successful, otherwise the first error.
+     */
+    ErrorCode ExecuteBatch(MemoryBatch& batch);
+
+    /**
+     * @brief Queue read and write commands, which are executed in one session. Returns immediately.
+     *        The Honeywell is woken up once and the commands are sent back-to-back. No other command is sent in between.
+     *        A command which is not answered is repeated with a new wake up, the following commands are executed anyway.
+     *
+     * @param batch The commands.
+     * @param callback Called from Loop() with the results and read values of all commands as soon as the last one is done.
+     * @return E_OK if the batch was queued, otherwise the callback will not be called.
+     */
+    ErrorCode ExecuteBatchAsync(const MemoryBatch& batch, BatchCallback callback);
+
+private:
+    /**
+     * @brief State of a batch, which is executed at the moment.
+     */
+    struct BatchSession
+    {
+        MemoryBatch batch;
+        BatchCallback callback;
+        size_t index{ 0 };
+        bool awake{ false };
+    };
+
+    /**
+     * @brief Queue the next command of a session.
+     * @param session The session.
+     * @param next true to insert the command at the front of the queue, so no other command is sent in between.
+     */
+    ErrorCode queueBatchOperation(const std::shared_ptr<BatchSession>& session, bool next);
+
+    /**
+     * @brief Store the result of the current command of a session and continue with the next one.
+     */
+    void completeBatchOperation(const std::shared_ptr<BatchSession>& session, ErrorCode errorCode, const char* payload, size_t length);
+
+    /**
+     * @brief Run the transaction engine till the queued command is done. This is blocking!
+     * @param queueResult Result of the queue request of the command.
+     * @param result Result of the command, which is set by the callback.
+     */
+    ErrorCode waitForCompletion(ErrorCode queueResult, const ErrorCode& result);
 
     /**
      * @brief EspHome UART Device which is used for serial communication with the Honeywell controller.
      */
     UARTDevice serial_device_;
+
+    /**
+     * @brief Non-blocking transaction engine, which is using serial_device_.
+     */
+    HoneywellTransactionEngine engine_;
 };
 
 /*
@@ -109,83 +307,154 @@ private:
 
 HoneywellManager_HR20_V1::HoneywellManager_HR20_V1(UARTComponent* parent_component)
     : serial_device_(parent_component)
+    , engine_(serial_device_, HR20_V1_WAKEUP_SEQUENCE)
 {
 }
 
 ErrorCode HoneywellManager_HR20_V1::SetDesiredTemperature(int temperature)
 {
-    // TODO: range check of targetTemp
-    ErrorCode retVal              = ErrorCode::E_NOT_OK;
-    constexpr int TEMPERATURE_MIN = 75;
-    constexpr int TEMPERATURE_MAX = 280;
+    ErrorCode retVal = ErrorCode::E_NOT_OK;
 
-    if (TEMPERATURE_MIN <= temperature && TEMPERATURE_MAX >= temperature)
-    {
-        int targetTempOffset                           = temperature - 60; // Offset is 60 (=6° C), Unit is 1/10° C
-        char writeDisplayRAM[WRITE_COMMAND_CHAR_COUNT] = "W13600"; // 0x136 is the memory location of the target Temperature on the Display
-        char writeMotorRam[WRITE_COMMAND_CHAR_COUNT]   = "W20C10"; // 0x20c is the memory location of the target temperatur for the DC Motor
+    return waitForCompletion(SetDesiredTemperatureAsync(temperature, [&retVal](ErrorCode errorCode) { retVal = errorCode; }), retVal);
+}
 
-        char tmp[3]; /* one bytes of hex = 2 characters, plus NULL terminator */
+ErrorCode HoneywellManager_HR20_V1::GetDesiredTemperature(int& temperature)
+{
+    ErrorCode retVal = ErrorCode::E_NOT_OK;
 
-        sprintf(&tmp[0], "%02X", targetTempOffset);
-        strcat(writeDisplayRAM, tmp);
-        strcat(writeMotorRam, tmp);
+    return waitForCompletion(GetDesiredTemperatureAsync([&retVal, &temperature](ErrorCode errorCode, int readTemperature) {
+                                 retVal = errorCode;
 
-        ErrorCode displayResponse = sendToHoneywell(writeDisplayRAM);
-        ErrorCode motorResponse   = sendToHoneywell(writeMotorRam);
+                                 if (ErrorCode::E_OK == errorCode)
+                                 {
+                                     temperature = readTemperature;
+                                 }
+                             }),
+                             retVal);
+}
 
-        if (ErrorCode::E_OK == displayResponse)
-        {
-            if (ErrorCode::E_OK == motorResponse)
-            {
-                retVal = ErrorCode::E_OK;
-            }
-            else
-            {
-                retVal = motorResponse;
-            }
-        }
-        else
-        {
-            retVal = displayResponse;
-        }
-    }
+ErrorCode HoneywellManager_HR20_V1::SetMode(Mode mode)
+{
+    ErrorCode retVal = ErrorCode::E_NOT_OK;
 
-    return retVal;
+    return waitForCompletion(SetModeAsync(mode, [&retVal](ErrorCode errorCode) { retVal = errorCode; }), retVal);
 }
 
-ErrorCode HoneywellManager_HR20_V1::GetDesiredTemperature(int& temperature)
+ErrorCode HoneywellManager_HR20_V1::GetMode(Mode& mode)
 {
     ErrorCode retVal = ErrorCode::E_NOT_OK;
 
-    char readDesiredTemperatureCmd[READ_COMMAND_CHAR_COUNT] = "R136";
-    char readValue[WRITE_COMMAND_CHAR_COUNT];
-    char* pEnd;
+    return waitForCompletion(GetModeAsync([&retVal, &mode](ErrorCode errorCode, Mode readMode) {
+                                 retVal = errorCode;
+
+                                 if (ErrorCode::E_OK == errorCode)
+                                 {
+                                     mode = readMode;
+                                 }
+                             }),
+                             retVal);
+}
+
+void HoneywellManager_HR20_V1::Loop()
+{
+    engine_.Loop();
+}
+
+void HoneywellManager_HR20_V1::SetLoopBudget(uint32_t budgetMs)
+{
+    engine_.SetLoopBudget(budgetMs * 1000u);
+}
+
+void HoneywellManager_HR20_V1::SetRetryPolicy(const RetryPolicy& policy)
+{
+    engine_.SetRetryPolicy(policy);
+}
+
+bool HoneywellManager_HR20_V1::IsAvailable() const
+{
+    return engine_.IsAvailable();
+}
+
+void HoneywellManager_HR20_V1::ResetAvailability(void)
+{
+    engine_.ResetBreaker();
+}
+
+void HoneywellManager_HR20_V1::GetStatistics(HoneywellStatistics& statistics) const
+{
+    statistics = engine_.GetStatistics();
+}
+
+bool HoneywellManager_HR20_V1::IsBusy() const
+{
+    return engine_.IsBusy();
+}
 
-    retVal = readFromHoneywell(readDesiredTemperatureCmd, readValue);
+ErrorCode HoneywellManager_HR20_V1::SetDesiredTemperatureAsync(int temperature, CompletionCallback callback)
+{
+    ErrorCode retVal              = ErrorCode::E_NOT_OK;
+    constexpr int TEMPERATURE_MIN = 75;
+    constexpr int TEMPERATURE_MAX = 280;
 
-    if (ErrorCode::E_OK == retVal)
+    if (TEMPERATURE_MIN <= temperature && TEMPERATURE_MAX >= temperature)
     {
-        char* pEnd;
-        temperature = static_cast<int>(strtol(readValue, &pEnd, 16)) + 60.0;
+        const uint16_t targetTempOffset = static_cast<uint16_t>(temperature - 60); // Offset is 60 (=6° C), Unit is 1/10° C
+        MemoryBatch batch;
+
+        // 0x136 is the memory location of the target Temperature on the Display
+        batch.AddWrite(0x136, targetTempOffset);
+        // 0x20C is the memory location of the target temperatur for the DC Motor
+        batch.AddWrite(0x20C, 0x1000u | targetTempOffset);
+
+        // the motor RAM is written after the display RAM, independent of the display response
+        retVal = ExecuteBatchAsync(batch, [callback](ErrorCode errorCode, const MemoryBatch&) {
+            if (callback)
+            {
+                callback(errorCode);
+            }
+        });
     }
 
     return retVal;
 }
 
-ErrorCode HoneywellManager_HR20_V1::SetMode(Mode mode)
+ErrorCode HoneywellManager_HR20_V1::GetDesiredTemperatureAsync(TemperatureCallback callback)
+{
+    MemoryBatch batch;
+    batch.AddRead(0x136);
+
+    return ExecuteBatchAsync(batch, [callback](ErrorCode errorCode, const MemoryBatch& result) {
+        if (callback)
+        {
+            callback(errorCode, (ErrorCode::E_OK == errorCode) ? (result.operations[0].value + 60) : 0);
+        }
+    });
+}
+
+ErrorCode HoneywellManager_HR20_V1::SetModeAsync(Mode mode, CompletionCallback callback)
 {
     ErrorCode ret_val{ ErrorCode::E_OK };
+    MemoryBatch batch;
 
     if (mode == Mode::E_MANUAL)
     {
-        char command[WRITE_COMMAND_CHAR_COUNT] = "W12B0000";
-        ret_val                                = sendToHoneywell(command);
+        batch.AddWrite(0x12B, 0x0000);
+        ret_val = ExecuteBatchAsync(batch, [callback](ErrorCode errorCode, const MemoryBatch&) {
+            if (callback)
+            {
+                callback(errorCode);
+            }
+        });
     }
     else if (mode == Mode::E_AUTOMATIC)
     {
-        char command[WRITE_COMMAND_CHAR_COUNT] = "W12B0010";
-        ret_val                                = sendToHoneywell(command);
+        batch.AddWrite(0x12B, 0x0010);
+        ret_val = ExecuteBatchAsync(batch, [callback](ErrorCode errorCode, const MemoryBatch&) {
+            if (callback)
+            {
+                callback(errorCode);
+            }
+        });
     }
     else
     {
@@ -196,196 +465,197 @@ ErrorCode HoneywellManager_HR20_V1::SetMode(Mode mode)
     return ret_val;
 }
 
-ErrorCode HoneywellManager_HR20_V1::GetMode(Mode& mode)
+/**
+ * @brief Decode the mode from the value of 0x12B. The high nibble of 0x12C is 1 in automatic and 0 in manual mode.
+ */
+static Mode decodeHR20V1Mode(uint16_t value)
 {
-    ErrorCode retVal = ErrorCode::E_NOT_OK;
+    const uint16_t automaticManualMode = (value >> 4) & 0x0Fu;
+    Mode mode                          = Mode::E_INVALID;
 
-    constexpr uint8_t AUTOMATIC_MANUAL_MODE_BIT{ 2 };
-    char readDesiredTemperatureCmd[READ_COMMAND_CHAR_COUNT] = "R12B";
-    char readValue[WRITE_COMMAND_CHAR_COUNT]                = { 0 };
-    char* pEnd;
+    if (automaticManualMode == 1u)
+    {
+        mode = Mode::E_AUTOMATIC;
+    }
+    else if (automaticManualMode == 0u)
+    {
+        mode = Mode::E_MANUAL;
+    }
 
-    retVal = readFromHoneywell(readDesiredTemperatureCmd, readValue);
+    return mode;
+}
 
-    if (ErrorCode::E_OK == retVal)
-    {
-        if (readValue[AUTOMATIC_MANUAL_MODE_BIT] == '1')
+ErrorCode HoneywellManager_HR20_V1::GetModeAsync(ModeCallback callback)
+{
+    MemoryBatch batch;
+    batch.AddRead(0x12B);
+
+    return ExecuteBatchAsync(batch, [callback](ErrorCode errorCode, const MemoryBatch& result) {
+        if (callback)
         {
-            mode = Mode::E_AUTOMATIC;
+            callback(errorCode, (ErrorCode::E_OK == errorCode) ? decodeHR20V1Mode(result.operations[0].value) : Mode::E_INVALID);
         }
-        else if (readValue[AUTOMATIC_MANUAL_MODE_BIT] == '0')
+    });
+}
+
+ErrorCode HoneywellManager_HR20_V1::GetStateAsync(StateCallback callback)
+{
+    MemoryBatch batch;
+    batch.AddRead(0x136);
+    batch.AddRead(0x12B);
+
+    return ExecuteBatchAsync(batch, [callback](ErrorCode errorCode, const MemoryBatch& result) {
+        if (!callback)
         {
-            mode = Mode::E_MANUAL;
+            return;
+        }
+
+        if (ErrorCode::E_OK == errorCode)
+        {
+            callback(errorCode, result.operations[0].value + 60, decodeHR20V1Mode(result.operations[1].value));
         }
         else
         {
-            mode = Mode::E_INVALID;
+            callback(errorCode, 0, Mode::E_INVALID);
         }
-    }
+    });
+}
 
-    return retVal;
+ErrorCode HoneywellManager_HR20_V1::GetScheduleAsync(ScheduleCallback)
+{
+    return ErrorCode::E_NOT_OK;
 }
 
-/*
- * private functions
- */
+ErrorCode HoneywellManager_HR20_V1::SetScheduleAsync(const WeeklySchedule&, CompletionCallback)
+{
+    return ErrorCode::E_NOT_OK;
+}
 
-void HoneywellManager_HR20_V1::waitForAnyResponse(void)
+ErrorCode HoneywellManager_HR20_V1::ExecuteBatch(MemoryBatch& batch)
 {
-    // send empty commands till Honeywell is responding.
-    for (int i = 0; i < 20; i++)
-    {
-        serial_device_.write_str("K\r\n");
-        serial_device_.flush();
-        delay(50);
+    ErrorCode retVal = ErrorCode::E_NOT_OK;
 
-        if (serial_device_.available())
-        {
-            break;
-        }
-    }
+    return waitForCompletion(ExecuteBatchAsync(batch,
+                                               [&retVal, &batch](ErrorCode errorCode, const MemoryBatch& result) {
+                                                   retVal = errorCode;
+                                                   batch  = result;
+                                               }),
+                             retVal);
+}
 
-    while (serial_device_.available())
+ErrorCode HoneywellManager_HR20_V1::ExecuteBatchAsync(const MemoryBatch& batch, BatchCallback callback)
+{
+    if (batch.count == 0u)
     {
-        // consume response from empty commands
-        serial_device_.read();
+        return ErrorCode::E_NOT_OK;
     }
+
+    // the session is shared by the callbacks of its commands, only one command is queued at a time
+    std::shared_ptr<BatchSession> session = std::make_shared<BatchSession>();
+    session->batch                        = batch;
+    session->callback                     = callback;
+
+    return queueBatchOperation(session, false);
 }
 
-ErrorCode HoneywellManager_HR20_V1::sendToHoneywell(char* command)
+/*
+ * private functions
+ */
+
+ErrorCode HoneywellManager_HR20_V1::queueBatchOperation(const std::shared_ptr<BatchSession>& session, bool next)
 {
-    ErrorCode retVal = ErrorCode::E_NOT_OK;
-    char expectedResponse[WRITE_COMMAND_CHAR_COUNT];
-    constexpr int SEND_RETRIES = 3;
+    const MemoryOperation& operation = session->batch.operations[session->index];
+    UartTransaction transaction;
+    HoneywellFrame<UartTransaction::MAX_REQUEST_LENGTH> request;
+    HoneywellFrame<UartTransaction::MAX_RESPONSE_LENGTH> expectedResponse;
 
-    strcpy(expectedResponse, command);
-    expectedResponse[0] = 'M';
+    if (operation.write)
+    {
+        request.Char('W').Hex(operation.address, 3u, true).Hex(operation.value, 4u, true).Text("\r\n");
 
-    if (0 == strcmp(expectedResponse, "M20C100F"))
+        // the response is an echo of the command
+        expectedResponse.Char('M').Hex(operation.address, 3u, true).Hex(operation.value, 4u, true);
+    }
+    else
     {
-        // change character 7 from 'F' to '0' only for motor command if honeywell is set to OFF
-        expectedResponse[7] = '0';
+        request.Char('R').Hex(operation.address, 3u, true).Text("\r\n");
+        expectedResponse.Char('M').Hex(operation.address, 3u, true);
+        transaction.payloadLength = READ_VALUE_CHAR_COUNT;
     }
 
-    waitForAnyResponse();
+    request.CopyTo(transaction.request);
+    expectedResponse.CopyTo(transaction.expectedResponse);
 
-    for (int i = 0; i < SEND_RETRIES; i++)
+    if (operation.write && (operation.address == 0x20Cu) && (operation.value == 0x100Fu))
     {
-        // send command to Honeywell
-        serial_device_.write_str(command);
-        serial_device_.write('\r');
-        serial_device_.write('\n');
-        serial_device_.flush();
-
-        retVal = checkHoneywellReponse(expectedResponse);
-
-        if (ErrorCode::E_OK == retVal)
-        {
-            break;
-        }
+        // change character 7 from 'F' to '0' only for motor command if honeywell is set to OFF
+        transaction.expectedResponse[7] = '0';
     }
 
-    return retVal;
+    // only the first command wakes up the Honeywell, or the next one after a command was not answered
+    transaction.attempts = engine_.GetRetryPolicy().maxAttempts;
+    transaction.wakeup   = !session->awake;
+    transaction.callback = [this, session](ErrorCode errorCode, const char* payload, size_t length) {
+        completeBatchOperation(session, errorCode, payload, length);
+    };
+
+    return next ? engine_.QueueNext(transaction) : engine_.Queue(transaction);
 }
 
-ErrorCode HoneywellManager_HR20_V1::readFromHoneywell(char* command, char* readValue)
+void HoneywellManager_HR20_V1::completeBatchOperation(const std::shared_ptr<BatchSession>& session, ErrorCode errorCode,
+                                                      const char* payload, size_t length)
 {
-    ErrorCode retVal = ErrorCode::E_NOT_OK;
-    char expectedResponse[READ_COMMAND_CHAR_COUNT];
-    constexpr int SEND_RETRIES = 3;
-    uint8_t readByte           = 0;
-
-    strcpy(expectedResponse, command);
-    expectedResponse[0] = 'M';
-
-    waitForAnyResponse();
+    MemoryOperation& operation = session->batch.operations[session->index];
 
-    for (int i = 0; i < SEND_RETRIES; i++)
+    if ((ErrorCode::E_OK == errorCode) && !operation.write)
     {
-        // send command to Honeywell
-        serial_device_.write_str(command);
-        serial_device_.write('\r');
-        serial_device_.write('\n');
-        serial_device_.flush();
+        uint32_t value{ 0 };
 
-        retVal = checkHoneywellReponse(expectedResponse);
-
-        if (ErrorCode::E_OK == retVal)
+        // the payload is decoded directly in the received frame
+        if ((length == READ_VALUE_CHAR_COUNT) && HoneywellDecoder::DecodeUnsigned(FrameView{ payload, length }, 16u, 0xFFFFu, value))
         {
-            for (size_t i{ 0 }; i < READ_COMMAND_CHAR_COUNT; i++)
-            {
-                if (serial_device_.read_byte(&readByte))
-                {
-                    readValue[i] = static_cast<char>(readByte);
-                }
-                else
-                {
-                    readValue[i] = '\0';
-                    break;
-                }
-            }
-
-            break;
+            operation.value = static_cast<uint16_t>(value);
+        }
+        else
+        {
+            errorCode = ErrorCode::E_RESPONSE_WRONG;
         }
     }
 
-    return retVal;
-}
-
-ErrorCode HoneywellManager_HR20_V1::checkHoneywellReponse(char* expectedResponse)
-{
-    ErrorCode retVal = ErrorCode::E_RESPONSE_TIMEOUT;
-    constexpr uint32_t MAX_RESPONSE_LOOP_CYCLES{ 100 };
+    operation.result = errorCode;
+    session->awake   = (ErrorCode::E_RESPONSE_TIMEOUT != errorCode);
+    ++session->index;
 
-    for (uint32_t i{ 0 }; i < MAX_RESPONSE_LOOP_CYCLES; ++i)
+    // the following commands are executed independent of the result
+    while (session->index < session->batch.count)
     {
-        retVal = findResponseString(expectedResponse);
+        const ErrorCode queueResult = queueBatchOperation(session, true);
 
-        // if the string was found, break the loop. Otherwise sleep and retry it.
-        if (retVal == ErrorCode::E_OK)
+        if (ErrorCode::E_OK == queueResult)
         {
-            break;
-        }
-        else
-        {
-            delay(10);
+            return;
         }
+
+        session->batch.operations[session->index].result = queueResult;
+        ++session->index;
     }
 
-    return retVal;
+    if (session->callback)
+    {
+        session->callback(session->batch.Result(), session->batch);
+    }
 }
 
-ErrorCode HoneywellManager_HR20_V1::findResponseString(char* expectedResponse)
+ErrorCode HoneywellManager_HR20_V1::waitForCompletion(ErrorCode queueResult, const ErrorCode& result)
 {
-    ErrorCode retVal             = ErrorCode::E_RESPONSE_TIMEOUT;
-    uint8_t receivedChar         = 0;
-    size_t expectedResponseIndex = 0;
-
-    if (serial_device_.available())
+    if (ErrorCode::E_OK != queueResult)
     {
-        while (serial_device_.read_byte(&receivedChar))
-        {
-            if (static_cast<char>(receivedChar) == expectedResponse[expectedResponseIndex])
-            {
-                ++expectedResponseIndex;
-
-                // if we reach the end of the expected response string, break the loops
-                if (expectedResponseIndex >= strlen(expectedResponse))
-                {
-                    retVal = ErrorCode::E_OK;
-                    break;
-                }
-            }
-            else
-            {
-                // string are not equal. Start again from beginning.
-                expectedResponseIndex = 0;
-                retVal                = ErrorCode::E_RESPONSE_WRONG;
-            }
-        }
+        return queueResult;
     }
 
-    return retVal;
+    engine_.RunUntilIdle();
+
+    return result;
 }
 
 #endif
@@ -10,17 +10,76 @@
  *
  */
 
+#include "HoneywellCodec.h"
+#include "HoneywellLog.h"
+#include "HoneywellTransactionEngine.h"
 #include "IHoneywellManager.h"
 #include "esphome.h"
 #include <cstdint>
 #include <cstdlib>
-#include <stdio.h>
-#include <stdlib.h>
+#include <functional>
+#include <memory>
+#include <vector>
 #include <string.h>
 
-class HoneywellManager_OpenHR20 : public IHoneywellManager
+class HoneywellManager_OpenHR20 final : public IHoneywellManager
 {
 public:
+    /**
+     * @brief All information of one parsed status line ("D" command) of the thermostat.
+     *        Temperatures are stored in celsius with factor 10 offset (fixed point; e.g.: 225 => 22.5°C).
+     */
+    struct StatusSnapshot
+    {
+        /// @brief manual or automatic mode (mode character after the time stamp)
+        Mode mode{ Mode::E_INVALID };
+
+        /// @brief desired temperature ("S:" field)
+        int desiredTemperature{ 0 };
+
+        /// @brief current temperature ("I:" field)
+        int currentTemperature{ 0 };
+
+        /// @brief battery voltage in unit mV ("B:" field)
+        int batteryVoltage{ 0 };
+
+        /// @brief position of the valve in percent % ("V:" field)
+        int valvePosition{ 0 };
+
+        /// @brief raw status flags of the thermostat ("Is:" field)
+        uint16_t statusFlags{ 0 };
+
+        /// @brief error flags of the thermostat ("E:" field), 0 if no error is reported
+        uint8_t errorFlags{ 0 };
+
+        /// @brief true if the thermostat reported an open window ("W" flag)
+        bool windowOpen{ false };
+
+        /// @brief day of the week of the thermostat clock (1 = monday, ... 7 = sunday)
+        uint8_t weekday{ 0 };
+
+        /// @brief date of the thermostat clock
+        uint8_t day{ 0 };
+        uint8_t month{ 0 };
+        uint8_t year{ 0 };
+
+        /// @brief time of the thermostat clock
+        uint8_t hour{ 0 };
+        uint8_t minute{ 0 };
+        uint8_t second{ 0 };
+
+        /// @brief millis() time stamp when the status line was received
+        uint32_t timestamp{ 0 };
+
+        /// @brief true if the snapshot contains a completely parsed status line
+        bool valid{ false };
+    };
+
+    /**
+     * @brief Callback to report the result of an asynchronous status request.
+     */
+    using StatusSnapshotCallback = std::function<void(ErrorCode errorCode, const StatusSnapshot& snapshot)>;
+
     HoneywellManager_OpenHR20(UARTComponent* uart_component_ptr);
 
     /**
@@ -31,128 +90,969 @@ public:
      */
     ErrorCode SetDesiredTemperature(int temperature) override;
 
-    /**
-     * @brief Get the desired temperature for the radiator thermostat.
-     *
-     * @param temperature Temperature value in celsius and with factor 10 offset (fixed point; e.g.: 225 => 22.5°C)
-     * @return Error code, see enum class definition.
-     */
-    ErrorCode GetDesiredTemperature(int& temperature) override;
+    /**
+     * @brief Get the desired temperature for the radiator thermostat.
+     *
+     * @param temperature Temperature value in celsius and with factor 10 offset (fixed point; e.g.: 225 => 22.5°C)
+     * @return Error code, see enum class definition.
+     */
+    ErrorCode GetDesiredTemperature(int& temperature) override;
+
+    /**
+     * @brief Set manual or automatic mode. In automatic mode the stored heating programm will be used.
+     *
+     * @param mode manual or automatic mode.
+     */
+    ErrorCode SetMode(Mode mode) override;
+
+    /**
+     * @brief Get manual or automatic mode. In automatic mode the stored heating programm will be used.
+     *
+     * @param mode manual or automatic mode.
+     * @return Error code, see enum class definition.
+     */
+    ErrorCode GetMode(Mode& mode) override;
+
+    /**
+     * @brief Advance the asynchronous communication with the thermostat. Shall be called cyclically, e.g. from the ESPHome loop().
+     */
+    void Loop(void) override;
+
+    /**
+     * @brief Limit the time, which one call of Loop() may block. The requests are not flushed with a limit.
+     *
+     * @param budgetMs Max time of one Loop() call in ms, 0 = no limit.
+     */
+    void SetLoopBudget(uint32_t budgetMs) override;
+
+    /// @copydoc IHoneywellManager::SetRetryPolicy
+    void SetRetryPolicy(const RetryPolicy& policy) override;
+
+    /// @copydoc IHoneywellManager::IsAvailable
+    bool IsAvailable(void) const override;
+
+    /**
+     * @brief Let the next request through, also if the thermostat was unavailable. Used before the protocol is probed.
+     */
+    void ResetAvailability(void);
+
+    /// @copydoc IHoneywellManager::GetStatistics
+    void GetStatistics(HoneywellStatistics& statistics) const override;
+
+    /**
+     * @brief Check if asynchronous commands are active or queued.
+     */
+    bool IsBusy(void) const override;
+
+    /**
+     * @brief Queue a command to set the desired temperature for the radiator thermostat. Returns immediately.
+     *
+     * @param temperature Temperature value in celsius and with factor 10 offset (e.g.: 225 => 22.5°C)
+     * @param callback Called from Loop() as soon as a status line reports the written temperature (E_OK), or if it was not
+     *                 applied after all attempts (E_RESPONSE_WRONG). E_NOT_OK if it was replaced before, e.g. by a newer write.
+     * @return E_OK if the command was queued, otherwise the callback will not be called.
+     */
+    ErrorCode SetDesiredTemperatureAsync(int temperature, CompletionCallback callback) override;
+
+    /**
+     * @brief Queue a request of the desired temperature for the radiator thermostat. Returns immediately.
+     *
+     * @param callback Called with the desired temperature as soon as the status snapshot is available.
+     * @return E_OK if the request was queued, otherwise the callback will not be called.
+     */
+    ErrorCode GetDesiredTemperatureAsync(TemperatureCallback callback) override;
+
+    /**
+     * @brief Queue a command to set manual or automatic mode. Returns immediately.
+     *
+     * @param mode manual or automatic mode.
+     * @param callback Called from Loop() as soon as a status line reports the written mode, see SetDesiredTemperatureAsync().
+     * @return E_OK if the command was queued, otherwise the callback will not be called.
+     */
+    ErrorCode SetModeAsync(Mode mode, CompletionCallback callback) override;
+
+    /**
+     * @brief Queue a request of the manual or automatic mode. Returns immediately.
+     *
+     * @param callback Called with the mode as soon as the status snapshot is available.
+     * @return E_OK if the request was queued, otherwise the callback will not be called.
+     */
+    ErrorCode GetModeAsync(ModeCallback callback) override;
+
+    /**
+     * @brief Get the desired temperature and the mode from one status line asynchronously. Returns immediately.
+     *
+     * @param callback Called from Loop() with the desired temperature and the mode as soon as the request is done.
+     * @return E_OK if the request was queued, otherwise the callback will not be called.
+     */
+    ErrorCode GetStateAsync(StateCallback callback) override;
+
+    /**
+     * @brief Read the weekly heating programm ("R" commands) and the preset temperatures ("G" commands) asynchronously.
+     *        All commands are pipelined. Returns immediately.
+     *
+     * @param callback Called from Loop() with the heating programm as soon as all reads are done.
+     * @return E_OK if the request was queued, otherwise the callback will not be called.
+     */
+    ErrorCode GetScheduleAsync(ScheduleCallback callback) override;
+
+    /**
+     * @brief Write the weekly heating programm ("W" commands) and the preset temperatures ("S" commands) asynchronously.
+     *        All commands are pipelined and every echo of the thermostat is compared with the written value. Returns immediately.
+     *
+     * @param schedule The new heating programm. Preset temperatures 5.0°C ... 30.0°C in steps of 0.5°C.
+     * @param callback Called from Loop() as soon as all writes are confirmed or failed.
+     * @return E_OK if the command was queued, E_NOT_OK if the schedule is invalid. Otherwise the callback will not be called.
+     */
+    ErrorCode SetScheduleAsync(const WeeklySchedule& schedule, CompletionCallback callback) override;
+
+    /**
+     * @brief Read the weekly heating programm and the preset temperatures. This is blocking!
+     *
+     * @param schedule The read heating programm.
+     * @return Error code, see enum class definition.
+     */
+    ErrorCode GetSchedule(WeeklySchedule& schedule);
+
+    /**
+     * @brief Write the weekly heating programm and the preset temperatures. This is blocking!
+     *
+     * @param schedule The new heating programm.
+     * @return Error code, see enum class definition.
+     */
+    ErrorCode SetSchedule(const WeeklySchedule& schedule);
+
+    /**
+     * @brief Get the current temperature for the radiator thermostat.
+     *
+     * @param temperature Temperature value in celsius and with factor 10 offset (fixed point; e.g.: 225 => 22.5°C)
+     * @return Error code, see enum class definition.
+     */
+    ErrorCode GetCurrentTemperature(int& temperature);
+
+    /**
+     * @brief Get the current battery voltage
+     *
+     * @param voltage The voltage value of the batteries in unit mV.
+     * @return Error code, see enum class definition.
+     */
+    ErrorCode GetCurrentBatteryVoltage(int& voltage);
+
+    /**
+     * @brief Current position of the valve
+     *
+     * @param valvePosition The position of the valve in percent %.
+     * @return Error code, see enum class definition.
+     */
+    ErrorCode GetValvePosition(int& valvePosition);
+
+    /**
+     * @brief Get the complete status of the thermostat.
+     *        A new status line is only requested from the thermostat, if the cached snapshot is older than maxAgeMs.
+     *
+     * @param snapshot Parsed status of the thermostat.
+     * @param maxAgeMs Maximum age of the cached snapshot in ms. Use 0 to force a new request.
+     * @return Error code, see enum class definition.
+     */
+    ErrorCode GetStatusSnapshot(StatusSnapshot& snapshot, uint32_t maxAgeMs = STATUS_SNAPSHOT_MAX_AGE_MS);
+
+    /**
+     * @brief Request one status line ("D" command) from the thermostat and store it as cached snapshot.
+     *
+     * @return Error code, see enum class definition.
+     */
+    ErrorCode RefreshStatusSnapshot(void);
+
+    /**
+     * @brief Get the complete status of the thermostat asynchronously. Returns immediately.
+     *        If the cached snapshot is not older than maxAgeMs, the callback is called immediately.
+     *        Requests of several callers are merged into one "D" request.
+     *
+     * @param callback Called with the parsed status as soon as it is available.
+     * @param maxAgeMs Maximum age of the cached snapshot in ms. Use 0 to force a new request.
+     * @return E_OK if the request was queued, otherwise the callback will not be called.
+     */
+    ErrorCode GetStatusSnapshotAsync(StatusSnapshotCallback callback, uint32_t maxAgeMs = STATUS_SNAPSHOT_MAX_AGE_MS);
+
+    /**
+     * @brief Enable or disable the passive listen mode.
+     *        The OpenHR20 firmware prints status lines on its own, when the state changes and at its periodic wake ups.
+     *        In listen mode these unsolicited status lines are parsed and stored as cached snapshot, instead of being discarded.
+     *
+     * @param enabled true to parse unsolicited status lines.
+     */
+    void SetListenMode(bool enabled);
+
+    /**
+     * @brief Check if unsolicited status lines are parsed.
+     */
+    bool IsListenMode(void) const { return listen_mode_; }
+
+    /**
+     * @brief Set an observer, which is called for every new valid status snapshot.
+     *        This includes requested status lines and unsolicited status lines in listen mode.
+     *
+     * @param observer Observer or nullptr.
+     */
+    void SetStatusObserver(StatusSnapshotCallback observer) { status_observer_ = observer; }
+
+    /**
+     * @brief Mark the cached snapshot as outdated, e.g. after a command changed the state of the thermostat.
+     */
+    void InvalidateStatusSnapshot(void);
+
+    /**
+     * @brief Check if a written temperature or mode is not confirmed by a status line yet.
+     */
+    bool IsReconciling(void) const { return reconcile_.temperaturePending || reconcile_.modePending; }
+
+    /**
+     * @brief Parse a status line of the thermostat.
+     *
+     * @param line Status line, starting after the "D: " prefix. Must not be null terminated.
+     * @param length Number of characters of the status line.
+     * @param snapshot Parsed status. The time stamp is not modified.
+     * @return Error code, see enum class definition.
+     */
+    static ErrorCode ParseStatusLine(const char* line, size_t length, StatusSnapshot& snapshot);
+
+    /// @brief Default maximum age of the cached status snapshot, till a new status line is requested.
+    static constexpr uint32_t STATUS_SNAPSHOT_MAX_AGE_MS{ 2000 };
+
+    /// @brief Maximum length of a status line after the "D: " prefix.
+    static constexpr size_t MAX_STATUS_LINE_LENGTH{ 127 };
+
+    /// @brief Range of the temperatures of a status line in 1/10 °C, other values are treated as corrupted line.
+    static constexpr int32_t TEMPERATURE_FIELD_MIN{ -400 };
+    static constexpr int32_t TEMPERATURE_FIELD_MAX{ 990 };
+
+    /// @brief Time after a write command, till a status line is requested to verify it (if none was received till then).
+    static constexpr uint32_t RECONCILE_VERIFY_DELAY_MS{ 1000 };
+
+    /// @brief Number of verifications of a written state, till differences are no longer resent.
+    static constexpr uint8_t MAX_RECONCILE_ATTEMPTS{ 3 };
+
+private:
+    /**
+     * @brief State of a read or write of the whole heating programm.
+     */
+    struct ScheduleSession
+    {
+        WeeklySchedule schedule;
+        ScheduleCallback callback;
+        bool write{ false };
+
+        /// @brief Index of the next command, which is queued
+        size_t next{ 0 };
+
+        /// @brief Number of queued commands, which are not done yet
+        size_t outstanding{ 0 };
+
+        /// @brief First error of all commands
+        ErrorCode result{ ErrorCode::E_OK };
+    };
+
+    /**
+     * @brief Written state, which is compared with the next status lines till the thermostat reports it.
+     *        The write commands are not confirmed by the OpenHR20 firmware, so lost bytes are only noticed this way.
+     */
+    struct ReconcileState
+    {
+        /// @brief The desired temperature was written, but not reported by a status line yet
+        bool temperaturePending{ false };
+
+        /// @brief Written desired temperature (rounded to 0.5°C steps)
+        int temperature{ 0 };
+
+        /// @brief Called as soon as the written desired temperature is reported or dropped
+        CompletionCallback temperatureCallback;
+
+        /// @brief The mode was written, but not reported by a status line yet
+        bool modePending{ false };
+
+        /// @brief Written mode
+        Mode mode{ Mode::E_INVALID };
+
+        /// @brief Called as soon as the written mode is reported or dropped
+        CompletionCallback modeCallback;
+
+        /// @brief Write commands, which are queued or active. Status lines are not compared meanwhile.
+        uint8_t outstandingWrites{ 0 };
+
+        /// @brief Verifications with a difference or without a status line
+        uint8_t attempts{ 0 };
+
+        /// @brief millis() time stamp when the last write command was done
+        uint32_t lastWriteMs{ 0 };
+
+        /// @brief A status line is requested to verify the written state
+        bool verifying{ false };
+    };
+
+    /// @brief Number of commands of a whole heating programm: one per preset temperature and one per switching time
+    static constexpr size_t SCHEDULE_COMMAND_COUNT{ WeeklySchedule::PRESETS + (WeeklySchedule::DAYS * WeeklySchedule::SLOTS_PER_DAY) };
+
+    /// @brief EEPROM address of the first preset temperature
+    static constexpr uint8_t PRESET_EEPROM_ADDRESS{ 0x01 };
+
+    /**
+     * @brief Queue the next commands of a schedule session, till the pipeline is full.
+     * @return Error code of the queue, if no command of the session is outstanding.
+     */
+    ErrorCode fillSchedulePipeline(const std::shared_ptr<ScheduleSession>& session);
+
+    /**
+     * @brief Store the result of one command of a schedule session and continue with the next ones.
+     */
+    void completeScheduleCommand(const std::shared_ptr<ScheduleSession>& session, size_t index, ErrorCode errorCode, const char* payload,
+                                 size_t length);
+
+    /**
+     * @brief Queue a command, which is not confirmed by the thermostat.
+     *
+     * @param command C-String of the command.
+     * @param callback Called from Loop() as soon as the command is sent.
+     * @return Error code, see enum class definition.
+     */
+    ErrorCode queueCommand(const char* command, CompletionCallback callback);
+
+    /**
+     * @brief Check and round a desired temperature, queue the "A" command and reconcile it with the next status lines.
+     *
+     * @param sentCallback Called as soon as the command is sent.
+     * @param confirmedCallback Called as soon as a status line reports the written temperature.
+     */
+    ErrorCode writeDesiredTemperature(int temperature, CompletionCallback sentCallback, CompletionCallback confirmedCallback);
+
+    /**
+     * @brief Queue the "M" command and reconcile it with the next status lines, see writeDesiredTemperature().
+     */
+    ErrorCode writeMode(Mode mode, CompletionCallback sentCallback, CompletionCallback confirmedCallback);
+
+    /**
+     * @brief Call and remove the callback of a written field, the callback is allowed to write again.
+     */
+    static void completeWrite(CompletionCallback& callback, ErrorCode errorCode);
+
+    /**
+     * @brief Queue the "A" command with a desired temperature, which was checked and rounded already.
+     */
+    ErrorCode sendDesiredTemperature(int temperature, CompletionCallback callback);
+
+    /**
+     * @brief Queue the "M" command with a valid mode.
+     */
+    ErrorCode sendMode(Mode mode, CompletionCallback callback);
+
+    /**
+     * @brief Queue a write command of the reconciled state. Status lines are not compared, till the command is done.
+     */
+    ErrorCode queueWriteCommand(const char* command, CompletionCallback callback);
+
+    /**
+     * @brief Request a status line, if a written state is not confirmed some time after the last write command.
+     */
+    void verifyWrittenState(void);
+
+    /**
+     * @brief Compare the written state with a new status line and resend only the fields, which differ.
+     *
+     * @param snapshot The new valid status snapshot.
+     */
+    void reconcileWrittenState(const StatusSnapshot& snapshot);
+
+    /**
+     * @brief Count a verification, which did not confirm the written state.
+     * @return false if all attempts are used up, the written state is dropped and its callbacks get E_RESPONSE_WRONG then.
+     */
+    bool consumeReconcileAttempt(void);
+
+    /**
+     * @brief Parse the received status line and report it to all waiting callers.
+     *
+     * @param errorCode Result of the status transaction.
+     * @param line Received status line after the "D: " prefix.
+     * @param length Number of received characters.
+     */
+    void completeStatusRequest(ErrorCode errorCode, const char* line, size_t length);
+
+    /**
+     * @brief Parse an unsolicited line of the thermostat in listen mode.
+     *
+     * @param frame The received line.
+     */
+    void handleUnsolicitedFrame(const FrameView& frame);
+
+    /**
+     * @brief Store a new valid snapshot and report it to the observer.
+     *
+     * @param snapshot The parsed snapshot, the time stamp is set.
+     */
+    void storeStatusSnapshot(StatusSnapshot& snapshot);
+
+    /**
+     * @brief Uart device definded by the ESPHome implementation. API is similar to Arduino Serial.
+     */
+    UARTDevice serial_device_;
+
+    /**
+     * @brief Non-blocking transaction engine, which is using serial_device_.
+     */
+    HoneywellTransactionEngine engine_;
+
+    /**
+     * @brief Callers which are waiting for the active status request.
+     */
+    std::vector<StatusSnapshotCallback> pending_status_callbacks_;
+
+    /**
+     * @brief Observer of all new valid snapshots.
+     */
+    StatusSnapshotCallback status_observer_;
+
+    /**
+     * @brief Last received status of the thermostat.
+     */
+    StatusSnapshot status_snapshot_;
+
+    /**
+     * @brief Written state, which is not confirmed by a status line yet.
+     */
+    ReconcileState reconcile_;
+
+    /**
+     * @brief Unsolicited status lines are parsed.
+     */
+    bool listen_mode_{ false };
+};
+
+// Constants
+
+/// @brief Send an empty line and wait till all pending output of the thermostat is received.
+constexpr WakeupSequence OPEN_HR20_WAKEUP_SEQUENCE{ "\n", 100u, 1u };
+
+HoneywellManager_OpenHR20::HoneywellManager_OpenHR20(UARTComponent* uart_component_ptr)
+    : serial_device_(uart_component_ptr)
+    , engine_(serial_device_, OPEN_HR20_WAKEUP_SEQUENCE)
+{
+}
+
+ErrorCode HoneywellManager_OpenHR20::SetDesiredTemperature(int temperature)
+{
+    // returns as soon as the command is sent, the confirmation by a status line is not awaited
+    ErrorCode retVal = writeDesiredTemperature(temperature, [&retVal](ErrorCode errorCode) { retVal = errorCode; }, nullptr);
+
+    if (retVal == ErrorCode::E_OK)
+    {
+        engine_.RunUntilIdle();
+    }
+
+    return retVal;
+}
+
+ErrorCode HoneywellManager_OpenHR20::SetMode(Mode mode)
+{
+    ErrorCode retVal = writeMode(mode, [&retVal](ErrorCode errorCode) { retVal = errorCode; }, nullptr);
+
+    if (retVal == ErrorCode::E_OK)
+    {
+        engine_.RunUntilIdle();
+    }
+
+    return retVal;
+}
+
+void HoneywellManager_OpenHR20::Loop()
+{
+    engine_.Loop();
+    verifyWrittenState();
+}
+
+void HoneywellManager_OpenHR20::SetLoopBudget(uint32_t budgetMs)
+{
+    engine_.SetLoopBudget(budgetMs * 1000u);
+}
+
+void HoneywellManager_OpenHR20::SetRetryPolicy(const RetryPolicy& policy)
+{
+    engine_.SetRetryPolicy(policy);
+}
+
+bool HoneywellManager_OpenHR20::IsAvailable() const
+{
+    return engine_.IsAvailable();
+}
+
+void HoneywellManager_OpenHR20::ResetAvailability(void)
+{
+    engine_.ResetBreaker();
+}
+
+void HoneywellManager_OpenHR20::GetStatistics(HoneywellStatistics& statistics) const
+{
+    statistics = engine_.GetStatistics();
+}
+
+bool HoneywellManager_OpenHR20::IsBusy() const
+{
+    return engine_.IsBusy();
+}
+
+ErrorCode HoneywellManager_OpenHR20::SetDesiredTemperatureAsync(int temperature, CompletionCallback callback)
+{
+    return writeDesiredTemperature(temperature, nullptr, callback);
+}
+
+ErrorCode HoneywellManager_OpenHR20::GetDesiredTemperatureAsync(TemperatureCallback callback)
+{
+    return GetStatusSnapshotAsync([callback](ErrorCode errorCode, const StatusSnapshot& snapshot) {
+        callback(errorCode, snapshot.desiredTemperature);
+    });
+}
+
+ErrorCode HoneywellManager_OpenHR20::SetModeAsync(Mode mode, CompletionCallback callback)
+{
+    return writeMode(mode, nullptr, callback);
+}
+
+ErrorCode HoneywellManager_OpenHR20::GetModeAsync(ModeCallback callback)
+{
+    return GetStatusSnapshotAsync([callback](ErrorCode errorCode, const StatusSnapshot& snapshot) {
+        callback(errorCode, (errorCode == ErrorCode::E_OK) ? snapshot.mode : Mode::E_INVALID);
+    });
+}
+
+ErrorCode HoneywellManager_OpenHR20::GetStateAsync(StateCallback callback)
+{
+    return GetStatusSnapshotAsync([callback](ErrorCode errorCode, const StatusSnapshot& snapshot) {
+        if (errorCode == ErrorCode::E_OK)
+        {
+            callback(errorCode, snapshot.desiredTemperature, snapshot.mode);
+        }
+        else
+        {
+            callback(errorCode, 0, Mode::E_INVALID);
+        }
+    });
+}
+
+ErrorCode HoneywellManager_OpenHR20::GetMode(Mode& mode)
+{
+    StatusSnapshot snapshot;
+    ErrorCode retVal = GetStatusSnapshot(snapshot);
+
+    if (retVal == ErrorCode::E_OK)
+    {
+        mode = snapshot.mode;
+    }
+    else
+    {
+        mode = Mode::E_INVALID;
+    }
+
+    return retVal;
+}
+
+ErrorCode HoneywellManager_OpenHR20::GetDesiredTemperature(int& temperature)
+{
+    StatusSnapshot snapshot;
+    ErrorCode retVal = GetStatusSnapshot(snapshot);
+
+    if (retVal == ErrorCode::E_OK)
+    {
+        temperature = snapshot.desiredTemperature;
+    }
+
+    return retVal;
+}
+
+ErrorCode HoneywellManager_OpenHR20::GetCurrentTemperature(int& temperature)
+{
+    StatusSnapshot snapshot;
+    ErrorCode retVal = GetStatusSnapshot(snapshot);
+
+    if (retVal == ErrorCode::E_OK)
+    {
+        temperature = snapshot.currentTemperature;
+    }
+
+    return retVal;
+}
+
+ErrorCode HoneywellManager_OpenHR20::GetCurrentBatteryVoltage(int& voltage)
+{
+    StatusSnapshot snapshot;
+    ErrorCode retVal = GetStatusSnapshot(snapshot);
+
+    if (retVal == ErrorCode::E_OK)
+    {
+        voltage = snapshot.batteryVoltage;
+    }
+
+    return retVal;
+}
+
+ErrorCode HoneywellManager_OpenHR20::GetValvePosition(int& valvePosition)
+{
+    StatusSnapshot snapshot;
+    ErrorCode retVal = GetStatusSnapshot(snapshot);
+
+    if (retVal == ErrorCode::E_OK)
+    {
+        valvePosition = snapshot.valvePosition;
+    }
+
+    return retVal;
+}
+
+ErrorCode HoneywellManager_OpenHR20::GetStatusSnapshot(StatusSnapshot& snapshot, uint32_t maxAgeMs)
+{
+    ErrorCode retVal = GetStatusSnapshotAsync(
+        [&retVal, &snapshot](ErrorCode errorCode, const StatusSnapshot& receivedSnapshot) {
+            retVal   = errorCode;
+            snapshot = receivedSnapshot;
+        },
+        maxAgeMs);
+
+    if (retVal == ErrorCode::E_OK)
+    {
+        engine_.RunUntilIdle();
+    }
+
+    return retVal;
+}
+
+ErrorCode HoneywellManager_OpenHR20::RefreshStatusSnapshot()
+{
+    StatusSnapshot snapshot;
+
+    return GetStatusSnapshot(snapshot, 0u);
+}
+
+ErrorCode HoneywellManager_OpenHR20::GetStatusSnapshotAsync(StatusSnapshotCallback callback, uint32_t maxAgeMs)
+{
+    ErrorCode retVal = ErrorCode::E_OK;
+
+    if (status_snapshot_.valid && ((millis() - status_snapshot_.timestamp) < maxAgeMs))
+    {
+        callback(ErrorCode::E_OK, status_snapshot_);
+    }
+    else
+    {
+        pending_status_callbacks_.push_back(callback);
+
+        // only the first caller sends the request, all others are waiting for the same status line
+        if (pending_status_callbacks_.size() == 1u)
+        {
+            UartTransaction transaction;
+            strcpy(transaction.request, "D\n");
+            strcpy(transaction.expectedResponse, "D: ");
+            transaction.payloadLength     = MAX_STATUS_LINE_LENGTH;
+            transaction.responseTimeoutMs = 100u;
+            transaction.attempts          = engine_.GetRetryPolicy().maxAttempts;
+            transaction.wakeup            = true;
+            transaction.callback          = [this](ErrorCode errorCode, const char* payload, size_t length) {
+                completeStatusRequest(errorCode, payload, length);
+            };
+
+            retVal = engine_.Queue(transaction);
+
+            if (retVal != ErrorCode::E_OK)
+            {
+                pending_status_callbacks_.clear();
+            }
+        }
+    }
+
+    return retVal;
+}
+
+ErrorCode HoneywellManager_OpenHR20::GetScheduleAsync(ScheduleCallback callback)
+{
+    std::shared_ptr<ScheduleSession> session = std::make_shared<ScheduleSession>();
+    session->callback                        = callback;
+
+    return fillSchedulePipeline(session);
+}
+
+ErrorCode HoneywellManager_OpenHR20::SetScheduleAsync(const WeeklySchedule& schedule, CompletionCallback callback)
+{
+    constexpr int TEMPERATURE_MIN = 50;
+    constexpr int TEMPERATURE_MAX = 300;
+
+    for (uint8_t preset = 0; preset < WeeklySchedule::PRESETS; ++preset)
+    {
+        const int temperature = schedule.presetTemperatures[preset];
+
+        if ((temperature < TEMPERATURE_MIN) || (temperature > TEMPERATURE_MAX) || ((temperature % 5) != 0))
+        {
+            return ErrorCode::E_NOT_OK;
+        }
+    }
+
+    for (uint8_t day = 0; day < WeeklySchedule::DAYS; ++day)
+    {
+        for (uint8_t slot = 0; slot < WeeklySchedule::SLOTS_PER_DAY; ++slot)
+        {
+            const WeeklySchedule::Slot& entry = schedule.slots[day][slot];
+
+            if ((entry.preset >= WeeklySchedule::PRESETS) || ((entry.minutes >= (24u * 60u)) && (entry.minutes != WeeklySchedule::SLOT_DISABLED)))
+            {
+                return ErrorCode::E_NOT_OK;
+            }
+        }
+    }
+
+    std::shared_ptr<ScheduleSession> session = std::make_shared<ScheduleSession>();
+    session->schedule                        = schedule;
+    session->write                           = true;
+    session->callback                        = [this, callback](ErrorCode errorCode, const WeeklySchedule&) {
+        // the desired temperature in automatic mode depends on the heating programm
+        InvalidateStatusSnapshot();
+        callback(errorCode);
+    };
+
+    return fillSchedulePipeline(session);
+}
+
+ErrorCode HoneywellManager_OpenHR20::GetSchedule(WeeklySchedule& schedule)
+{
+    ErrorCode retVal = GetScheduleAsync([&retVal, &schedule](ErrorCode errorCode, const WeeklySchedule& readSchedule) {
+        retVal   = errorCode;
+        schedule = readSchedule;
+    });
+
+    if (retVal == ErrorCode::E_OK)
+    {
+        engine_.RunUntilIdle();
+    }
+
+    return retVal;
+}
+
+ErrorCode HoneywellManager_OpenHR20::SetSchedule(const WeeklySchedule& schedule)
+{
+    ErrorCode retVal = SetScheduleAsync(schedule, [&retVal](ErrorCode errorCode) { retVal = errorCode; });
+
+    if (retVal == ErrorCode::E_OK)
+    {
+        engine_.RunUntilIdle();
+    }
+
+    return retVal;
+}
+
+void HoneywellManager_OpenHR20::InvalidateStatusSnapshot()
+{
+    status_snapshot_.valid = false;
+}
+
+void HoneywellManager_OpenHR20::SetListenMode(bool enabled)
+{
+    listen_mode_ = enabled;
+
+    if (enabled)
+    {
+        engine_.SetFrameListener([this](const FrameView& frame) { handleUnsolicitedFrame(frame); });
+    }
+    else
+    {
+        engine_.SetFrameListener(nullptr);
+    }
+}
+
+ErrorCode HoneywellManager_OpenHR20::ParseStatusLine(const char* line, size_t length, StatusSnapshot& snapshot)
+{
+    // Example of a status line (after the "D: " prefix):
+    // "d6 10.01.14 22:01:49 M V: 39 I: 2150 S: 2200 B: 3035 Is: 00b9 X"
+    // The temperatures are reported in 1/100 °C and will be converted to 1/10 °C.
+    // All fields are parsed directly from the received frame, nothing is copied.
+    const FrameView status{ line, length };
+    bool hasDesiredTemperature{ false };
+    bool hasCurrentTemperature{ false };
+    size_t position{ 0 };
+    size_t fieldPosition{ 0 };
+    uint32_t value{ 0 };
+    int32_t temperature{ 0 };
+    uint32_t weekday{ 0 };
+    uint32_t date[3]{};
+    uint32_t time[3]{};
+
+    // upper bounds of day, month, year and of hour, minute, second
+    static constexpr uint32_t DATE_MAX[3]{ 31, 12, 99 };
+    static constexpr uint32_t TIME_MAX[3]{ 23, 59, 59 };
+
+    if (length > MAX_STATUS_LINE_LENGTH)
+    {
+        return ErrorCode::E_READ_BUF_OVERFLOW;
+    }
+
+    // fixed header: weekday, date, time and mode
+    const FrameView weekdayField = status.NextToken(position);
+    const FrameView dateField    = status.NextToken(position);
+    const FrameView timeField    = status.NextToken(position);
+    const FrameView modeField    = status.NextToken(position);
 
-    /**
-     * @brief Set manual or automatic mode. In automatic mode the stored heating programm will be used.
-     *
-     * @param mode manual or automatic mode.
-     */
-    ErrorCode SetMode(Mode mode) override;
+    if ((weekdayField.At(0) != 'd') || !HoneywellDecoder::DecodeUnsigned(weekdayField.SubView(1), 10u, 7u, weekday)
+        || (modeField.length != 1u))
+    {
+        return ErrorCode::E_RESPONSE_WRONG;
+    }
 
-    /**
-     * @brief Get manual or automatic mode. In automatic mode the stored heating programm will be used.
-     *
-     * @param mode manual or automatic mode.
-     * @return Error code, see enum class definition.
-     */
-    ErrorCode GetMode(Mode& mode) override;
+    for (size_t i = 0; i < 3u; ++i)
+    {
+        if (!HoneywellDecoder::DecodeUnsigned(dateField.NextToken(fieldPosition, '.'), 10u, DATE_MAX[i], date[i]))
+        {
+            return ErrorCode::E_RESPONSE_WRONG;
+        }
+    }
 
-    /**
-     * @brief Get the current temperature for the radiator thermostat.
-     *
-     * @param temperature Temperature value in celsius and with factor 10 offset (fixed point; e.g.: 225 => 22.5°C)
-     * @return Error code, see enum class definition.
-     */
-    ErrorCode GetCurrentTemperature(int& temperature);
+    fieldPosition = 0;
+    for (size_t i = 0; i < 3u; ++i)
+    {
+        if (!HoneywellDecoder::DecodeUnsigned(timeField.NextToken(fieldPosition, ':'), 10u, TIME_MAX[i], time[i]))
+        {
+            return ErrorCode::E_RESPONSE_WRONG;
+        }
+    }
 
-    /**
-     * @brief Get the current battery voltage
-     *
-     * @param voltage The voltage value of the batteries in unit mV.
-     * @return Error code, see enum class definition.
-     */
-    ErrorCode GetCurrentBatteryVoltage(int& voltage);
+    snapshot.weekday = static_cast<uint8_t>(weekday);
+    snapshot.day     = static_cast<uint8_t>(date[0]);
+    snapshot.month   = static_cast<uint8_t>(date[1]);
+    snapshot.year    = static_cast<uint8_t>(date[2]);
+    snapshot.hour    = static_cast<uint8_t>(time[0]);
+    snapshot.minute  = static_cast<uint8_t>(time[1]);
+    snapshot.second  = static_cast<uint8_t>(time[2]);
 
-    /**
-     * @brief Current position of the valve
-     *
-     * @param valvePosition The position of the valve in percent %.
-     * @return Error code, see enum class definition.
-     */
-    ErrorCode GetValvePosition(int& valvePosition);
+    if (modeField.At(0) == 'A')
+    {
+        snapshot.mode = Mode::E_AUTOMATIC;
+    }
+    else if (modeField.At(0) == 'M')
+    {
+        snapshot.mode = Mode::E_MANUAL;
+    }
+    else
+    {
+        snapshot.mode = Mode::E_INVALID;
+    }
 
-private:
-    /**
-     * @brief Flush everything from the input uart buffer.
-     */
-    void flushInputBuffer(void);
+    // all following fields are separated by spaces. Fields with a value are "<key>: <value>", flags are single tokens.
+    for (FrameView key = status.NextToken(position); !key.IsEmpty(); key = status.NextToken(position))
+    {
+        if ((key.length > 1u) && (key.At(key.length - 1u) == ':'))
+        {
+            const FrameView field = status.NextToken(position);
 
-    /**
-     * @brief Extract one part of the status message from the thermostat
-     *
-     * @param startTerminatorStr The start terminator string of the status message, after which the data of intrest follwes.
-     * @param startByte The number of byte after startTerminatorStr, from which the data shall be extracted.
-     * @param dataBufferStr Buffer for the data bytes to extract (Null terminated).
-     * @param dataLength Length of the data to extract.
-     * @return Error code, see enum class definition.
-     */
-    ErrorCode extractStatusInformation(const char* startTerminatorStr, const uint8_t startByte, char* dataBufferStr,
-                                       const uint8_t dataLength);
+            if (key.Equals("V:") && HoneywellDecoder::DecodeUnsigned(field, 10u, 100u, value))
+            {
+                snapshot.valvePosition = static_cast<int>(value);
+            }
+            else if (key.Equals("I:")
+                     && HoneywellDecoder::DecodeFixedPoint(field, 10u, TEMPERATURE_FIELD_MIN, TEMPERATURE_FIELD_MAX, temperature))
+            {
+                snapshot.currentTemperature = static_cast<int>(temperature);
+                hasCurrentTemperature       = true;
+            }
+            else if (key.Equals("S:")
+                     && HoneywellDecoder::DecodeFixedPoint(field, 10u, TEMPERATURE_FIELD_MIN, TEMPERATURE_FIELD_MAX, temperature))
+            {
+                snapshot.desiredTemperature = static_cast<int>(temperature);
+                hasDesiredTemperature       = true;
+            }
+            else if (key.Equals("B:") && HoneywellDecoder::DecodeUnsigned(field, 10u, 9999u, value))
+            {
+                snapshot.batteryVoltage = static_cast<int>(value);
+            }
+            else if (key.Equals("Is:") && HoneywellDecoder::DecodeUnsigned(field, 16u, 0xFFFFu, value))
+            {
+                snapshot.statusFlags = static_cast<uint16_t>(value);
+            }
+            else if (key.Equals("E:") && HoneywellDecoder::DecodeUnsigned(field, 16u, 0xFFu, value))
+            {
+                snapshot.errorFlags = static_cast<uint8_t>(value);
+            }
+            else
+            {
+                // unknown field, ignore it
+            }
+        }
+        else if (key.Equals("W"))
+        {
+            snapshot.windowOpen = true;
+        }
+        else
+        {
+            // unknown flag, ignore it
+        }
+    }
 
-    /**
-     * @brief Find a given string in the received uart response
-     * @param expectedResponse String of the expected response
-     * @return Error code, see enum class definition.
-     */
-    ErrorCode findResponseString(const char* expectedResponse);
+    snapshot.valid = hasDesiredTemperature && hasCurrentTemperature;
 
-    /**
-     * @brief Uart device definded by the ESPHome implementation. API is similar to Arduino Serial.
-     */
-    UARTDevice serial_device_;
-};
+    return snapshot.valid ? ErrorCode::E_OK : ErrorCode::E_RESPONSE_WRONG;
+}
 
-// Constants
+/*
+// private functions
+*/
 
-HoneywellManager_OpenHR20::HoneywellManager_OpenHR20(UARTComponent* uart_component_ptr)
-    : serial_device_(uart_component_ptr)
+ErrorCode HoneywellManager_OpenHR20::queueCommand(const char* command, CompletionCallback callback)
 {
+    UartTransaction transaction;
+
+    strncpy(transaction.request, command, UartTransaction::MAX_REQUEST_LENGTH - 1u);
+    transaction.wakeup   = false;
+    transaction.callback = [this, callback](ErrorCode errorCode, const char*, size_t) {
+        // the state of the thermostat was changed by the command
+        InvalidateStatusSnapshot();
+
+        if (callback)
+        {
+            callback(errorCode);
+        }
+    };
+
+    return engine_.Queue(transaction);
 }
 
-ErrorCode HoneywellManager_OpenHR20::SetDesiredTemperature(int temperature)
+ErrorCode HoneywellManager_OpenHR20::writeDesiredTemperature(int temperature, CompletionCallback sentCallback,
+                                                              CompletionCallback confirmedCallback)
 {
     ErrorCode retVal              = ErrorCode::E_NOT_OK;
     constexpr int TEMPERATURE_MIN = 75;
     constexpr int TEMPERATURE_MAX = 280;
-    char buffer[10];
 
     if ((TEMPERATURE_MIN <= temperature) && (TEMPERATURE_MAX >= temperature))
     {
         // only 0.5°C steps are allowed --> always round down
         temperature = temperature - (temperature % 5);
 
-        int n = sprintf(buffer, "\nA%x\n", temperature / 5);
-        if (n > 0)
+        retVal = sendDesiredTemperature(temperature, sentCallback);
+
+        if (retVal == ErrorCode::E_OK)
         {
-            serial_device_.write_str(buffer);
-            serial_device_.flush();
-            retVal = ErrorCode::E_OK;
+            CompletionCallback replacedCallback;
+            replacedCallback.swap(reconcile_.temperatureCallback);
+
+            reconcile_.temperaturePending  = true;
+            reconcile_.temperature         = temperature;
+            reconcile_.temperatureCallback = confirmedCallback;
+            reconcile_.attempts            = 0;
+
+            completeWrite(replacedCallback, ErrorCode::E_NOT_OK);
         }
     }
 
     return retVal;
 }
 
-ErrorCode HoneywellManager_OpenHR20::SetMode(Mode mode)
+ErrorCode HoneywellManager_OpenHR20::writeMode(Mode mode, CompletionCallback sentCallback, CompletionCallback confirmedCallback)
 {
-    ErrorCode ret_val{ ErrorCode::E_OK };
+    ErrorCode ret_val{ ErrorCode::E_NOT_OK };
 
-    if (mode == Mode::E_MANUAL)
+    if ((mode == Mode::E_MANUAL) || (mode == Mode::E_AUTOMATIC))
     {
-        serial_device_.write_str("\nM00\n");
-        serial_device_.flush();
-    }
-    else if (mode == Mode::E_AUTOMATIC)
-    {
-        serial_device_.write_str("\nM01\n");
-        serial_device_.flush();
+        ret_val = sendMode(mode, sentCallback);
     }
     else
     {
@@ -160,179 +1060,353 @@ ErrorCode HoneywellManager_OpenHR20::SetMode(Mode mode)
         ret_val = ErrorCode::E_NOT_OK;
     }
 
-    return ret_val;
-}
+    if (ret_val == ErrorCode::E_OK)
+    {
+        CompletionCallback replacedModeCallback;
+        CompletionCallback replacedTemperatureCallback;
+        replacedModeCallback.swap(reconcile_.modeCallback);
 
-ErrorCode HoneywellManager_OpenHR20::GetMode(Mode& mode)
-{
-    char buffer[10];
-    ErrorCode retVal = extractStatusInformation("D: ", 21u, &buffer[0], 1u);
+        reconcile_.modePending  = true;
+        reconcile_.mode         = mode;
+        reconcile_.modeCallback = confirmedCallback;
+        reconcile_.attempts     = 0;
 
-    if (retVal == ErrorCode::E_OK)
-    {
-        if (buffer[0] == 'A')
-        {
-            mode = Mode::E_AUTOMATIC;
-        }
-        else if (buffer[0] == 'M')
-        {
-            mode = Mode::E_MANUAL;
-        }
-        else
+        // in automatic mode the heating programm defines the desired temperature
+        if (mode == Mode::E_AUTOMATIC)
         {
-            mode = Mode::E_INVALID;
+            reconcile_.temperaturePending = false;
+            replacedTemperatureCallback.swap(reconcile_.temperatureCallback);
         }
-    }
-    else
-    {
-        mode = Mode::E_INVALID;
+
+        completeWrite(replacedModeCallback, ErrorCode::E_NOT_OK);
+        completeWrite(replacedTemperatureCallback, ErrorCode::E_NOT_OK);
     }
 
-    return retVal;
+    return ret_val;
 }
 
-ErrorCode HoneywellManager_OpenHR20::GetDesiredTemperature(int& temperature)
+void HoneywellManager_OpenHR20::completeWrite(CompletionCallback& callback, ErrorCode errorCode)
 {
-    char buffer[16];
-    ErrorCode retVal = extractStatusInformation("S: ", 0u, &buffer[0], 3u);
+    CompletionCallback completed;
+    completed.swap(callback);
 
-    if (retVal == ErrorCode::E_OK)
+    if (completed)
     {
-        temperature = std::atoi(&buffer[0]);
+        completed(errorCode);
     }
+}
 
-    return retVal;
+ErrorCode HoneywellManager_OpenHR20::sendDesiredTemperature(int temperature, CompletionCallback callback)
+{
+    HoneywellFrame<UartTransaction::MAX_REQUEST_LENGTH> command;
+
+    command.Text("\nA").Hex(static_cast<uint32_t>(temperature / 5)).Char('\n');
+
+    return queueWriteCommand(command.CStr(), callback);
 }
 
-ErrorCode HoneywellManager_OpenHR20::GetCurrentTemperature(int& temperature)
+ErrorCode HoneywellManager_OpenHR20::sendMode(Mode mode, CompletionCallback callback)
+{
+    return queueWriteCommand((mode == Mode::E_AUTOMATIC) ? "\nM01\n" : "\nM00\n", callback);
+}
+
+ErrorCode HoneywellManager_OpenHR20::queueWriteCommand(const char* command, CompletionCallback callback)
 {
-    char buffer[16];
-    ErrorCode retVal = extractStatusInformation("I: ", 0u, &buffer[0], 3u);
+    ErrorCode retVal = queueCommand(command, [this, callback](ErrorCode errorCode) {
+        --reconcile_.outstandingWrites;
+        reconcile_.lastWriteMs = millis();
+
+        if (callback)
+        {
+            callback(errorCode);
+        }
+    });
 
     if (retVal == ErrorCode::E_OK)
     {
-        temperature = std::atoi(&buffer[0]);
+        ++reconcile_.outstandingWrites;
     }
 
     return retVal;
 }
 
-ErrorCode HoneywellManager_OpenHR20::GetCurrentBatteryVoltage(int& voltage)
+void HoneywellManager_OpenHR20::verifyWrittenState()
 {
-    char buffer[16];
-    ErrorCode retVal = extractStatusInformation("B: ", 0u, &buffer[0], 4u);
-
-    if (retVal == ErrorCode::E_OK)
+    if (!IsReconciling() || (reconcile_.outstandingWrites > 0u) || reconcile_.verifying ||
+        ((millis() - reconcile_.lastWriteMs) < RECONCILE_VERIFY_DELAY_MS))
     {
-        voltage = std::atoi(&buffer[0]);
+        return;
     }
 
-    return retVal;
+    // no status line was received since the last write command, the comparison is done in storeStatusSnapshot()
+    reconcile_.verifying = true;
+
+    ErrorCode retVal = GetStatusSnapshotAsync(
+        [this](ErrorCode errorCode, const StatusSnapshot&) {
+            reconcile_.verifying = false;
+
+            if (errorCode != ErrorCode::E_OK)
+            {
+                // try again after the delay. An unavailable thermostat is not counted, it gets the state as soon as it is back.
+                reconcile_.lastWriteMs = millis();
+
+                if (errorCode != ErrorCode::E_DEVICE_UNAVAILABLE)
+                {
+                    consumeReconcileAttempt();
+                }
+            }
+        },
+        0u);
+
+    if (retVal != ErrorCode::E_OK)
+    {
+        reconcile_.verifying   = false;
+        reconcile_.lastWriteMs = millis();
+    }
 }
 
-ErrorCode HoneywellManager_OpenHR20::GetValvePosition(int& valvePosition)
+void HoneywellManager_OpenHR20::reconcileWrittenState(const StatusSnapshot& snapshot)
 {
-    char buffer[16];
-    ErrorCode retVal = extractStatusInformation("V: ", 0u, &buffer[0], 2u);
+    // a status line received before the write command is done does not contain the written state yet
+    if (!IsReconciling() || (reconcile_.outstandingWrites > 0u))
+    {
+        return;
+    }
 
-    if (retVal == ErrorCode::E_OK)
+    CompletionCallback temperatureCallback;
+    CompletionCallback modeCallback;
+
+    if (reconcile_.temperaturePending && (snapshot.desiredTemperature == reconcile_.temperature))
     {
-        valvePosition = std::atoi(&buffer[0]);
+        reconcile_.temperaturePending = false;
+        temperatureCallback.swap(reconcile_.temperatureCallback);
     }
 
-    return retVal;
-}
+    if (reconcile_.modePending && (snapshot.mode == reconcile_.mode))
+    {
+        reconcile_.modePending = false;
+        modeCallback.swap(reconcile_.modeCallback);
+    }
 
-/*
-// private functions
-*/
+    if (IsReconciling() && consumeReconcileAttempt())
+    {
+        HONEYWELL_LOGD("Written state not applied by the thermostat, resending%s%s", reconcile_.modePending ? " mode" : "",
+                       reconcile_.temperaturePending ? " temperature" : "");
+
+        // the mode first, the desired temperature is kept by a change to manual mode
+        if (reconcile_.modePending)
+        {
+            sendMode(reconcile_.mode, nullptr);
+        }
+
+        if (reconcile_.temperaturePending)
+        {
+            sendDesiredTemperature(reconcile_.temperature, nullptr);
+        }
+    }
+
+    // the written state is confirmed, the callbacks are allowed to write again
+    completeWrite(temperatureCallback, ErrorCode::E_OK);
+    completeWrite(modeCallback, ErrorCode::E_OK);
+}
 
-ErrorCode HoneywellManager_OpenHR20::extractStatusInformation(const char* startTerminatorStr, const uint8_t startByte, char* dataBufferStr,
-                                                              const uint8_t dataLength)
+bool HoneywellManager_OpenHR20::consumeReconcileAttempt()
 {
-    ErrorCode retVal = ErrorCode::E_NOT_OK;
-    constexpr uint32_t MAX_RESPONSE_LOOP_CYCLES{ 10 };
+    if (++reconcile_.attempts < MAX_RECONCILE_ATTEMPTS)
+    {
+        return true;
+    }
+
+    HONEYWELL_LOGW("Written state not applied after %u attempts, giving up", static_cast<unsigned>(MAX_RECONCILE_ATTEMPTS));
+    reconcile_.temperaturePending = false;
+    reconcile_.modePending        = false;
 
-    flushInputBuffer();
+    completeWrite(reconcile_.temperatureCallback, ErrorCode::E_RESPONSE_WRONG);
+    completeWrite(reconcile_.modeCallback, ErrorCode::E_RESPONSE_WRONG);
+
+    return false;
+}
 
-    // Request status message
-    serial_device_.write_str("D\n");
+ErrorCode HoneywellManager_OpenHR20::fillSchedulePipeline(const std::shared_ptr<ScheduleSession>& session)
+{
+    ErrorCode retVal = ErrorCode::E_OK;
 
-    for (uint32_t i{ 0 }; i < MAX_RESPONSE_LOOP_CYCLES; ++i)
+    // one more command than the pipeline depth is queued, so the engine can always send ahead
+    while ((session->next < SCHEDULE_COMMAND_COUNT) && (session->outstanding <= HoneywellTransactionEngine::MAX_PIPELINE_DEPTH))
     {
-        retVal = findResponseString(startTerminatorStr);
+        const size_t index = session->next;
+        UartTransaction transaction;
+        HoneywellFrame<UartTransaction::MAX_REQUEST_LENGTH> request;
+        HoneywellFrame<UartTransaction::MAX_RESPONSE_LENGTH> expectedResponse;
 
-        // if the string was found, break the loop. Otherwise sleep and retry it.
-        if (retVal == ErrorCode::E_OK)
+        if (index < WeeklySchedule::PRESETS)
         {
-            break;
+            // preset temperatures are stored in the EEPROM in steps of 0.5°C: "Gxx" -> "G[xx]=yy", "Sxxyy" -> "G[xx]=yy"
+            const uint32_t address = PRESET_EEPROM_ADDRESS + index;
+
+            if (session->write)
+            {
+                const uint32_t value = static_cast<uint32_t>(session->schedule.presetTemperatures[index] / 5);
+                request.Char('S').Hex(address, 2u).Hex(value, 2u).Char('\n');
+                expectedResponse.Text("G[").Hex(address, 2u).Text("]=").Hex(value, 2u);
+            }
+            else
+            {
+                request.Char('G').Hex(address, 2u).Char('\n');
+                expectedResponse.Text("G[").Hex(address, 2u).Text("]=");
+                transaction.payloadLength = 2u;
+            }
         }
         else
         {
-            delay(10);
+            // switching times of the days 1 (monday) ... 7 (sunday), value = preset << 12 | minutes:
+            // "Rdx" -> "R[dx]=yyyy", "Wdxyyyy" -> "R[dx]=yyyy"
+            const uint32_t day  = ((index - WeeklySchedule::PRESETS) / WeeklySchedule::SLOTS_PER_DAY) + 1u;
+            const uint32_t slot = (index - WeeklySchedule::PRESETS) % WeeklySchedule::SLOTS_PER_DAY;
+
+            if (session->write)
+            {
+                const WeeklySchedule::Slot& entry = session->schedule.slots[day - 1u][slot];
+                const uint32_t value              = (static_cast<uint32_t>(entry.preset) << 12) | entry.minutes;
+                request.Char('W').Hex(day).Hex(slot).Hex(value, 4u).Char('\n');
+                expectedResponse.Text("R[").Hex(day).Hex(slot).Text("]=").Hex(value, 4u);
+            }
+            else
+            {
+                request.Char('R').Hex(day).Hex(slot).Char('\n');
+                expectedResponse.Text("R[").Hex(day).Hex(slot).Text("]=");
+                transaction.payloadLength = 4u;
+            }
         }
-    }
 
-    // if response string was found, then
-    if (retVal == ErrorCode::E_OK)
-    {
-        for (uint8_t i = 0; i < startByte; i++)
+        request.CopyTo(transaction.request);
+        expectedResponse.CopyTo(transaction.expectedResponse);
+
+        // only the first command cleans up the line of the thermostat, all others are sent back-to-back
+        transaction.wakeup            = (index == 0u);
+        transaction.pipelined         = true;
+        transaction.responseTimeoutMs = 200u;
+        transaction.attempts          = engine_.GetRetryPolicy().maxAttempts;
+        transaction.callback          = [this, session, index](ErrorCode errorCode, const char* payload, size_t length) {
+            completeScheduleCommand(session, index, errorCode, payload, length);
+        };
+
+        retVal = engine_.Queue(transaction);
+
+        if (retVal != ErrorCode::E_OK)
         {
-            // discard all bytes till start byte of the data of interest
-            serial_device_.read();
+            // the queue is full, the next command is queued as soon as an outstanding one is done
+            break;
         }
 
-        serial_device_.read_array(reinterpret_cast<uint8_t*>(dataBufferStr), static_cast<size_t>(dataLength));
-        dataBufferStr[dataLength] = '\0';
+        ++session->next;
+        ++session->outstanding;
     }
 
-    // clean up remaining bytes
-    flushInputBuffer();
-
-    return retVal;
+    return (session->outstanding > 0u) ? ErrorCode::E_OK : retVal;
 }
 
-ErrorCode HoneywellManager_OpenHR20::findResponseString(const char* expectedResponse)
+void HoneywellManager_OpenHR20::completeScheduleCommand(const std::shared_ptr<ScheduleSession>& session, size_t index, ErrorCode errorCode,
+                                                        const char* payload, size_t length)
 {
-    ErrorCode retVal             = ErrorCode::E_RESPONSE_TIMEOUT;
-    uint8_t receivedChar         = 0;
-    size_t expectedResponseIndex = 0;
+    --session->outstanding;
 
-    if (serial_device_.available())
+    if ((errorCode == ErrorCode::E_OK) && !session->write)
     {
-        while (serial_device_.read_byte(&receivedChar))
+        uint32_t value = 0;
+
+        if (index < WeeklySchedule::PRESETS)
         {
-            if (static_cast<char>(receivedChar) == expectedResponse[expectedResponseIndex])
+            if ((length == 2u) && HoneywellDecoder::DecodeUnsigned(FrameView{ payload, length }, 16u, 0xFFu, value))
+            {
+                session->schedule.presetTemperatures[index] = static_cast<int>(value) * 5;
+            }
+            else
             {
-                ++expectedResponseIndex;
+                errorCode = ErrorCode::E_RESPONSE_WRONG;
+            }
+        }
+        else
+        {
+            const size_t day  = (index - WeeklySchedule::PRESETS) / WeeklySchedule::SLOTS_PER_DAY;
+            const size_t slot = (index - WeeklySchedule::PRESETS) % WeeklySchedule::SLOTS_PER_DAY;
 
-                // if we reach the end of the expected response string, break the loops
-                if (expectedResponseIndex >= strlen(expectedResponse))
-                {
-                    retVal = ErrorCode::E_OK;
-                    break;
-                }
+            if ((length == 4u) && HoneywellDecoder::DecodeUnsigned(FrameView{ payload, length }, 16u, 0xFFFFu, value))
+            {
+                session->schedule.slots[day][slot].preset  = static_cast<uint8_t>(value >> 12);
+                session->schedule.slots[day][slot].minutes = static_cast<uint16_t>(value & 0x0FFF);
             }
             else
             {
-                // string are not equal. Start again from beginning.
-                expectedResponseIndex = 0;
-                retVal                = ErrorCode::E_RESPONSE_WRONG;
+                errorCode = ErrorCode::E_RESPONSE_WRONG;
             }
         }
     }
 
-    return retVal;
+    if ((errorCode != ErrorCode::E_OK) && (session->result == ErrorCode::E_OK))
+    {
+        session->result = errorCode;
+    }
+
+    if (fillSchedulePipeline(session) != ErrorCode::E_OK)
+    {
+        // no command is outstanding and the next one could not be queued
+        session->result = (session->result == ErrorCode::E_OK) ? ErrorCode::E_NOT_OK : session->result;
+        session->next   = SCHEDULE_COMMAND_COUNT;
+    }
+
+    if ((session->outstanding == 0u) && (session->next >= SCHEDULE_COMMAND_COUNT))
+    {
+        session->callback(session->result, session->schedule);
+    }
+}
+
+void HoneywellManager_OpenHR20::completeStatusRequest(ErrorCode errorCode, const char* line, size_t length)
+{
+    StatusSnapshot snapshot;
+
+    if (errorCode == ErrorCode::E_OK)
+    {
+        errorCode = ParseStatusLine(line, length, snapshot);
+    }
+
+    if (errorCode == ErrorCode::E_OK)
+    {
+        storeStatusSnapshot(snapshot);
+    }
+
+    // callbacks are allowed to request a new status
+    std::vector<StatusSnapshotCallback> callbacks;
+    callbacks.swap(pending_status_callbacks_);
+
+    for (const StatusSnapshotCallback& callback : callbacks)
+    {
+        callback(errorCode, snapshot);
+    }
+}
+
+void HoneywellManager_OpenHR20::handleUnsolicitedFrame(const FrameView& frame)
+{
+    StatusSnapshot snapshot;
+
+    // only status lines are of interest, all other lines are ignored
+    if (frame.StartsWith("D: ") && (ErrorCode::E_OK == ParseStatusLine(frame.data + 3, frame.length - 3u, snapshot)))
+    {
+        engine_.RecordUnsolicitedResponse();
+        storeStatusSnapshot(snapshot);
+    }
 }
 
-void HoneywellManager_OpenHR20::flushInputBuffer()
+void HoneywellManager_OpenHR20::storeStatusSnapshot(StatusSnapshot& snapshot)
 {
-    serial_device_.write_str("\n");
+    snapshot.timestamp = millis();
+    status_snapshot_   = snapshot;
 
-    delay(100);
-    while (serial_device_.available())
+    if (status_observer_)
     {
-        serial_device_.read();
+        status_observer_(ErrorCode::E_OK, status_snapshot_);
     }
+
+    reconcileWrittenState(status_snapshot_);
 }
 #endif
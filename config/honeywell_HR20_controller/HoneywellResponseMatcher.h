@@ -0,0 +1,169 @@
+#ifndef HONEYWELL_RESPONSE_MATCHER_H
+#define HONEYWELL_RESPONSE_MATCHER_H
+
+/**
+ * @file HoneywellResponseMatcher.h
+ *
+ * @brief Streaming matcher to find an expected response in the received UART bytes (Knuth-Morris-Pratt).
+ *        The bytes are fed one by one and the matcher keeps its state between the calls, so a partial match
+ *        survives till the next byte is received. On a mismatch the failure table is used to continue with the
+ *        longest matching prefix, so overlapping responses like "MM20C..." are found and no byte is read twice.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+class HoneywellResponseMatcher
+{
+public:
+    /// @brief Max length of the expected response
+    static constexpr size_t MAX_PATTERN_LENGTH{ 16 };
+
+    /**
+     * @brief Default c'tor, the matcher has an empty pattern.
+     */
+    HoneywellResponseMatcher() = default;
+
+    /**
+     * @brief C'tor
+     * @param pattern C-String of the expected response.
+     */
+    explicit HoneywellResponseMatcher(const char* pattern) { SetPattern(pattern); }
+
+    /**
+     * @brief Set the expected response, precompute the failure table and reset the match state.
+     *        Patterns longer than MAX_PATTERN_LENGTH are truncated.
+     *
+     * @param pattern C-String of the expected response.
+     */
+    void SetPattern(const char* pattern);
+
+    /**
+     * @brief Reset the match state, the pattern is kept.
+     */
+    void Reset(void);
+
+    /**
+     * @brief Feed one received character.
+     *
+     * @param receivedChar The received character.
+     * @return true if the expected response is complete with this character.
+     */
+    bool Feed(char receivedChar);
+
+    /**
+     * @brief true if the expected response was found. Further characters restart the search.
+     */
+    bool IsMatched(void) const { return (length_ > 0u) && (state_ == length_); }
+
+    /**
+     * @brief Number of characters of the expected response, which are matched at the moment.
+     */
+    size_t MatchedLength(void) const { return state_; }
+
+    /**
+     * @brief true if any received character did not continue the partial match since the last reset.
+     */
+    bool HasMismatch(void) const { return mismatch_; }
+
+    /**
+     * @brief Length of the expected response.
+     */
+    size_t PatternLength(void) const { return length_; }
+
+private:
+    /// @brief Expected response (not null terminated)
+    char pattern_[MAX_PATTERN_LENGTH]{};
+
+    /// @brief failure_[i] is the length of the longest proper prefix of pattern_[0..i], which is also a suffix of it.
+    uint8_t failure_[MAX_PATTERN_LENGTH]{};
+
+    /// @brief Length of the expected response
+    size_t length_{ 0 };
+
+    /// @brief Number of matched characters
+    size_t state_{ 0 };
+
+    /// @brief A received character did not continue the partial match
+    bool mismatch_{ false };
+};
+
+/*
+ * public functions
+ */
+
+void HoneywellResponseMatcher::SetPattern(const char* pattern)
+{
+    length_ = 0;
+
+    while ((length_ < MAX_PATTERN_LENGTH) && (pattern[length_] != '\0'))
+    {
+        pattern_[length_] = pattern[length_];
+        ++length_;
+    }
+
+    // failure table
+    size_t prefix = 0;
+
+    if (length_ > 0u)
+    {
+        failure_[0] = 0;
+    }
+
+    for (size_t i = 1; i < length_; ++i)
+    {
+        while ((prefix > 0u) && (pattern_[i] != pattern_[prefix]))
+        {
+            prefix = failure_[prefix - 1u];
+        }
+
+        if (pattern_[i] == pattern_[prefix])
+        {
+            ++prefix;
+        }
+
+        failure_[i] = static_cast<uint8_t>(prefix);
+    }
+
+    Reset();
+}
+
+void HoneywellResponseMatcher::Reset()
+{
+    state_    = 0;
+    mismatch_ = false;
+}
+
+bool HoneywellResponseMatcher::Feed(char receivedChar)
+{
+    if (length_ == 0u)
+    {
+        return false;
+    }
+
+    // a complete match was reported before, continue with the longest suffix which is a prefix
+    if (state_ == length_)
+    {
+        state_ = failure_[length_ - 1u];
+    }
+
+    while ((state_ > 0u) && (receivedChar != pattern_[state_]))
+    {
+        mismatch_ = true;
+        state_    = failure_[state_ - 1u];
+    }
+
+    if (receivedChar == pattern_[state_])
+    {
+        ++state_;
+    }
+    else
+    {
+        mismatch_ = true;
+    }
+
+    return (state_ == length_);
+}
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef HONEYWELL_RETRY_POLICY_H
+#define HONEYWELL_RETRY_POLICY_H
+
+/**
+ * @file HoneywellRetryPolicy.h
+ *
+ * @brief Retry policy of the transaction engine, which is used by both Honeywell managers.
+ *        A failed request is repeated after an exponential backoff with random jitter. A circuit breaker marks the
+ *        thermostat as unavailable after repeated timeouts (e.g. unplugged or dead batteries): further requests fail
+ *        immediately and only one request is let through from time to time, to check if the thermostat is back.
+ *
+ */
+
+#include "IHoneywellManager.h"
+#include <cstdint>
+
+/**
+ * @brief Configuration of the retries and of the circuit breaker.
+ */
+struct RetryPolicy
+{
+    /// @brief Number of times a request is sent, till the transaction fails (only for requests which may be repeated).
+    uint8_t maxAttempts{ 3 };
+
+    /// @brief Wait time before the first repetition of a request.
+    uint32_t backoffInitialMs{ 100 };
+
+    /// @brief Max wait time before a repetition of a request.
+    uint32_t backoffMaxMs{ 2000 };
+
+    /// @brief The wait time is multiplied with this factor for every further repetition.
+    uint8_t backoffMultiplier{ 2 };
+
+    /// @brief Random deviation of the wait times in percent, so several devices do not retry in lockstep.
+    uint8_t jitterPercent{ 20 };
+
+    /// @brief Number of transactions in a row without any response, till the thermostat is unavailable. 0 = no circuit breaker.
+    uint8_t breakerFailureThreshold{ 5 };
+
+    /// @brief Time after the thermostat became unavailable, till the first request is let through again.
+    uint32_t breakerProbeIntervalMs{ 60000 };
+
+    /// @brief Max time between two requests which are let through, the interval is doubled after every failed request.
+    uint32_t breakerMaxProbeIntervalMs{ 15u * 60u * 1000u };
+
+    /**
+     * @brief Wait time before a repetition of a request.
+     *
+     * @param retry Number of the repetition, starting with 1.
+     * @param random Random number for the jitter.
+     * @return Wait time in ms
+     */
+    uint32_t BackoffMs(uint8_t retry, uint32_t random) const
+    {
+        uint32_t backoff = backoffInitialMs;
+
+        for (uint8_t i = 1; (i < retry) && (backoff < backoffMaxMs); ++i)
+        {
+            backoff *= backoffMultiplier;
+        }
+
+        return Jitter((backoff < backoffMaxMs) ? backoff : backoffMaxMs, random);
+    }
+
+    /**
+     * @brief Add a random deviation of +/- jitterPercent to a wait time.
+     */
+    uint32_t Jitter(uint32_t timeMs, uint32_t random) const
+    {
+        const uint32_t range = (timeMs / 100u) * jitterPercent;
+
+        if (range == 0u)
+        {
+            return timeMs;
+        }
+
+        return timeMs - range + (random % ((2u * range) + 1u));
+    }
+};
+
+/**
+ * @brief Circuit breaker of one thermostat.
+ *        Closed: all requests are sent. Open: all requests fail immediately, till the probe interval is over.
+ *        Half open: one request is sent, the thermostat is available again as soon as it responds.
+ */
+class HoneywellCircuitBreaker
+{
+public:
+    /**
+     * @brief Set the thresholds and intervals.
+     */
+    void SetPolicy(const RetryPolicy& policy) { policy_ = policy; }
+
+    /**
+     * @brief Check if a request may be sent. A request which is let through while the thermostat is unavailable is the probe.
+     *
+     * @param nowMs Current time in ms
+     */
+    bool AllowRequest(uint32_t nowMs)
+    {
+        if (state_ == State::E_CLOSED)
+        {
+            return true;
+        }
+
+        if ((state_ == State::E_OPEN) && ((nowMs - openedMs_) >= probeWaitMs_))
+        {
+            state_ = State::E_HALF_OPEN;
+            return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Count the result of a request, which was let through.
+     *
+     * @param errorCode Result of the transaction, only E_RESPONSE_TIMEOUT counts as failure.
+     * @param nowMs Current time in ms
+     * @param random Random number for the jitter of the probe interval.
+     */
+    void RecordResult(ErrorCode errorCode, uint32_t nowMs, uint32_t random)
+    {
+        if (ErrorCode::E_RESPONSE_TIMEOUT != errorCode)
+        {
+            // the thermostat responded, even with a wrong response it is there
+            RecordResponse();
+            return;
+        }
+
+        if (state_ == State::E_HALF_OPEN)
+        {
+            // still not responding, probe less often
+            probeIntervalMs_ = (probeIntervalMs_ < (policy_.breakerMaxProbeIntervalMs / 2u)) ? (probeIntervalMs_ * 2u)
+                                                                                              : policy_.breakerMaxProbeIntervalMs;
+            state_           = State::E_OPEN;
+            openedMs_        = nowMs;
+            probeWaitMs_     = policy_.Jitter(probeIntervalMs_, random);
+        }
+        else if ((state_ == State::E_CLOSED) && (policy_.breakerFailureThreshold > 0u) &&
+                 (++failures_ >= policy_.breakerFailureThreshold))
+        {
+            state_           = State::E_OPEN;
+            openedMs_        = nowMs;
+            probeIntervalMs_ = policy_.breakerProbeIntervalMs;
+            probeWaitMs_     = policy_.Jitter(probeIntervalMs_, random);
+        }
+    }
+
+    /**
+     * @brief The thermostat sent something on its own (e.g. an unsolicited status line), so it is there.
+     */
+    void RecordResponse(void)
+    {
+        state_           = State::E_CLOSED;
+        failures_        = 0;
+        probeIntervalMs_ = policy_.breakerProbeIntervalMs;
+    }
+
+    /**
+     * @brief Give back the probe of a request, whose result says nothing about the thermostat (a command without response).
+     *        The probe wait is already over, so the next request is let through as probe again.
+     */
+    void CancelProbe(void)
+    {
+        if (state_ == State::E_HALF_OPEN)
+        {
+            state_ = State::E_OPEN;
+        }
+    }
+
+    /**
+     * @brief Check if the thermostat is available, i.e. it responded to one of the last requests.
+     */
+    bool IsAvailable(void) const { return state_ == State::E_CLOSED; }
+
+private:
+    /// @brief States of the circuit breaker
+    enum class State : uint8_t
+    {
+        E_CLOSED,
+        E_OPEN,
+        E_HALF_OPEN
+    };
+
+    /// @brief Thresholds and intervals
+    RetryPolicy policy_;
+
+    /// @brief Current state
+    State state_{ State::E_CLOSED };
+
+    /// @brief Transactions in a row without any response
+    uint8_t failures_{ 0 };
+
+    /// @brief Time when the breaker was opened
+    uint32_t openedMs_{ 0 };
+
+    /// @brief Current time between two probes
+    uint32_t probeIntervalMs_{ 60000 };
+
+    /// @brief Time from opening till the next probe, including the jitter
+    uint32_t probeWaitMs_{ 60000 };
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef HONEYWELL_SPSC_QUEUE_H
+#define HONEYWELL_SPSC_QUEUE_H
+
+/**
+ * @file HoneywellSpscQueue.h
+ *
+ * @brief Lock-free queue for exactly one producer and one consumer task (single producer, single consumer).
+ *        The producer only writes the tail index, the consumer only writes the head index. An item is published
+ *        with a release store of the index and taken over with an acquire load, so no mutex is needed.
+ *
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+template <typename T, size_t CAPACITY>
+class HoneywellSpscQueue
+{
+public:
+    /**
+     * @brief Append an item, only called by the producer.
+     *
+     * @param item Item which is moved into the queue. Not modified if the queue is full.
+     * @return false if the queue is full.
+     */
+    bool Push(T& item)
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t next = (tail + 1u) % SLOTS;
+
+        if (next == head_.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        items_[tail] = std::move(item);
+        tail_.store(next, std::memory_order_release);
+
+        return true;
+    }
+
+    /**
+     * @brief Take the oldest item, only called by the consumer.
+     *
+     * @param item Receives the item.
+     * @return false if the queue is empty.
+     */
+    bool Pop(T& item)
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+
+        if (head == tail_.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        item         = std::move(items_[head]);
+        items_[head] = T();
+        head_.store((head + 1u) % SLOTS, std::memory_order_release);
+
+        return true;
+    }
+
+    /**
+     * @brief Check if the queue is empty. The result may be outdated immediately, if it is called by the producer.
+     */
+    bool IsEmpty(void) const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+
+private:
+    /// @brief One slot stays empty to distinguish a full from an empty queue.
+    static constexpr size_t SLOTS{ CAPACITY + 1u };
+
+    /// @brief Ring buffer of the items
+    T items_[SLOTS]{};
+
+    /// @brief Index of the oldest item, written by the consumer
+    std::atomic<size_t> head_{ 0 };
+
+    /// @brief Index of the next free slot, written by the producer
+    std::atomic<size_t> tail_{ 0 };
+};
+
+#endif
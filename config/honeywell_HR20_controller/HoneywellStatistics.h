@@ -0,0 +1,260 @@
+#ifndef HONEYWELL_STATISTICS_H
+#define HONEYWELL_STATISTICS_H
+
+/**
+ * @file HoneywellStatistics.h
+ *
+ * @brief Counters and timing histograms of the UART communication with a Honeywell thermostat.
+ *        The transaction engine counts every transaction, the climate adapter measures how long its calls block the main loop.
+ *        Only counters are incremented on the hot path, nothing is allocated and nothing is logged.
+ *
+ */
+
+#include "IHoneywellManager.h"
+#include "esphome.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+/**
+ * @brief Histogram with logarithmic buckets: bucket 0 counts the values below the first bound, every further bound is 4 times the previous one.
+ *        E.g. a first bound of 16 ms gives the buckets <16, <64, <256, <1024, <4096, <16384 and >=16384 ms.
+ */
+class HoneywellHistogram
+{
+public:
+    /// @brief Number of buckets, the last one counts all values above the largest bound
+    static constexpr size_t BUCKETS{ 7 };
+
+    /**
+     * @brief C'tor
+     * @param firstBound Upper bound (exclusive) of the first bucket, in the unit of the values.
+     */
+    explicit HoneywellHistogram(uint32_t firstBound = 1u)
+        : firstBound_(firstBound)
+    {
+    }
+
+    /**
+     * @brief Count one value.
+     */
+    void Add(uint32_t value)
+    {
+        size_t bucket  = 0;
+        uint32_t bound = firstBound_;
+
+        while ((bucket < (BUCKETS - 1u)) && (value >= bound))
+        {
+            ++bucket;
+            bound *= 4u;
+        }
+
+        ++counts_[bucket];
+        ++samples_;
+        total_ += value;
+        max_ = (value > max_) ? value : max_;
+    }
+
+    /**
+     * @brief Add all values of another histogram with the same bounds.
+     */
+    void Merge(const HoneywellHistogram& other)
+    {
+        for (size_t i = 0; i < BUCKETS; ++i)
+        {
+            counts_[i] += other.counts_[i];
+        }
+
+        samples_ += other.samples_;
+        total_ += other.total_;
+        max_ = (other.max_ > max_) ? other.max_ : max_;
+    }
+
+    /// @brief Number of values in a bucket
+    uint32_t Count(size_t bucket) const { return (bucket < BUCKETS) ? counts_[bucket] : 0u; }
+
+    /// @brief Upper bound (exclusive) of a bucket, the last bucket has no bound
+    uint32_t Bound(size_t bucket) const
+    {
+        uint32_t bound = firstBound_;
+
+        for (size_t i = 0; i < bucket; ++i)
+        {
+            bound *= 4u;
+        }
+
+        return bound;
+    }
+
+    /// @brief Number of all values
+    uint32_t Samples(void) const { return samples_; }
+
+    /// @brief Sum of all values (wraps around after 2^32)
+    uint32_t Total(void) const { return total_; }
+
+    /// @brief Largest value
+    uint32_t Max(void) const { return max_; }
+
+    /**
+     * @brief Log the histogram in one line, e.g. "transaction ms: n=12 total=1740 max=174 [<16:2 <64:0 <256:10 ...]".
+     *
+     * @param name Name of the values including the unit.
+     */
+    void Log(const char* name) const
+    {
+        char buckets[BUCKETS * 16u]{};
+        size_t length = 0;
+
+        for (size_t i = 0; i < BUCKETS; ++i)
+        {
+            // the last bucket has no upper bound
+            const bool last = (i == (BUCKETS - 1u));
+            const int n     = snprintf(&buckets[length], sizeof(buckets) - length, last ? "%s>=%u:%u" : "%s<%u:%u", (i > 0u) ? " " : "",
+                                       static_cast<unsigned>(Bound(last ? (i - 1u) : i)), static_cast<unsigned>(counts_[i]));
+
+            if ((n <= 0) || (static_cast<size_t>(n) >= (sizeof(buckets) - length)))
+            {
+                break;
+            }
+
+            length += static_cast<size_t>(n);
+        }
+
+        ESP_LOGI("honeywell", "  %s: n=%u total=%u max=%u [%s]", name, static_cast<unsigned>(samples_), static_cast<unsigned>(total_),
+                 static_cast<unsigned>(max_), buckets);
+    }
+
+private:
+    /// @brief Upper bound of the first bucket
+    uint32_t firstBound_;
+
+    /// @brief Number of values per bucket
+    uint32_t counts_[BUCKETS]{};
+
+    /// @brief Number, sum and maximum of all values
+    uint32_t samples_{ 0 };
+    uint32_t total_{ 0 };
+    uint32_t max_{ 0 };
+};
+
+/**
+ * @brief Kind of a transaction, the engine only knows the shape of a transaction.
+ */
+enum class TransactionKind : uint8_t
+{
+    /// @brief Command without response, e.g. the OpenHR20 "A" and "M" commands
+    E_COMMAND,
+
+    /// @brief Request which is confirmed by an echo, e.g. HR20_V1 writes and OpenHR20 schedule writes
+    E_CONFIRMED,
+
+    /// @brief Request with payload, e.g. status lines and memory reads
+    E_READ,
+
+    E_COUNT
+};
+
+/**
+ * @brief Values of the statistics, which can be published as diagnostic sensors by the climate adapter.
+ */
+enum class HoneywellStatisticsSensor : uint8_t
+{
+    /// @brief All transactions
+    E_TRANSACTIONS,
+
+    /// @brief Repeated requests
+    E_RETRIES,
+
+    /// @brief Transactions without response
+    E_TIMEOUTS,
+
+    /// @brief Transactions with an unexpected response
+    E_WRONG_RESPONSES,
+
+    /// @brief Discarded received bytes
+    E_DISCARDED_BYTES,
+
+    /// @brief Longest blocking of the main loop by loop(), update() or control() in ms
+    E_MAX_BLOCKING_MS,
+
+    /// @brief States which were not published to Home Assistant, because nothing changed
+    E_SUPPRESSED_PUBLISHES,
+
+    E_COUNT
+};
+
+/**
+ * @brief Counters and histograms of the UART communication with one thermostat, since the start.
+ */
+struct HoneywellStatistics
+{
+    /// @brief Finished transactions per kind, see TransactionKind
+    uint32_t transactions[static_cast<size_t>(TransactionKind::E_COUNT)]{};
+
+    /// @brief Repeated requests after a missing response
+    uint32_t retries{ 0 };
+
+    /// @brief Transactions which failed without response (E_RESPONSE_TIMEOUT)
+    uint32_t timeouts{ 0 };
+
+    /// @brief Transactions which failed with an unexpected response (E_RESPONSE_WRONG), e.g. line noise or a wrong protocol
+    uint32_t wrongResponses{ 0 };
+
+    /// @brief Transactions which were not sent, because the thermostat is unavailable (E_DEVICE_UNAVAILABLE)
+    uint32_t rejected{ 0 };
+
+    /// @brief Received bytes, which were discarded before a wake up or while no transaction was active
+    uint32_t discardedBytes{ 0 };
+
+    /// @brief Time from the start of a transaction till its result in ms
+    HoneywellHistogram transactionMs{ 16u };
+
+    /**
+     * @brief Sum of all transactions
+     */
+    uint32_t Transactions(void) const
+    {
+        uint32_t sum = 0;
+
+        for (uint32_t count : transactions)
+        {
+            sum += count;
+        }
+
+        return sum;
+    }
+
+    /**
+     * @brief Add the counters of another thermostat or manager.
+     */
+    void Merge(const HoneywellStatistics& other)
+    {
+        for (size_t i = 0; i < static_cast<size_t>(TransactionKind::E_COUNT); ++i)
+        {
+            transactions[i] += other.transactions[i];
+        }
+
+        retries += other.retries;
+        timeouts += other.timeouts;
+        wrongResponses += other.wrongResponses;
+        rejected += other.rejected;
+        discardedBytes += other.discardedBytes;
+        transactionMs.Merge(other.transactionMs);
+    }
+
+    /**
+     * @brief Log a compact summary of all counters.
+     */
+    void Log(void) const
+    {
+        ESP_LOGI("honeywell", "  transactions: %u (command %u, confirmed %u, read %u), retries: %u, timeouts: %u, wrong responses: %u",
+                 static_cast<unsigned>(Transactions()), static_cast<unsigned>(transactions[0]), static_cast<unsigned>(transactions[1]),
+                 static_cast<unsigned>(transactions[2]), static_cast<unsigned>(retries), static_cast<unsigned>(timeouts),
+                 static_cast<unsigned>(wrongResponses));
+        ESP_LOGI("honeywell", "  rejected while unavailable: %u, discarded bytes: %u", static_cast<unsigned>(rejected),
+                 static_cast<unsigned>(discardedBytes));
+        transactionMs.Log("transaction ms");
+    }
+};
+
+#endif
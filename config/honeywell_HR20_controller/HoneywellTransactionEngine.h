@@ -0,0 +1,759 @@
+#ifndef HONEYWELL_TRANSACTION_ENGINE_H
+#define HONEYWELL_TRANSACTION_ENGINE_H
+
+/**
+ * @file HoneywellTransactionEngine.h
+ *
+ * @brief Non-blocking UART transaction engine for the Honeywell managers.
+ *        Requests are queued and the engine advances through the states
+ *        wake up -> send -> await match -> read payload -> done/timeout
+ *        on every call of Loop(), without sleeping. A request without response is repeated after a backoff (see RetryPolicy),
+ *        a circuit breaker lets requests fail immediately while the thermostat is unavailable. The result of a transaction is reported with a callback.
+ *        All received bytes are framed into lines by a ring buffer, the payload is handed out as view into that buffer.
+ *        Pipelined transactions are sent back-to-back without waiting for the previous response, the responses are
+ *        matched in the order of the requests. Every transaction is counted in the statistics (see HoneywellStatistics).
+ *
+ */
+
+#include "HoneywellLineFramer.h"
+#include "HoneywellResponseMatcher.h"
+#include "HoneywellRetryPolicy.h"
+#include "HoneywellStatistics.h"
+#include "IHoneywellManager.h"
+#include "esphome.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/**
+ * @brief Callback to report the result of a transaction.
+ *
+ * @param errorCode Result of the transaction, see enum class definition.
+ * @param payload Received bytes after the expected response (not null terminated). Points into the line framer of the engine
+ *                and is only valid during the callback.
+ * @param length Number of received payload bytes.
+ */
+using TransactionCallback = std::function<void(ErrorCode errorCode, const char* payload, size_t length)>;
+
+/**
+ * @brief Callback to report a received line, which does not belong to a transaction.
+ *
+ * @param frame The received line. Points into the line framer of the engine and is only valid during the callback.
+ */
+using FrameListener = std::function<void(const FrameView& frame)>;
+
+/**
+ * @brief Sequence which is sent before a request, to wake up the thermostat and to clean up the input buffer.
+ */
+struct WakeupSequence
+{
+    /// @brief C-String which is sent to wake up the thermostat.
+    const char* command;
+
+    /// @brief Time to wait for any response after the wake up command was sent.
+    uint32_t intervalMs;
+
+    /// @brief Maximum number of wake up commands, till the request is sent anyway.
+    uint8_t maxAttempts;
+};
+
+/**
+ * @brief One request/ response exchange with the thermostat.
+ */
+struct UartTransaction
+{
+    /// @brief max length of the request, including the null terminator
+    static constexpr size_t MAX_REQUEST_LENGTH{ 24 };
+
+    /// @brief max length of the expected response, including the null terminator
+    static constexpr size_t MAX_RESPONSE_LENGTH{ 12 };
+
+    /// @brief C-String of the request which is sent to the thermostat.
+    char request[MAX_REQUEST_LENGTH]{};
+
+    /// @brief C-String of the response which confirms the request. Empty, if no response is expected.
+    char expectedResponse[MAX_RESPONSE_LENGTH]{};
+
+    /// @brief Max number of payload bytes, which are read after the expected response. Reading stops at a line terminator.
+    size_t payloadLength{ 0 };
+
+    /// @brief Timeout to receive the expected response after the request was sent.
+    uint32_t responseTimeoutMs{ 1000 };
+
+    /// @brief Max time between two payload bytes, till the payload is treated as complete.
+    uint32_t payloadIdleTimeoutMs{ 50 };
+
+    /// @brief Number of times the request is sent, till the transaction fails.
+    uint8_t attempts{ 1 };
+
+    /// @brief Run the wake up sequence before the request is sent.
+    bool wakeup{ true };
+
+    /// @brief The request may be sent while the response of the previous pipelined transaction is still awaited.
+    ///        It is sent without flush and it is not repeated while later requests are in flight.
+    bool pipelined{ false };
+
+    /// @brief Callback which reports the result of the transaction.
+    TransactionCallback callback;
+};
+
+/**
+ * @brief States of the transaction engine
+ */
+enum class TransactionState
+{
+    E_IDLE,
+    E_WAKEUP,
+    E_SEND,
+    E_AWAIT_MATCH,
+    E_BACKOFF,
+    E_READ_PAYLOAD,
+    E_DONE,
+    E_TIMEOUT
+};
+
+class HoneywellTransactionEngine
+{
+public:
+    /// @brief Max number of queued transactions
+    static constexpr size_t QUEUE_SIZE{ 8 };
+
+    /// @brief Max number of pipelined requests which are in flight, including the active one
+    static constexpr size_t MAX_PIPELINE_DEPTH{ 4 };
+
+    /// @brief Max number of payload bytes of a transaction
+    static constexpr size_t MAX_PAYLOAD_LENGTH{ HoneywellLineFramer::MAX_FRAME_LENGTH };
+
+    /**
+     * @brief C'tor
+     * @param serial_device UART device which is used for the communication with the thermostat.
+     * @param wakeupSequence Sequence which is sent before a request with enabled wake up flag.
+     */
+    HoneywellTransactionEngine(UARTDevice& serial_device, const WakeupSequence& wakeupSequence);
+
+    /**
+     * @brief Append a transaction to the queue. Returns immediately.
+     *
+     * @param transaction Transaction to send.
+     * @return E_OK if the transaction was queued, E_NOT_OK if the queue is full.
+     */
+    ErrorCode Queue(const UartTransaction& transaction);
+
+    /**
+     * @brief Insert a transaction at the front of the queue, so it is the next one which is sent. Returns immediately.
+     *        Called from a transaction callback, the next transaction follows without any other transaction in between,
+     *        e.g. for a session with several commands after one wake up.
+     *
+     * @param transaction Transaction to send.
+     * @return E_OK if the transaction was queued, E_NOT_OK if the queue is full.
+     */
+    ErrorCode QueueNext(const UartTransaction& transaction);
+
+    /**
+     * @brief Advance the state machine as far as possible without waiting. Shall be called from the ESPHome loop().
+     */
+    void Loop(void);
+
+    /**
+     * @brief Run the state machine till all queued transactions are done. This is blocking!
+     */
+    void RunUntilIdle(void);
+
+    /**
+     * @brief Check if a transaction is active or queued.
+     */
+    bool IsBusy(void) const { return (state_ != TransactionState::E_IDLE) || (queueCount_ > 0u); }
+
+    /**
+     * @brief Current state of the active transaction.
+     */
+    TransactionState GetState(void) const { return state_; }
+
+    /**
+     * @brief Framer of all received lines. Gives access to the last complete line without extra I/O.
+     */
+    const HoneywellLineFramer& GetFramer(void) const { return framer_; }
+
+    /**
+     * @brief Set a listener for unsolicited lines of the thermostat.
+     *        If a listener is set, the uart is also drained while no transaction is active and every line, which is received
+     *        outside of a transaction (idle or wake up state), is reported to the listener instead of being discarded.
+     *        The listener must not call Loop().
+     *
+     * @param listener Listener or nullptr to discard unsolicited lines.
+     */
+    void SetFrameListener(FrameListener listener) { frameListener_ = listener; }
+
+    /**
+     * @brief Limit the time of one Loop() call. As soon as the budget is used up, Loop() returns and continues with the next call.
+     *        With a budget the requests are not flushed, so a single step does not wait for the uart transfer.
+     *
+     * @param budgetUs Max time of one Loop() call in µs, 0 = no limit.
+     */
+    void SetLoopBudget(uint32_t budgetUs) { loopBudgetUs_ = budgetUs; }
+
+    /**
+     * @brief Set the backoff of repeated requests and the circuit breaker.
+     */
+    void SetRetryPolicy(const RetryPolicy& policy)
+    {
+        retryPolicy_ = policy;
+        breaker_.SetPolicy(policy);
+    }
+
+    /**
+     * @brief Current retry policy, e.g. to set the attempts of a transaction.
+     */
+    const RetryPolicy& GetRetryPolicy(void) const { return retryPolicy_; }
+
+    /**
+     * @brief Check if the thermostat is available, see HoneywellCircuitBreaker.
+     */
+    bool IsAvailable(void) const { return breaker_.IsAvailable(); }
+
+    /**
+     * @brief Count a line, which the thermostat sent on its own (e.g. a status line in listen mode), as response.
+     *        So a thermostat which is only listened to becomes available again.
+     */
+    void RecordUnsolicitedResponse(void) { breaker_.RecordResponse(); }
+
+    /**
+     * @brief Close the circuit breaker, e.g. before the protocol is probed: failures of a probe say nothing about the thermostat.
+     */
+    void ResetBreaker(void) { breaker_.RecordResponse(); }
+
+    /**
+     * @brief Counters and timing of all transactions since the start.
+     */
+    const HoneywellStatistics& GetStatistics(void) const { return statistics_; }
+
+private:
+    /**
+     * @brief Execute one step of the state machine.
+     * @return true if the state machine made progress, false if it has to wait for time or received bytes.
+     */
+    bool step(void);
+
+    /**
+     * @brief Consume all bytes from the uart input buffer into the line framer.
+     * @return true if any byte was consumed.
+     */
+    bool drainInput(void);
+
+    /**
+     * @brief Read one byte from the uart into the line framer.
+     *
+     * @param receivedChar The received byte.
+     * @param frameComplete Set to true if a frame was completed with this byte.
+     * @return true if a byte was received.
+     */
+    bool receive(char& receivedChar, bool& frameComplete);
+
+    /**
+     * @brief Write a C-String to the uart.
+     *        The flush blocks till all bytes are sent, so the timeouts start after the transfer. With a loop budget
+     *        the bytes are sent by the uart driver in the background and the timeouts include the transfer time.
+     *
+     * @param text C-String to send.
+     * @param flush true to wait till the bytes are sent.
+     */
+    void write(const char* text, bool flush);
+
+    /**
+     * @brief Send the request of the active transaction and start the response timeout.
+     */
+    void sendRequest(void);
+
+    /**
+     * @brief Send the requests of the following pipelined transactions, while the active one awaits its response.
+     * @return true if any request was sent.
+     */
+    bool sendAhead(void);
+
+    /**
+     * @brief Remove the active transaction from the queue and report the result.
+     * @param errorCode Result of the transaction.
+     */
+    void finish(ErrorCode errorCode);
+
+    /**
+     * @brief The active transaction (head of the queue).
+     */
+    UartTransaction& active(void) { return queue_[queueHead_]; }
+
+    /// @brief EspHome UART Device which is used for serial communication with the Honeywell controller.
+    UARTDevice& serial_device_;
+
+    /// @brief Wake up sequence of the thermostat protocol.
+    WakeupSequence wakeupSequence_;
+
+    /// @brief Ring buffer of queued transactions. The head is the active transaction.
+    UartTransaction queue_[QUEUE_SIZE];
+    size_t queueHead_{ 0 };
+    size_t queueCount_{ 0 };
+
+    /// @brief State of the active transaction.
+    TransactionState state_{ TransactionState::E_IDLE };
+
+    /// @brief millis() time stamp of the last state change or received payload byte.
+    uint32_t stateTimestamp_{ 0 };
+
+    /// @brief Number of sent wake up commands of the active transaction.
+    uint8_t wakeupAttempt_{ 0 };
+
+    /// @brief Number of sent requests of the active transaction.
+    uint8_t attempt_{ 0 };
+
+    /// @brief Number of transactions behind the active one, which are already sent (pipelined).
+    size_t sentAhead_{ 0 };
+
+    /// @brief The request of the transaction at the head of the queue was sent ahead, it only awaits its response.
+    bool headSent_{ false };
+
+    /// @brief A new line was started, while the active transaction awaits its response.
+    bool lineStarted_{ false };
+
+    /// @brief Streaming matcher of the expected response. The state is kept over all attempts of the transaction.
+    HoneywellResponseMatcher matcher_;
+
+    /// @brief All received bytes, split into lines.
+    HoneywellLineFramer framer_;
+
+    /// @brief Listener for lines, which are received outside of a transaction.
+    FrameListener frameListener_;
+
+    /// @brief Max time of one Loop() call in µs, 0 = no limit.
+    uint32_t loopBudgetUs_{ 0 };
+
+    /// @brief Index in the current frame, where the payload starts (behind the expected response).
+    size_t payloadOffset_{ 0 };
+
+    /// @brief Received payload of the active transaction, points into framer_.
+    FrameView payload_;
+
+    /// @brief Backoff of repeated requests and circuit breaker configuration.
+    RetryPolicy retryPolicy_;
+
+    /// @brief Circuit breaker of the thermostat.
+    HoneywellCircuitBreaker breaker_;
+
+    /// @brief Wait time before the active request is repeated.
+    uint32_t backoffMs_{ 0 };
+
+    /// @brief millis() time stamp when the active transaction was started.
+    uint32_t transactionStart_{ 0 };
+
+    /// @brief Counters and timing of all transactions.
+    HoneywellStatistics statistics_;
+};
+
+/*
+ * public functions
+ */
+
+HoneywellTransactionEngine::HoneywellTransactionEngine(UARTDevice& serial_device, const WakeupSequence& wakeupSequence)
+    : serial_device_(serial_device)
+    , wakeupSequence_(wakeupSequence)
+{
+}
+
+ErrorCode HoneywellTransactionEngine::Queue(const UartTransaction& transaction)
+{
+    if (queueCount_ >= QUEUE_SIZE)
+    {
+        return ErrorCode::E_NOT_OK;
+    }
+
+    queue_[(queueHead_ + queueCount_) % QUEUE_SIZE] = transaction;
+    ++queueCount_;
+
+    return ErrorCode::E_OK;
+}
+
+ErrorCode HoneywellTransactionEngine::QueueNext(const UartTransaction& transaction)
+{
+    if (queueCount_ >= QUEUE_SIZE)
+    {
+        return ErrorCode::E_NOT_OK;
+    }
+
+    // the active transaction and the already sent ones stay in front, so the new one is inserted behind them
+    const size_t position = ((state_ == TransactionState::E_IDLE) && !headSent_) ? 0u : (1u + sentAhead_);
+
+    for (size_t i = queueCount_; i > position; --i)
+    {
+        queue_[(queueHead_ + i) % QUEUE_SIZE] = queue_[(queueHead_ + i - 1u) % QUEUE_SIZE];
+    }
+    queue_[(queueHead_ + position) % QUEUE_SIZE] = transaction;
+    ++queueCount_;
+
+    return ErrorCode::E_OK;
+}
+
+void HoneywellTransactionEngine::Loop()
+{
+    const uint32_t start = micros();
+
+    while (step())
+    {
+        // advance till the state machine has to wait or the budget is used up
+        if ((loopBudgetUs_ > 0u) && ((micros() - start) >= loopBudgetUs_))
+        {
+            break;
+        }
+    }
+}
+
+void HoneywellTransactionEngine::RunUntilIdle()
+{
+    Loop();
+
+    while (IsBusy())
+    {
+        delay(1);
+        Loop();
+    }
+}
+
+/*
+ * private functions
+ */
+
+bool HoneywellTransactionEngine::step()
+{
+    bool progress{ false };
+    const uint32_t now = millis();
+
+    switch (state_)
+    {
+    case TransactionState::E_IDLE:
+        if (queueCount_ > 0u)
+        {
+            attempt_          = 0;
+            payload_          = FrameView{};
+            transactionStart_ = now;
+            matcher_.SetPattern(active().expectedResponse);
+
+            if (!headSent_ && !breaker_.AllowRequest(now))
+            {
+                // the thermostat did not respond to the last requests, do not wait for the timeouts again
+                finish(ErrorCode::E_DEVICE_UNAVAILABLE);
+            }
+            else if (headSent_)
+            {
+                // the request was sent ahead while the previous transaction was active
+                headSent_       = false;
+                lineStarted_    = false;
+                attempt_        = 1;
+                stateTimestamp_ = now;
+                state_          = TransactionState::E_AWAIT_MATCH;
+            }
+            else if (active().wakeup)
+            {
+                // stale bytes of a previous response must not be taken as response to the wake up command
+                drainInput();
+                write(wakeupSequence_.command, true);
+                wakeupAttempt_  = 1;
+                stateTimestamp_ = now;
+                state_          = TransactionState::E_WAKEUP;
+            }
+            else
+            {
+                state_ = TransactionState::E_SEND;
+            }
+
+            progress = true;
+        }
+        else if (frameListener_)
+        {
+            // passive listening for unsolicited lines of the thermostat
+            drainInput();
+        }
+        break;
+
+    case TransactionState::E_WAKEUP:
+        if ((now - stateTimestamp_) >= wakeupSequence_.intervalMs)
+        {
+            // the thermostat is awake as soon as it replies anything, otherwise retry the wake up command
+            if (drainInput() || (wakeupAttempt_ >= wakeupSequence_.maxAttempts))
+            {
+                state_ = TransactionState::E_SEND;
+            }
+            else
+            {
+                write(wakeupSequence_.command, true);
+                ++wakeupAttempt_;
+                stateTimestamp_ = now;
+            }
+
+            progress = true;
+        }
+        break;
+
+    case TransactionState::E_SEND:
+        sendRequest();
+        progress = true;
+        break;
+
+    case TransactionState::E_AWAIT_MATCH:
+    {
+        char receivedChar  = '\0';
+        bool frameComplete = false;
+
+        progress = sendAhead();
+
+        // a partial match of a previous call or attempt is continued
+        while ((state_ == TransactionState::E_AWAIT_MATCH) && receive(receivedChar, frameComplete))
+        {
+            if (matcher_.Feed(receivedChar))
+            {
+                payloadOffset_  = framer_.CurrentFrame().length;
+                stateTimestamp_ = now;
+                state_          = (active().payloadLength > 0u) ? TransactionState::E_READ_PAYLOAD : TransactionState::E_DONE;
+            }
+            else if (frameComplete && active().pipelined && lineStarted_)
+            {
+                // every pipelined request is answered with one line, the following lines belong to the next requests
+                state_ = TransactionState::E_TIMEOUT;
+            }
+            else if (framer_.CurrentFrame().length == 1u)
+            {
+                // the rest of the previous response does not count as answer of this request
+                lineStarted_ = true;
+            }
+        }
+
+        if (state_ != TransactionState::E_AWAIT_MATCH)
+        {
+            progress = true;
+        }
+        else if ((now - stateTimestamp_) >= active().responseTimeoutMs)
+        {
+            // retry the request after a backoff or give up, a repeated request would break the order of the pipelined responses
+            const bool retry = (attempt_ < active().attempts) && (sentAhead_ == 0u);
+            state_           = retry ? TransactionState::E_BACKOFF : TransactionState::E_TIMEOUT;
+            backoffMs_       = retry ? retryPolicy_.BackoffMs(attempt_, random_uint32()) : 0u;
+            stateTimestamp_  = now;
+            progress         = true;
+
+            if (retry)
+            {
+                ++statistics_.retries;
+            }
+        }
+        break;
+    }
+
+    case TransactionState::E_BACKOFF:
+        // a late response is still matched after the request was repeated
+        if ((now - stateTimestamp_) >= backoffMs_)
+        {
+            state_   = TransactionState::E_SEND;
+            progress = true;
+        }
+        break;
+
+    case TransactionState::E_READ_PAYLOAD:
+    {
+        const size_t payloadLength = active().payloadLength;
+        char receivedChar          = '\0';
+        bool frameComplete         = false;
+
+        progress = sendAhead();
+
+        while ((state_ == TransactionState::E_READ_PAYLOAD) && receive(receivedChar, frameComplete))
+        {
+            stateTimestamp_ = now;
+
+            if (frameComplete)
+            {
+                // the payload is the rest of the line behind the expected response
+                payload_ = framer_.LastFrame().SubView(payloadOffset_, payloadLength);
+                state_   = TransactionState::E_DONE;
+            }
+            else if ((receivedChar == '\n') || (receivedChar == '\r'))
+            {
+                // line terminator directly behind the expected response, no payload
+                state_ = TransactionState::E_DONE;
+            }
+            else if (framer_.CurrentFrame().length < payloadOffset_)
+            {
+                // the line was too long for the framer and is discarded
+                state_ = TransactionState::E_DONE;
+            }
+            else if ((framer_.CurrentFrame().length - payloadOffset_) >= payloadLength)
+            {
+                payload_ = framer_.CurrentFrame().SubView(payloadOffset_, payloadLength);
+                state_   = TransactionState::E_DONE;
+            }
+        }
+
+        if ((state_ == TransactionState::E_READ_PAYLOAD) && ((now - stateTimestamp_) >= active().payloadIdleTimeoutMs))
+        {
+            // no more bytes on the wire, use what was received so far
+            payload_ = framer_.CurrentFrame().SubView(payloadOffset_, payloadLength);
+            state_   = TransactionState::E_DONE;
+        }
+
+        progress = progress || (state_ != TransactionState::E_READ_PAYLOAD);
+        break;
+    }
+
+    case TransactionState::E_DONE:
+        finish(ErrorCode::E_OK);
+        progress = true;
+        break;
+
+    case TransactionState::E_TIMEOUT:
+        finish(matcher_.HasMismatch() ? ErrorCode::E_RESPONSE_WRONG : ErrorCode::E_RESPONSE_TIMEOUT);
+        progress = true;
+        break;
+
+    default:
+        state_ = TransactionState::E_IDLE;
+        break;
+    }
+
+    return progress;
+}
+
+bool HoneywellTransactionEngine::drainInput()
+{
+    bool consumed{ false };
+    char receivedChar{ '\0' };
+    bool frameComplete{ false };
+
+    while (receive(receivedChar, frameComplete))
+    {
+        consumed = true;
+
+        // without listener nobody looks at these bytes
+        if (!frameListener_)
+        {
+            ++statistics_.discardedBytes;
+        }
+    }
+
+    return consumed;
+}
+
+bool HoneywellTransactionEngine::receive(char& receivedChar, bool& frameComplete)
+{
+    uint8_t receivedByte{ 0 };
+
+    if (!serial_device_.read_byte(&receivedByte))
+    {
+        return false;
+    }
+
+    receivedChar  = static_cast<char>(receivedByte);
+    frameComplete = framer_.Push(receivedChar);
+
+    if (frameComplete && frameListener_ && ((state_ == TransactionState::E_IDLE) || (state_ == TransactionState::E_WAKEUP)))
+    {
+        frameListener_(framer_.LastFrame());
+    }
+
+    return true;
+}
+
+void HoneywellTransactionEngine::write(const char* text, bool flush)
+{
+    serial_device_.write_str(text);
+
+    if (flush && (loopBudgetUs_ == 0u))
+    {
+        serial_device_.flush();
+    }
+}
+
+void HoneywellTransactionEngine::sendRequest()
+{
+    write(active().request, !active().pipelined);
+    ++attempt_;
+
+    if (active().expectedResponse[0] == '\0')
+    {
+        // fire and forget command
+        state_ = TransactionState::E_DONE;
+    }
+    else
+    {
+        stateTimestamp_ = millis();
+        lineStarted_    = false;
+        state_          = TransactionState::E_AWAIT_MATCH;
+    }
+}
+
+bool HoneywellTransactionEngine::sendAhead()
+{
+    bool sent{ false };
+
+    while (active().pipelined && ((sentAhead_ + 1u) < MAX_PIPELINE_DEPTH) && ((sentAhead_ + 1u) < queueCount_))
+    {
+        const UartTransaction& next = queue_[(queueHead_ + sentAhead_ + 1u) % QUEUE_SIZE];
+
+        if (!next.pipelined || next.wakeup || (next.expectedResponse[0] == '\0'))
+        {
+            break;
+        }
+
+        write(next.request, false);
+        ++sentAhead_;
+        sent = true;
+    }
+
+    return sent;
+}
+
+void HoneywellTransactionEngine::finish(ErrorCode errorCode)
+{
+    if (ErrorCode::E_DEVICE_UNAVAILABLE != errorCode)
+    {
+        const uint32_t now          = millis();
+        const UartTransaction& head = active();
+        const TransactionKind kind  = (head.expectedResponse[0] == '\0') ? TransactionKind::E_COMMAND
+                                      : (head.payloadLength > 0u)       ? TransactionKind::E_READ
+                                                                        : TransactionKind::E_CONFIRMED;
+
+        // a command without response always succeeds, it says nothing about the thermostat
+        if (TransactionKind::E_COMMAND == kind)
+        {
+            breaker_.CancelProbe();
+        }
+        else
+        {
+            breaker_.RecordResult(errorCode, now, random_uint32());
+        }
+
+        ++statistics_.transactions[static_cast<size_t>(kind)];
+        statistics_.transactionMs.Add(now - transactionStart_);
+        statistics_.timeouts += (ErrorCode::E_RESPONSE_TIMEOUT == errorCode) ? 1u : 0u;
+        statistics_.wrongResponses += (ErrorCode::E_RESPONSE_WRONG == errorCode) ? 1u : 0u;
+    }
+    else
+    {
+        ++statistics_.rejected;
+    }
+
+    // remove the transaction before the callback is called, so the callback is able to queue new transactions
+    TransactionCallback callback = active().callback;
+    active().callback            = nullptr;
+    queueHead_                   = (queueHead_ + 1u) % QUEUE_SIZE;
+    --queueCount_;
+    state_ = TransactionState::E_IDLE;
+
+    // the next transaction was already sent, it continues with the response
+    if (sentAhead_ > 0u)
+    {
+        --sentAhead_;
+        headSent_ = true;
+    }
+
+    if (callback)
+    {
+        callback(errorCode, payload_.data, payload_.length);
+    }
+}
+
+#endif
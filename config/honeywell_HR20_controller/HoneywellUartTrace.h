@@ -0,0 +1,276 @@
+#ifndef HONEYWELL_UART_TRACE_H
+#define HONEYWELL_UART_TRACE_H
+
+/**
+ * @file HoneywellUartTrace.h
+ *
+ * @brief Capture format of the UART communication with a thermostat, which can be replayed on the host (host/honeywell_replay.cpp).
+ *        One line per chunk of bytes: <millis> <TX|RX> "<escaped bytes>", e.g. 12345 TX "D\n"
+ *        TX are the bytes sent to the thermostat, RX the bytes received from it. The time stamp is taken when the chunk is complete.
+ *        Printable characters are kept, '\' and '"' are escaped with a backslash, line feed, carriage return and tab as \n, \r and \t,
+ *        all other bytes as \xNN. These are the same escape sequences as UARTDebug::log_string(), so its lines (without time stamp)
+ *        can be replayed as well.
+ *        On the device the lines are written to the log by Log(), called from the uart debug sequence of the YAML:
+ *        - lambda: HoneywellUartTrace::Log(direction == uart::UART_DIRECTION_TX, bytes);
+ *
+ */
+
+#include "esphome.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+class HoneywellUartTrace
+{
+public:
+    /// @brief Max number of bytes in one line of the log, longer chunks are split into several lines with the same time stamp
+    static constexpr size_t MAX_CHUNK_LENGTH{ 32 };
+
+    /// @brief Max length of the escaped bytes of one line, every byte needs at most 4 characters
+    static constexpr size_t MAX_ESCAPED_LENGTH{ (4u * MAX_CHUNK_LENGTH) + 1u };
+
+    /**
+     * @brief Write one chunk of bytes to the log (tag "hr20_trace").
+     *
+     * @param tx true for bytes sent to the thermostat, false for received bytes.
+     * @param bytes The bytes of the chunk.
+     */
+    static void Log(bool tx, const std::vector<uint8_t>& bytes);
+
+    /**
+     * @brief Escape bytes for the capture format.
+     *
+     * @param data The bytes.
+     * @param length Number of bytes.
+     * @param escaped Receives the null terminated escaped bytes.
+     * @param escapedSize Size of the buffer, at least 5.
+     * @return Number of bytes which were escaped, less than length if the buffer is full.
+     */
+    static size_t Escape(const uint8_t* data, size_t length, char* escaped, size_t escapedSize);
+
+    /**
+     * @brief Parse one line of a captured trace. Any prefix of the logger (e.g. "[D][hr20_trace:042]: ") is skipped.
+     *        Also the lines of UARTDebug::log_string() are accepted: ">>> "..."" (TX) and "<<< "..."" (RX), without time stamp.
+     *
+     * @param line Null terminated line.
+     * @param timeMs The time stamp, not modified if the line has none.
+     * @param tx true for bytes sent to the thermostat.
+     * @param data Receives the unescaped bytes.
+     * @param length Max number of bytes, receives the number of bytes.
+     * @return false if the line does not contain a chunk, e.g. other log messages.
+     */
+    static bool ParseLine(const char* line, uint32_t& timeMs, bool& tx, uint8_t* data, size_t& length);
+
+private:
+    /**
+     * @brief Find the direction and the opening quote of a chunk.
+     * @return Pointer to the first escaped byte, nullptr if the line does not contain a chunk.
+     */
+    static const char* findChunk(const char* line, bool& tx, const char*& direction);
+
+    /**
+     * @brief Value of a hex digit, -1 if the character is no hex digit.
+     */
+    static int hexDigit(char c);
+};
+
+// Public functions
+
+void HoneywellUartTrace::Log(bool tx, const std::vector<uint8_t>& bytes)
+{
+    char escaped[MAX_ESCAPED_LENGTH];
+    const uint32_t now = millis();
+    size_t position    = 0;
+
+    do
+    {
+        const size_t chunk = ((bytes.size() - position) < MAX_CHUNK_LENGTH) ? (bytes.size() - position) : MAX_CHUNK_LENGTH;
+        position += Escape(bytes.data() + position, chunk, escaped, sizeof(escaped));
+
+        ESP_LOGD("hr20_trace", "%u %s \"%s\"", static_cast<unsigned>(now), tx ? "TX" : "RX", escaped);
+    } while (position < bytes.size());
+}
+
+size_t HoneywellUartTrace::Escape(const uint8_t* data, size_t length, char* escaped, size_t escapedSize)
+{
+    static constexpr char HEX_DIGITS[]{ "0123456789ABCDEF" };
+    size_t position = 0;
+    size_t i        = 0;
+
+    // one more escape sequence and the null terminator must fit
+    for (; (i < length) && ((position + 5u) <= escapedSize); ++i)
+    {
+        const uint8_t byte = data[i];
+
+        if ((byte == '\\') || (byte == '"'))
+        {
+            escaped[position++] = '\\';
+            escaped[position++] = static_cast<char>(byte);
+        }
+        else if (byte == '\n')
+        {
+            escaped[position++] = '\\';
+            escaped[position++] = 'n';
+        }
+        else if (byte == '\r')
+        {
+            escaped[position++] = '\\';
+            escaped[position++] = 'r';
+        }
+        else if (byte == '\t')
+        {
+            escaped[position++] = '\\';
+            escaped[position++] = 't';
+        }
+        else if ((byte >= 0x20u) && (byte < 0x7Fu))
+        {
+            escaped[position++] = static_cast<char>(byte);
+        }
+        else
+        {
+            escaped[position++] = '\\';
+            escaped[position++] = 'x';
+            escaped[position++] = HEX_DIGITS[byte >> 4];
+            escaped[position++] = HEX_DIGITS[byte & 0x0Fu];
+        }
+    }
+
+    if (escapedSize > 0u)
+    {
+        escaped[position] = '\0';
+    }
+
+    return i;
+}
+
+bool HoneywellUartTrace::ParseLine(const char* line, uint32_t& timeMs, bool& tx, uint8_t* data, size_t& length)
+{
+    const char* direction = nullptr;
+    const char* escaped   = findChunk(line, tx, direction);
+    const size_t maxLength{ length };
+
+    if (escaped == nullptr)
+    {
+        return false;
+    }
+
+    // the time stamp is the number in front of the direction, the log lines of UARTDebug have none
+    if ((direction[0] != '<') && (direction[0] != '>'))
+    {
+        const char* start = direction;
+
+        while ((start > line) && (start[-1] == ' '))
+        {
+            --start;
+        }
+        while ((start > line) && (start[-1] >= '0') && (start[-1] <= '9'))
+        {
+            --start;
+        }
+
+        if ((start[0] >= '0') && (start[0] <= '9'))
+        {
+            timeMs = static_cast<uint32_t>(strtoul(start, nullptr, 10));
+        }
+    }
+
+    length = 0;
+
+    for (const char* c = escaped; (*c != '\0') && (*c != '"') && (length < maxLength); ++c)
+    {
+        char byte = *c;
+
+        if (byte == '\\')
+        {
+            ++c;
+
+            switch (*c)
+            {
+            case 'a':
+                byte = '\a';
+                break;
+            case 'b':
+                byte = '\b';
+                break;
+            case 'f':
+                byte = '\f';
+                break;
+            case 'n':
+                byte = '\n';
+                break;
+            case 'r':
+                byte = '\r';
+                break;
+            case 't':
+                byte = '\t';
+                break;
+            case 'v':
+                byte = '\v';
+                break;
+            case 'x':
+                if ((hexDigit(c[1]) < 0) || (hexDigit(c[2]) < 0))
+                {
+                    return false;
+                }
+                byte = static_cast<char>((hexDigit(c[1]) << 4) | hexDigit(c[2]));
+                c += 2;
+                break;
+            case '\0':
+                return false;
+            default:
+                // '\\', '"' and '\''
+                byte = *c;
+                break;
+            }
+        }
+
+        data[length++] = static_cast<uint8_t>(byte);
+    }
+
+    return true;
+}
+
+// Private functions
+
+const char* HoneywellUartTrace::findChunk(const char* line, bool& tx, const char*& direction)
+{
+    static constexpr const char* MARKERS[]{ " TX \"", " RX \"", ">>> \"", "<<< \"" };
+
+    for (size_t i = 0; i < (sizeof(MARKERS) / sizeof(MARKERS[0])); ++i)
+    {
+        const char* found = strstr(line, MARKERS[i]);
+
+        if (found != nullptr)
+        {
+            // TX and RX start behind the space in front of them
+            tx        = (i == 0u) || (i == 2u);
+            direction = (i < 2u) ? (found + 1) : found;
+            return found + strlen(MARKERS[i]);
+        }
+    }
+
+    return nullptr;
+}
+
+int HoneywellUartTrace::hexDigit(char c)
+{
+    if ((c >= '0') && (c <= '9'))
+    {
+        return c - '0';
+    }
+    if ((c >= 'a') && (c <= 'f'))
+    {
+        return c - 'a' + 10;
+    }
+    if ((c >= 'A') && (c <= 'F'))
+    {
+        return c - 'A' + 10;
+    }
+
+    return -1;
+}
+
+#endif
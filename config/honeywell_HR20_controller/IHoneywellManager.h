@@ -10,6 +10,7 @@
  */
 
 #include <cstdint>
+#include <functional>
 
 /**
  * @brief Possible error codes
@@ -20,7 +21,8 @@ enum class ErrorCode
     E_NOT_OK,
     E_READ_BUF_OVERFLOW,
     E_RESPONSE_TIMEOUT,
-    E_RESPONSE_WRONG
+    E_RESPONSE_WRONG,
+    E_DEVICE_UNAVAILABLE
 };
 
 /**
@@ -33,13 +35,84 @@ enum class Mode
     E_AUTOMATIC
 };
 
+/**
+ * @brief Weekly heating programm, which is used in automatic mode, and the preset temperatures it refers to.
+ */
+struct WeeklySchedule
+{
+    /// @brief Number of days, 0 = Monday ... 6 = Sunday
+    static constexpr uint8_t DAYS{ 7 };
+
+    /// @brief Number of switching times per day
+    static constexpr uint8_t SLOTS_PER_DAY{ 8 };
+
+    /// @brief Number of preset temperatures (e.g. off/frost protection, energy saving, comfort, super comfort)
+    static constexpr uint8_t PRESETS{ 4 };
+
+    /// @brief Value of minutes for an unused switching time
+    static constexpr uint16_t SLOT_DISABLED{ 0x0FFF };
+
+    /**
+     * @brief One switching time: from this time of the day on, the preset temperature is used.
+     */
+    struct Slot
+    {
+        /// @brief Minutes since midnight (0 ... 1439), SLOT_DISABLED if the slot is not used.
+        uint16_t minutes{ SLOT_DISABLED };
+
+        /// @brief Index of the preset temperature (0 ... PRESETS - 1)
+        uint8_t preset{ 0 };
+    };
+
+    /// @brief Preset temperatures in celsius and with factor 10 offset (e.g.: 225 => 22.5°C)
+    int presetTemperatures[PRESETS]{};
+
+    /// @brief Switching times of every day
+    Slot slots[DAYS][SLOTS_PER_DAY]{};
+};
+
+/**
+ * @brief Callback to report the result of an asynchronous command.
+ */
+using CompletionCallback = std::function<void(ErrorCode errorCode)>;
+
+/**
+ * @brief Callback to report the result of an asynchronous temperature request (fixed point; e.g.: 225 => 22.5°C).
+ */
+using TemperatureCallback = std::function<void(ErrorCode errorCode, int temperature)>;
+
+/**
+ * @brief Callback to report the result of an asynchronous mode request.
+ */
+using ModeCallback = std::function<void(ErrorCode errorCode, Mode mode)>;
+
+/**
+ * @brief Callback to report the result of an asynchronous request of the whole state (desired temperature and mode).
+ */
+using StateCallback = std::function<void(ErrorCode errorCode, int temperature, Mode mode)>;
+
+/**
+ * @brief Callback to report the result of an asynchronous request of the weekly heating programm.
+ */
+using ScheduleCallback = std::function<void(ErrorCode errorCode, const WeeklySchedule& schedule)>;
+
+/**
+ * @brief Retries and circuit breaker, see HoneywellRetryPolicy.h
+ */
+struct RetryPolicy;
+
+/**
+ * @brief Counters and timing of the UART communication, see HoneywellStatistics.h
+ */
+struct HoneywellStatistics;
+
 class IHoneywellManager
 {
 public:
     /**
      * @brief Default d'tor
      */
-    ~IHoneywellManager() = default;
+    virtual ~IHoneywellManager() = default;
 
     /**
      * @brief Set the desired temperature for the radiator thermostat.
@@ -72,6 +145,102 @@ public:
      */
     virtual ErrorCode GetMode(Mode& mode) = 0;
 
+    /**
+     * @brief Advance the asynchronous communication with the thermostat. Shall be called cyclically, e.g. from the ESPHome loop().
+     */
+    virtual void Loop(void) = 0;
+
+    /**
+     * @brief Limit the time, which one call of Loop() may block.
+     *
+     * @param budgetMs Max time of one Loop() call in ms, 0 = no limit.
+     */
+    virtual void SetLoopBudget(uint32_t budgetMs) = 0;
+
+    /**
+     * @brief Set the backoff of repeated requests and the circuit breaker.
+     *
+     * @param policy New retry policy.
+     */
+    virtual void SetRetryPolicy(const RetryPolicy& policy) = 0;
+
+    /**
+     * @brief Check if the thermostat is available. After repeated timeouts requests fail immediately with E_DEVICE_UNAVAILABLE,
+     *        only from time to time a request is sent to check if the thermostat is back.
+     */
+    virtual bool IsAvailable(void) const = 0;
+
+    /**
+     * @brief Copy the counters and timing of the UART communication since the start.
+     *
+     * @param statistics Receives the statistics.
+     */
+    virtual void GetStatistics(HoneywellStatistics& statistics) const = 0;
+
+    /**
+     * @brief Check if asynchronous commands are active or queued.
+     */
+    virtual bool IsBusy(void) const = 0;
+
+    /**
+     * @brief Queue a command to set the desired temperature for the radiator thermostat. Returns immediately.
+     *
+     * @param temperature Temperature value in celsius and with factor 10 offset (e.g.: 225 => 22.5°C)
+     * @param callback Called from Loop() as soon as the thermostat confirmed the written value (E_OK) or the write failed.
+     * @return E_OK if the command was queued, otherwise the callback will not be called.
+     */
+    virtual ErrorCode SetDesiredTemperatureAsync(int temperature, CompletionCallback callback) = 0;
+
+    /**
+     * @brief Queue a request of the desired temperature for the radiator thermostat. Returns immediately.
+     *
+     * @param callback Called from Loop() with the desired temperature as soon as the request is done.
+     * @return E_OK if the request was queued, otherwise the callback will not be called.
+     */
+    virtual ErrorCode GetDesiredTemperatureAsync(TemperatureCallback callback) = 0;
+
+    /**
+     * @brief Queue a command to set manual or automatic mode. Returns immediately.
+     *
+     * @param mode manual or automatic mode.
+     * @param callback Called from Loop() as soon as the thermostat confirmed the written mode (E_OK) or the write failed.
+     * @return E_OK if the command was queued, otherwise the callback will not be called.
+     */
+    virtual ErrorCode SetModeAsync(Mode mode, CompletionCallback callback) = 0;
+
+    /**
+     * @brief Queue a request of the manual or automatic mode. Returns immediately.
+     *
+     * @param callback Called from Loop() with the mode as soon as the request is done.
+     * @return E_OK if the request was queued, otherwise the callback will not be called.
+     */
+    virtual ErrorCode GetModeAsync(ModeCallback callback) = 0;
+
+    /**
+     * @brief Queue a request of the desired temperature and the mode with as few transactions as possible. Returns immediately.
+     *
+     * @param callback Called from Loop() with the desired temperature and the mode as soon as the request is done.
+     * @return E_OK if the request was queued, otherwise the callback will not be called.
+     */
+    virtual ErrorCode GetStateAsync(StateCallback callback) = 0;
+
+    /**
+     * @brief Queue a read of the whole weekly heating programm and the preset temperatures. Returns immediately.
+     *
+     * @param callback Called from Loop() with the heating programm as soon as all reads are done.
+     * @return E_OK if the request was queued, E_NOT_OK if it is not supported. Otherwise the callback will not be called.
+     */
+    virtual ErrorCode GetScheduleAsync(ScheduleCallback callback) = 0;
+
+    /**
+     * @brief Queue a write of the whole weekly heating programm and the preset temperatures. Returns immediately.
+     *
+     * @param schedule The new heating programm.
+     * @param callback Called from Loop() as soon as all writes are confirmed or failed.
+     * @return E_OK if the command was queued, E_NOT_OK if it is not supported. Otherwise the callback will not be called.
+     */
+    virtual ErrorCode SetScheduleAsync(const WeeklySchedule& schedule, CompletionCallback callback) = 0;
+
 private:
 };
 
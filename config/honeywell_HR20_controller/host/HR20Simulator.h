@@ -0,0 +1,540 @@
+#ifndef HR20_SIMULATOR_H
+#define HR20_SIMULATOR_H
+
+/**
+ * @file HR20Simulator.h
+ *
+ * @brief Simulated Honeywell HR20 thermostat for the host build.
+ *        It acts as UARTComponent, so the Honeywell managers can be used without an ESP board and a real thermostat.
+ *        Both protocols are supported:
+ *        - OpenHR20 text protocol: "D" (status line), "Axx" (desired temperature), "Mxx" (mode),
+ *          "Gxx"/"Sxxyy" (EEPROM config), "Rdx"/"Wdxyyyy" (switching times of the heating programm)
+ *        - HR20_V1 memory protocol: "K" (wake up), "Raaa" (read 2 bytes), "Waaadddd" (write 2 bytes), response "Maaadddd"
+ *        Every byte needs the transmission time of the configured baud rate on the virtual clock of the host shim.
+ *        Latency, dropped bytes and line noise can be configured.
+ *        The OpenHR20 firmware can print unsolicited status lines, periodically and after a change of the state.
+ *
+ */
+
+#include "esphome.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+
+class HR20Simulator : public UARTComponent
+{
+public:
+    /**
+     * @brief Simulated firmware of the thermostat
+     */
+    enum class Protocol
+    {
+        E_OPEN_HR20,
+        E_HR20_V1
+    };
+
+    /**
+     * @brief Configuration of the simulated serial line and thermostat
+     */
+    struct Config
+    {
+        /// @brief Simulated firmware
+        Protocol protocol{ Protocol::E_OPEN_HR20 };
+
+        /// @brief Baud rate of the serial line
+        uint32_t baudRate{ 9600 };
+
+        /// @brief Number of bits on the wire per byte (start bit + data bits + parity + stop bits)
+        uint32_t bitsPerByte{ 10 };
+
+        /// @brief Processing time of the thermostat from the end of a command till the first response byte.
+        uint32_t responseLatencyUs{ 2000 };
+
+        /// @brief Probability that a byte from the host is lost.
+        double txDropProbability{ 0.0 };
+
+        /// @brief Probability that a byte to the host is lost.
+        double rxDropProbability{ 0.0 };
+
+        /// @brief Probability that a byte to the host is replaced by a random byte.
+        double noiseProbability{ 0.0 };
+
+        /// @brief Seed of the random generator for dropped bytes and noise.
+        uint32_t seed{ 1 };
+
+        /// @brief HR20_V1 only: time after the first received byte, till the thermostat is awake and listening.
+        uint32_t wakeupLatencyUs{ 60000 };
+
+        /// @brief HR20_V1 only: time after the last received byte, till the thermostat falls asleep again.
+        uint32_t awakeTimeoutUs{ 2000000 };
+
+        /// @brief OpenHR20 only: period of unsolicited status lines, 0 = no periodic status lines.
+        uint32_t statusBroadcastIntervalUs{ 0 };
+
+        /// @brief OpenHR20 only: send an unsolicited status line after the desired temperature or the mode was changed.
+        bool broadcastOnChange{ false };
+    };
+
+    /**
+     * @brief State of the OpenHR20 firmware
+     */
+    struct OpenHR20State
+    {
+        /// @brief true = automatic mode, false = manual mode
+        bool automatic{ false };
+
+        /// @brief desired temperature in 1/100 °C
+        int desiredTemperature{ 2100 };
+
+        /// @brief current temperature in 1/100 °C
+        int currentTemperature{ 2050 };
+
+        /// @brief position of the valve in percent %
+        int valvePosition{ 30 };
+
+        /// @brief battery voltage in mV
+        int batteryVoltage{ 3000 };
+
+        /// @brief EEPROM config, the preset temperatures are stored at 0x01 ... 0x04 in steps of 0.5°C
+        uint8_t config[0x100]{ 0x00, 10, 34, 40, 42 };
+
+        /// @brief switching times of day 0 (all days) and 1 (monday) ... 7 (sunday): preset << 12 | minutes, 0x0FFF = unused
+        uint16_t timers[8][8]{};
+    };
+
+    /**
+     * @brief C'tor
+     * @param config Configuration of the simulated serial line and thermostat.
+     */
+    explicit HR20Simulator(const Config& config)
+        : config_(config)
+        , random_(config.seed != 0u ? config.seed : 1u)
+    {
+        // desired temperature 21.0°C ((210 - 60) = 0x96) and manual mode
+        memory_[0x137] = 0x96;
+        memory_[0x20D] = 0x96;
+
+        // comfort at 06:00 and energy saving at 22:00 every day
+        for (auto& day : openHR20_.timers)
+        {
+            for (uint16_t& timer : day)
+            {
+                timer = 0x0FFF;
+            }
+            day[0] = (2u << 12) | (6u * 60u);
+            day[1] = (1u << 12) | (22u * 60u);
+        }
+    }
+
+    /**
+     * @brief Plug or unplug the thermostat (e.g. dead batteries). While unplugged, nothing is received or sent.
+     */
+    void SetConnected(bool connected) { connected_ = connected; }
+
+    // UARTComponent API
+
+    void write_array(const uint8_t* data, size_t len) override
+    {
+        for (size_t i = 0; i < len; ++i)
+        {
+            txLineFreeUs_ = maxUs(now(), txLineFreeUs_) + ByteTimeUs();
+            ++bytesFromHost_;
+
+            if (connected_ && !chance(config_.txDropProbability))
+            {
+                deviceInput_.push_back(TimedByte{ txLineFreeUs_, data[i] });
+            }
+        }
+    }
+
+    bool peek_byte(uint8_t* data) override
+    {
+        process();
+
+        if (!isAvailable())
+        {
+            return false;
+        }
+
+        *data = hostInput_.front().data;
+        return true;
+    }
+
+    bool read_array(uint8_t* data, size_t len) override
+    {
+        process();
+
+        if (static_cast<size_t>(available()) < len)
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < len; ++i)
+        {
+            data[i] = hostInput_.front().data;
+            hostInput_.pop_front();
+        }
+
+        return true;
+    }
+
+    int available() override
+    {
+        process();
+
+        int count = 0;
+        for (const TimedByte& timedByte : hostInput_)
+        {
+            if (timedByte.timeUs > now())
+            {
+                break;
+            }
+            ++count;
+        }
+
+        return count;
+    }
+
+    void flush() override { esphome::HostClock::Instance().WaitForTransfer(txLineFreeUs_); }
+
+    // Simulation API
+
+    /// @brief State of the OpenHR20 firmware, can be modified to simulate changes on the device.
+    OpenHR20State& GetOpenHR20State(void) { return openHR20_; }
+
+    /// @brief HR20_V1 memory, can be modified to simulate changes on the device.
+    uint8_t& Memory(uint16_t address) { return memory_[address % MEMORY_SIZE]; }
+
+    /// @brief Number of bytes sent by the host
+    uint32_t BytesFromHost(void) const { return bytesFromHost_; }
+
+    /// @brief Number of bytes sent by the thermostat
+    uint32_t BytesToHost(void) const { return bytesToHost_; }
+
+    /// @brief Number of commands, which were processed by the thermostat
+    uint32_t CommandsProcessed(void) const { return commandsProcessed_; }
+
+    /// @brief Send an unsolicited status line now (OpenHR20 only), e.g. after the state was modified.
+    void BroadcastStatus(void)
+    {
+        if (config_.protocol == Protocol::E_OPEN_HR20)
+        {
+            respond(statusLine(now()), now());
+        }
+    }
+
+    /// @brief Transmission time of one byte
+    uint64_t ByteTimeUs(void) const { return (1000000ull * config_.bitsPerByte) / config_.baudRate; }
+
+private:
+    /// @brief Size of the HR20_V1 memory
+    static constexpr size_t MEMORY_SIZE{ 0x400 };
+
+    /// @brief Max length of a command line
+    static constexpr size_t MAX_COMMAND_LENGTH{ 32 };
+
+    /**
+     * @brief A byte on the wire with the time stamp when it is completely received.
+     */
+    struct TimedByte
+    {
+        uint64_t timeUs;
+        uint8_t data;
+    };
+
+    static uint64_t maxUs(uint64_t a, uint64_t b) { return (a > b) ? a : b; }
+
+    static uint64_t now(void) { return esphome::HostClock::Instance().NowUs(); }
+
+    bool isAvailable(void) const { return !hostInput_.empty() && (hostInput_.front().timeUs <= now()); }
+
+    /**
+     * @brief xorshift32 random generator, so a simulation is reproducible with the same seed.
+     */
+    bool chance(double probability)
+    {
+        if (probability <= 0.0)
+        {
+            return false;
+        }
+
+        random_ ^= random_ << 13;
+        random_ ^= random_ >> 17;
+        random_ ^= random_ << 5;
+
+        return (static_cast<double>(random_) / 4294967296.0) < probability;
+    }
+
+    /**
+     * @brief Process all bytes, which were received by the thermostat till now.
+     */
+    void process(void)
+    {
+        while (!deviceInput_.empty() && (deviceInput_.front().timeUs <= now()))
+        {
+            const TimedByte timedByte = deviceInput_.front();
+            deviceInput_.pop_front();
+            receive(timedByte);
+        }
+
+        if ((config_.protocol == Protocol::E_OPEN_HR20) && (config_.statusBroadcastIntervalUs > 0u))
+        {
+            while ((lastBroadcastUs_ + config_.statusBroadcastIntervalUs) <= now())
+            {
+                lastBroadcastUs_ += config_.statusBroadcastIntervalUs;
+                respond(statusLine(lastBroadcastUs_), lastBroadcastUs_);
+            }
+        }
+    }
+
+    /**
+     * @brief One byte is received by the thermostat.
+     */
+    void receive(const TimedByte& timedByte)
+    {
+        if (config_.protocol == Protocol::E_HR20_V1)
+        {
+            // the thermostat is sleeping, the first byte wakes it up but is lost
+            const bool asleep = (timedByte.timeUs - lastActivityUs_) > config_.awakeTimeoutUs;
+            lastActivityUs_   = timedByte.timeUs;
+
+            if (asleep || !everAwake_)
+            {
+                everAwake_ = true;
+                awakeAtUs_ = timedByte.timeUs + config_.wakeupLatencyUs;
+            }
+
+            if (timedByte.timeUs < awakeAtUs_)
+            {
+                commandLine_.clear();
+                return;
+            }
+        }
+
+        if (timedByte.data == '\n')
+        {
+            execute(timedByte.timeUs);
+            commandLine_.clear();
+        }
+        else if ((timedByte.data != '\r') && (commandLine_.size() < MAX_COMMAND_LENGTH))
+        {
+            commandLine_.push_back(static_cast<char>(timedByte.data));
+        }
+    }
+
+    /**
+     * @brief Execute the received command line.
+     */
+    void execute(uint64_t receivedUs)
+    {
+        if (commandLine_.empty())
+        {
+            return;
+        }
+
+        ++commandsProcessed_;
+
+        if (config_.protocol == Protocol::E_OPEN_HR20)
+        {
+            executeOpenHR20(receivedUs);
+        }
+        else
+        {
+            executeHR20V1(receivedUs);
+        }
+    }
+
+    void executeOpenHR20(uint64_t receivedUs)
+    {
+        const char command = commandLine_[0];
+        const char* args   = commandLine_.c_str() + 1;
+
+        if (command == 'D')
+        {
+            respond(statusLine(receivedUs), receivedUs);
+        }
+        else if ((command == 'A') && (commandLine_.size() == 3u))
+        {
+            const long value = strtol(args, nullptr, 16);
+
+            // 0.5°C steps
+            if ((value >= 0x0A) && (value <= 0x3C))
+            {
+                openHR20_.desiredTemperature = static_cast<int>(value) * 50;
+                broadcastChange(receivedUs);
+            }
+        }
+        else if ((command == 'M') && (commandLine_.size() == 3u))
+        {
+            openHR20_.automatic = (strtol(args, nullptr, 16) != 0);
+            broadcastChange(receivedUs);
+        }
+        else if (((command == 'G') && (commandLine_.size() == 3u)) || ((command == 'S') && (commandLine_.size() == 5u)))
+        {
+            const unsigned address = static_cast<unsigned>(strtol(commandLine_.substr(1, 2).c_str(), nullptr, 16));
+            char buffer[MAX_COMMAND_LENGTH];
+
+            if (command == 'S')
+            {
+                openHR20_.config[address] = static_cast<uint8_t>(strtol(commandLine_.substr(3, 2).c_str(), nullptr, 16));
+            }
+
+            snprintf(buffer, sizeof(buffer), "G[%02x]=%02x\n", address, openHR20_.config[address]);
+            respond(buffer, receivedUs);
+        }
+        else if (((command == 'R') && (commandLine_.size() == 3u)) || ((command == 'W') && (commandLine_.size() == 7u)))
+        {
+            const unsigned day  = static_cast<unsigned>(strtol(commandLine_.substr(1, 1).c_str(), nullptr, 16)) % 8u;
+            const unsigned slot = static_cast<unsigned>(strtol(commandLine_.substr(2, 1).c_str(), nullptr, 16)) % 8u;
+            char buffer[MAX_COMMAND_LENGTH];
+
+            if (command == 'W')
+            {
+                openHR20_.timers[day][slot] = static_cast<uint16_t>(strtol(commandLine_.substr(3, 4).c_str(), nullptr, 16));
+            }
+
+            snprintf(buffer, sizeof(buffer), "R[%x%x]=%04x\n", day, slot, openHR20_.timers[day][slot]);
+            respond(buffer, receivedUs);
+        }
+        else
+        {
+            // unknown commands are ignored
+        }
+    }
+
+    void executeHR20V1(uint64_t receivedUs)
+    {
+        const char command = commandLine_[0];
+        char buffer[MAX_COMMAND_LENGTH];
+
+        if (command == 'K')
+        {
+            respond("K\r\n", receivedUs);
+        }
+        else if ((command == 'R') && (commandLine_.size() == 4u))
+        {
+            const uint16_t address = static_cast<uint16_t>(strtol(commandLine_.substr(1, 3).c_str(), nullptr, 16));
+            snprintf(buffer, sizeof(buffer), "M%03X%02X%02X\r\n", address, Memory(address), Memory(address + 1u));
+            respond(buffer, receivedUs);
+        }
+        else if ((command == 'W') && (commandLine_.size() == 8u))
+        {
+            const uint16_t address = static_cast<uint16_t>(strtol(commandLine_.substr(1, 3).c_str(), nullptr, 16));
+            const uint16_t value   = static_cast<uint16_t>(strtol(commandLine_.substr(4, 4).c_str(), nullptr, 16));
+
+            Memory(address)      = static_cast<uint8_t>(value >> 8);
+            Memory(address + 1u) = static_cast<uint8_t>(value & 0xFFu);
+
+            // the motor is switched off for a target temperature of 7.5°C, which is reported as 0
+            if ((address == 0x20C) && (Memory(address + 1u) == 0x0F))
+            {
+                Memory(address + 1u) = 0x00;
+            }
+
+            snprintf(buffer, sizeof(buffer), "M%03X%02X%02X\r\n", address, Memory(address), Memory(address + 1u));
+            respond(buffer, receivedUs);
+        }
+        else
+        {
+            // unknown commands are ignored
+        }
+    }
+
+    /**
+     * @brief Send an unsolicited status line after a change, if configured.
+     */
+    void broadcastChange(uint64_t receivedUs)
+    {
+        if (config_.broadcastOnChange)
+        {
+            respond(statusLine(receivedUs), receivedUs);
+        }
+    }
+
+    /**
+     * @brief Build the status line of the OpenHR20 firmware.
+     */
+    std::string statusLine(uint64_t timeUs) const
+    {
+        const uint32_t seconds = static_cast<uint32_t>(timeUs / 1000000u) + ((22u * 60u) + 1u) * 60u;
+        char buffer[96];
+
+        snprintf(buffer, sizeof(buffer), "D: d%u 10.01.14 %02u:%02u:%02u %c V: %02d I: %04d S: %04d B: %04d Is: %04x X\n",
+                 static_cast<unsigned>(((seconds / 86400u) % 7u) + 1u), static_cast<unsigned>((seconds / 3600u) % 24u),
+                 static_cast<unsigned>((seconds / 60u) % 60u), static_cast<unsigned>(seconds % 60u), openHR20_.automatic ? 'A' : 'M',
+                 openHR20_.valvePosition, openHR20_.currentTemperature, openHR20_.desiredTemperature, openHR20_.batteryVoltage, 0xb9);
+
+        return std::string(buffer);
+    }
+
+    /**
+     * @brief Queue the response bytes of the thermostat, starting after the response latency.
+     */
+    void respond(const std::string& response, uint64_t receivedUs)
+    {
+        const uint64_t startUs = receivedUs + config_.responseLatencyUs;
+
+        for (char c : response)
+        {
+            rxLineFreeUs_ = maxUs(startUs, rxLineFreeUs_) + ByteTimeUs();
+            ++bytesToHost_;
+
+            if (chance(config_.rxDropProbability))
+            {
+                continue;
+            }
+
+            uint8_t data = static_cast<uint8_t>(c);
+            if (chance(config_.noiseProbability))
+            {
+                data = static_cast<uint8_t>(random_ & 0xFFu);
+            }
+
+            hostInput_.push_back(TimedByte{ rxLineFreeUs_, data });
+        }
+    }
+
+    /// @brief Configuration
+    Config config_;
+
+    /// @brief State of the random generator
+    uint32_t random_;
+
+    /// @brief Bytes on the way from the host to the thermostat
+    std::deque<TimedByte> deviceInput_;
+
+    /// @brief Bytes on the way from the thermostat to the host
+    std::deque<TimedByte> hostInput_;
+
+    /// @brief Time stamps when the serial lines are free again
+    uint64_t txLineFreeUs_{ 0 };
+    uint64_t rxLineFreeUs_{ 0 };
+
+    /// @brief Received characters of the current command
+    std::string commandLine_;
+
+    /// @brief OpenHR20 time stamp of the last periodic status line
+    uint64_t lastBroadcastUs_{ 0 };
+
+    /// @brief HR20_V1 sleep state
+    bool everAwake_{ false };
+    uint64_t lastActivityUs_{ 0 };
+    uint64_t awakeAtUs_{ 0 };
+
+    /// @brief false while the thermostat is unplugged
+    bool connected_{ true };
+
+    /// @brief Firmware states
+    OpenHR20State openHR20_;
+    uint8_t memory_[MEMORY_SIZE]{};
+
+    /// @brief Statistics
+    uint32_t bytesFromHost_{ 0 };
+    uint32_t bytesToHost_{ 0 };
+    uint32_t commandsProcessed_{ 0 };
+};
+
+#endif
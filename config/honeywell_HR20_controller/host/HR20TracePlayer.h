@@ -0,0 +1,496 @@
+#ifndef HR20_TRACE_PLAYER_H
+#define HR20_TRACE_PLAYER_H
+
+/**
+ * @file HR20TracePlayer.h
+ *
+ * @brief Replays a captured UART trace (see HoneywellUartTrace.h) as UARTComponent on the virtual clock of the host shim.
+ *        The received bytes are delivered relative to the request which preceded them in the trace: as soon as the manager
+ *        sends the same request, the following responses arrive with the recorded delay. Unsolicited lines and the responses
+ *        to requests, which the manager does not send, arrive at the recorded time. The recorded delays are kept, so the
+ *        trace and the timeouts of the manager run on the same virtual clock.
+ *        HR20TraceRecorder writes a trace in the same format, e.g. of a simulated thermostat.
+ *
+ */
+
+#include "HoneywellUartTrace.h"
+#include "esphome.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+
+class HR20TracePlayer : public UARTComponent
+{
+public:
+    /**
+     * @brief One request or response of the trace. Consecutive chunks of a request are merged till the line feed.
+     */
+    struct Record
+    {
+        /// @brief Recorded time stamp in ms
+        uint32_t timeMs{ 0 };
+
+        /// @brief true = sent to the thermostat
+        bool tx{ false };
+
+        /// @brief The bytes of the chunk
+        std::string bytes;
+    };
+
+    /**
+     * @brief Replay configuration
+     */
+    struct Config
+    {
+        /// @brief Baud rate of the serial line, only used for the time between two received bytes
+        uint32_t baudRate{ 9600 };
+
+        /// @brief Number of bits on the wire per byte (start bit + data bits + parity + stop bits)
+        uint32_t bitsPerByte{ 10 };
+
+        /// @brief Time after the recorded time of a request, till it is treated as not sent by the manager
+        uint32_t requestWindowMs{ 2000 };
+    };
+
+    explicit HR20TracePlayer(const Config& config)
+        : config_(config)
+    {
+    }
+
+    /**
+     * @brief Load a trace file. Lines without a chunk are skipped.
+     * @return false if the file can not be opened or does not contain any chunk.
+     */
+    bool Load(const char* path)
+    {
+        FILE* file = fopen(path, "r");
+        char line[512];
+        uint32_t timeMs = 0;
+
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        records_.clear();
+
+        while (fgets(line, sizeof(line), file) != nullptr)
+        {
+            uint8_t data[HoneywellUartTrace::MAX_ESCAPED_LENGTH];
+            size_t length = sizeof(data);
+            bool tx       = false;
+
+            if (HoneywellUartTrace::ParseLine(line, timeMs, tx, data, length))
+            {
+                const bool merge = !records_.empty() && tx && records_.back().tx && !records_.back().bytes.empty() &&
+                                   (records_.back().bytes.back() != '\n');
+
+                if (!merge)
+                {
+                    records_.push_back(Record{ timeMs, tx, std::string() });
+                }
+
+                records_.back().timeMs = timeMs;
+                records_.back().bytes.append(reinterpret_cast<const char*>(data), length);
+            }
+        }
+
+        fclose(file);
+        Rewind();
+
+        return !records_.empty();
+    }
+
+    /**
+     * @brief Start the replay at the current time of the virtual clock.
+     */
+    void Rewind(void)
+    {
+        next_        = 0;
+        lastRequest_ = NO_REQUEST;
+        startUs_     = now();
+        rxFreeUs_    = 0;
+        matched_     = 0;
+        unmatched_   = 0;
+        missed_      = 0;
+        txLine_.clear();
+        hostInput_.clear();
+        sentUs_.assign(records_.size(), uint64_t{ NOT_SENT });
+        resolved_.assign(records_.size(), false);
+    }
+
+    /// @brief All records of the trace
+    const std::vector<Record>& Records(void) const { return records_; }
+
+    /**
+     * @brief Time on the virtual clock, when a record is due without regard to the requests of the manager.
+     */
+    uint64_t ScheduledUs(size_t index) const
+    {
+        const uint32_t offsetMs = records_[index].timeMs - records_[0].timeMs;
+        return startUs_ + (static_cast<uint64_t>(offsetMs) * 1000u);
+    }
+
+    /**
+     * @brief Check if all responses are delivered and received.
+     */
+    bool IsFinished(void)
+    {
+        process();
+        return (next_ >= records_.size()) && hostInput_.empty();
+    }
+
+    /// @brief Requests of the manager, which were found in the trace
+    uint32_t MatchedRequests(void) const { return matched_; }
+
+    /// @brief Requests of the manager, which are not in the trace
+    uint32_t UnmatchedRequests(void) const { return unmatched_; }
+
+    /// @brief Requests of the trace, which the manager did not send
+    uint32_t MissedRequests(void) const { return missed_; }
+
+    // UARTComponent API
+
+    void write_array(const uint8_t* data, size_t len) override
+    {
+        for (size_t i = 0; i < len; ++i)
+        {
+            txLine_.push_back(static_cast<char>(data[i]));
+
+            // all requests of both protocols end with a line feed
+            if (data[i] == '\n')
+            {
+                matchRequest(txLine_);
+                txLine_.clear();
+            }
+        }
+    }
+
+    bool peek_byte(uint8_t* data) override
+    {
+        if (available() == 0)
+        {
+            return false;
+        }
+
+        *data = hostInput_.front().data;
+        return true;
+    }
+
+    bool read_array(uint8_t* data, size_t len) override
+    {
+        if (static_cast<size_t>(available()) < len)
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < len; ++i)
+        {
+            data[i] = hostInput_.front().data;
+            hostInput_.pop_front();
+        }
+
+        return true;
+    }
+
+    int available() override
+    {
+        process();
+
+        int count = 0;
+        for (const TimedByte& timedByte : hostInput_)
+        {
+            if (timedByte.timeUs > now())
+            {
+                break;
+            }
+            ++count;
+        }
+
+        return count;
+    }
+
+    void flush() override {}
+
+private:
+    /// @brief Marker of a request, which was not sent (yet)
+    static constexpr uint64_t NOT_SENT{ UINT64_MAX };
+
+    /// @brief Marker of the last request, if no request was processed yet
+    static constexpr size_t NO_REQUEST{ SIZE_MAX };
+
+    /// @brief Number of recorded requests, which are compared with a request of the manager
+    static constexpr size_t MATCH_LOOKAHEAD{ 8 };
+
+    /**
+     * @brief A received byte with the time stamp when it is completely received.
+     */
+    struct TimedByte
+    {
+        uint64_t timeUs;
+        uint8_t data;
+    };
+
+    static uint64_t now(void) { return esphome::HostClock::Instance().NowUs(); }
+
+    uint64_t byteTimeUs(void) const
+    {
+        return (1000000u * config_.bitsPerByte) / config_.baudRate;
+    }
+
+    /**
+     * @brief Find a request of the manager in the next recorded requests.
+     */
+    void matchRequest(const std::string& request)
+    {
+        size_t compared = 0;
+
+        for (size_t i = next_; (i < records_.size()) && (compared < MATCH_LOOKAHEAD); ++i)
+        {
+            if (!records_[i].tx || resolved_[i])
+            {
+                continue;
+            }
+
+            if (records_[i].bytes == request)
+            {
+                sentUs_[i]   = now();
+                resolved_[i] = true;
+                ++matched_;
+                return;
+            }
+
+            ++compared;
+        }
+
+        ++unmatched_;
+    }
+
+    /**
+     * @brief Deliver all responses, whose request is resolved.
+     */
+    void process(void)
+    {
+        while (next_ < records_.size())
+        {
+            const Record& record = records_[next_];
+
+            if (record.tx)
+            {
+                if (!resolved_[next_])
+                {
+                    if (now() < (ScheduledUs(next_) + (static_cast<uint64_t>(config_.requestWindowMs) * 1000u)))
+                    {
+                        // the manager may still send it
+                        deliverAhead(next_);
+                        return;
+                    }
+
+                    resolved_[next_] = true;
+                    ++missed_;
+                }
+
+                lastRequest_ = next_;
+            }
+            else if (!resolved_[next_])
+            {
+                deliver(next_);
+            }
+
+            ++next_;
+        }
+    }
+
+    /**
+     * @brief Deliver the responses behind a request, which is not sent yet, if they can not be its response.
+     *        E.g. the manager sends a pipelined request only after it has read the response of the previous one,
+     *        but the response is recorded behind the pipelined request.
+     */
+    void deliverAhead(size_t request)
+    {
+        for (size_t i = request + 1u; (i < records_.size()) && !records_[i].tx; ++i)
+        {
+            // the request and the response need this time on the wire at least
+            const uint64_t wireUs = static_cast<uint64_t>((1000000.0 * config_.bitsPerByte * static_cast<double>(records_[request].bytes.size() + records_[i].bytes.size())) /
+                                                          static_cast<double>(config_.baudRate));
+
+            if ((static_cast<uint64_t>(records_[i].timeMs - records_[request].timeMs) * 1000u) >= wireUs)
+            {
+                return;
+            }
+
+            if (!resolved_[i])
+            {
+                resolved_[i] = true;
+                deliver(i);
+            }
+        }
+    }
+
+    /**
+     * @brief Queue the bytes of a response. The last byte arrives at the recorded delay after its request.
+     */
+    void deliver(size_t index)
+    {
+        const Record& record = records_[index];
+        uint64_t dueUs       = ScheduledUs(index);
+
+        // unsolicited lines and responses to requests, which were not sent by the manager, arrive at the recorded time
+        if ((lastRequest_ != NO_REQUEST) && (sentUs_[lastRequest_] != NOT_SENT))
+        {
+            const uint32_t delayMs = record.timeMs - records_[lastRequest_].timeMs;
+            dueUs                  = sentUs_[lastRequest_] + (static_cast<uint64_t>(delayMs) * 1000u);
+        }
+
+        const uint64_t byteUs   = byteTimeUs();
+        const uint64_t spreadUs = byteUs * (record.bytes.size() - 1u);
+        uint64_t timeUs         = (dueUs > spreadUs) ? (dueUs - spreadUs) : 0u;
+
+        for (char byte : record.bytes)
+        {
+            // the bytes can not arrive faster than the baud rate
+            timeUs    = (timeUs > (rxFreeUs_ + byteUs)) ? timeUs : (rxFreeUs_ + byteUs);
+            rxFreeUs_ = timeUs;
+            hostInput_.push_back(TimedByte{ timeUs, static_cast<uint8_t>(byte) });
+        }
+    }
+
+    Config config_;
+    std::vector<Record> records_;
+
+    /// @brief Time on the virtual clock, when the request was sent by the manager
+    std::vector<uint64_t> sentUs_;
+
+    /// @brief The request was sent by the manager or the request window is over, the response is delivered
+    std::vector<bool> resolved_;
+
+    /// @brief Next record, which is processed
+    size_t next_{ 0 };
+
+    /// @brief Last request in front of the next record
+    size_t lastRequest_{ NO_REQUEST };
+
+    /// @brief Time on the virtual clock when the replay was started
+    uint64_t startUs_{ 0 };
+
+    /// @brief Time when the last received byte arrives
+    uint64_t rxFreeUs_{ 0 };
+
+    /// @brief Request of the manager till the line feed
+    std::string txLine_;
+
+    /// @brief Bytes to the host
+    std::deque<TimedByte> hostInput_;
+
+    uint32_t matched_{ 0 };
+    uint32_t unmatched_{ 0 };
+    uint32_t missed_{ 0 };
+};
+
+/**
+ * @brief Records the communication with another UARTComponent (e.g. HR20Simulator) in the capture format of HoneywellUartTrace.h.
+ *        Every request and every received line is one chunk, like the uart debug sequence with a line terminator as delimiter.
+ */
+class HR20TraceRecorder : public UARTComponent
+{
+public:
+    /**
+     * @brief C'tor
+     * @param uart The recorded UARTComponent.
+     * @param file The trace is written to this file.
+     */
+    HR20TraceRecorder(UARTComponent& uart, FILE* file)
+        : uart_(uart)
+        , file_(file)
+    {
+    }
+
+    void write_array(const uint8_t* data, size_t len) override
+    {
+        uart_.write_array(data, len);
+        append(true, data, len);
+    }
+
+    bool peek_byte(uint8_t* data) override { return uart_.peek_byte(data); }
+
+    bool read_array(uint8_t* data, size_t len) override
+    {
+        if (!uart_.read_array(data, len))
+        {
+            return false;
+        }
+
+        append(false, data, len);
+        return true;
+    }
+
+    int available() override { return uart_.available(); }
+
+    void flush() override { uart_.flush(); }
+
+    /**
+     * @brief Write the bytes, which were not terminated yet, e.g. at the end of the recording.
+     */
+    void Flush(void)
+    {
+        writeChunk(true);
+        writeChunk(false);
+    }
+
+private:
+    /**
+     * @brief Collect the bytes of one direction till a line terminator and write them as one chunk.
+     *        The time stamp is taken at the last byte in front of the terminator, because the engine often reads the terminator
+     *        of a response with the next transaction.
+     */
+    void append(bool tx, const uint8_t* data, size_t len)
+    {
+        std::vector<uint8_t>& chunk = tx ? tx_ : rx_;
+        uint32_t& timeMs            = tx ? txTimeMs_ : rxTimeMs_;
+
+        for (size_t i = 0; i < len; ++i)
+        {
+            const bool terminator = (data[i] == '\n') || (data[i] == '\r');
+
+            if (!terminator || chunk.empty())
+            {
+                timeMs = millis();
+            }
+
+            chunk.push_back(data[i]);
+
+            if (terminator || (chunk.size() >= HoneywellUartTrace::MAX_CHUNK_LENGTH))
+            {
+                writeChunk(tx);
+            }
+        }
+    }
+
+    /**
+     * @brief Write the collected bytes of one direction as one line.
+     */
+    void writeChunk(bool tx)
+    {
+        std::vector<uint8_t>& chunk = tx ? tx_ : rx_;
+        char escaped[HoneywellUartTrace::MAX_ESCAPED_LENGTH];
+
+        if (!chunk.empty())
+        {
+            HoneywellUartTrace::Escape(chunk.data(), chunk.size(), escaped, sizeof(escaped));
+            fprintf(file_, "%u %s \"%s\"\n", static_cast<unsigned>(tx ? txTimeMs_ : rxTimeMs_), tx ? "TX" : "RX", escaped);
+            chunk.clear();
+        }
+    }
+
+    UARTComponent& uart_;
+    FILE* file_;
+    std::vector<uint8_t> tx_;
+    std::vector<uint8_t> rx_;
+    uint32_t txTimeMs_{ 0 };
+    uint32_t rxTimeMs_{ 0 };
+};
+
+#endif
@@ -0,0 +1,816 @@
+#ifndef HOST_ESPHOME_H
+#define HOST_ESPHOME_H
+
+/**
+ * @file esphome.h
+ *
+ * @brief Host shim of the ESPHome API, which is used by the Honeywell managers and the climate adapter.
+ *        It replaces the real "esphome.h" when the headers are compiled on Linux (add this directory to the include path).
+ *        The time is simulated: delay() does not sleep, but advances a virtual clock. So the simulated thermostat
+ *        is able to deliver its bytes at the right time and the time spent in delay() and flush() can be measured.
+ *        The components (scheduler, climate, sensors, preferences and API events) only keep their state in memory,
+ *        App.loop() runs the timers and the loop() of all components at the time of the virtual clock.
+ *
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace esphome
+{
+
+/**
+ * @brief Virtual clock of the host simulation.
+ */
+class HostClock
+{
+public:
+    /**
+     * @brief Get the global clock instance.
+     */
+    static HostClock& Instance(void)
+    {
+        static HostClock clock;
+        return clock;
+    }
+
+    /**
+     * @brief Current virtual time in µs.
+     */
+    uint64_t NowUs(void) const { return nowUs_; }
+
+    /**
+     * @brief Advance the time because the caller is sleeping (delay()).
+     */
+    void Sleep(uint64_t durationUs)
+    {
+        nowUs_ += durationUs;
+        sleepUs_ += durationUs;
+    }
+
+    /**
+     * @brief Advance the time because the caller is waiting for the transmission of bytes (flush()).
+     */
+    void WaitForTransfer(uint64_t untilUs)
+    {
+        if (untilUs > nowUs_)
+        {
+            transferUs_ += untilUs - nowUs_;
+            nowUs_ = untilUs;
+        }
+    }
+
+    /**
+     * @brief Advance the time because the caller is doing some work.
+     */
+    void Advance(uint64_t durationUs) { nowUs_ += durationUs; }
+
+    /// @brief Total time spent in delay()
+    uint64_t SleepUs(void) const { return sleepUs_; }
+
+    /// @brief Total time spent in flush(), waiting for the transmission of bytes
+    uint64_t TransferUs(void) const { return transferUs_; }
+
+    /**
+     * @brief Reset the sleep and transfer statistics. The time itself is monotonic.
+     */
+    void ResetStatistics(void)
+    {
+        sleepUs_    = 0;
+        transferUs_ = 0;
+    }
+
+private:
+    HostClock() = default;
+
+    uint64_t nowUs_{ 0 };
+    uint64_t sleepUs_{ 0 };
+    uint64_t transferUs_{ 0 };
+};
+
+inline uint32_t millis()
+{
+    return static_cast<uint32_t>(HostClock::Instance().NowUs() / 1000u);
+}
+
+inline uint32_t micros()
+{
+    return static_cast<uint32_t>(HostClock::Instance().NowUs());
+}
+
+inline void delay(uint32_t ms)
+{
+    HostClock::Instance().Sleep(static_cast<uint64_t>(ms) * 1000u);
+}
+
+inline void delayMicroseconds(uint32_t us)
+{
+    HostClock::Instance().Sleep(us);
+}
+
+/**
+ * @brief Deterministic pseudo random numbers (xorshift), so every run of the simulation is reproducible.
+ */
+inline uint32_t random_uint32()
+{
+    static uint32_t state{ 0x2545F491u };
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/**
+ * @brief Value which may be missing, same API as esphome::optional.
+ */
+template <typename T>
+class optional
+{
+public:
+    optional() = default;
+    optional(const T& value)
+        : value_(value)
+        , has_value_(true)
+    {
+    }
+
+    bool has_value() const { return has_value_; }
+    const T& value() const { return value_; }
+    const T& operator*() const { return value_; }
+    T& operator*() { return value_; }
+    void reset() { has_value_ = false; }
+
+private:
+    T value_{};
+    bool has_value_{ false };
+};
+
+/**
+ * @brief FNV-1 hash of a string, used for the object id hash of the entities.
+ */
+inline uint32_t fnv1_hash(const std::string& str)
+{
+    uint32_t hash = 2166136261u;
+
+    for (char c : str)
+    {
+        hash *= 16777619u;
+        hash ^= static_cast<uint8_t>(c);
+    }
+
+    return hash;
+}
+
+class Component;
+
+/**
+ * @brief Timers of the components (set_timeout() and set_interval()), executed on the virtual clock by App.loop().
+ */
+class HostScheduler
+{
+public:
+    static HostScheduler& Instance(void)
+    {
+        static HostScheduler scheduler;
+        return scheduler;
+    }
+
+    /**
+     * @brief Add a timer, replaces the timer of the component with the same name and kind.
+     *        Like ESPHome, an interval is executed the first time after a random offset of up to half the interval.
+     */
+    void Set(Component* component, const std::string& name, bool interval, uint32_t timeMs, std::function<void()> callback)
+    {
+        Cancel(component, name, interval);
+
+        const uint64_t delayMs = interval ? (random_uint32() % ((timeMs / 2u) + 1u)) : timeMs;
+        items_.push_back(Item{ component, name, interval, timeMs, HostClock::Instance().NowUs() + (delayMs * 1000u), callback, false });
+    }
+
+    /**
+     * @brief Remove a timer.
+     * @return false if there was no such timer.
+     */
+    bool Cancel(Component* component, const std::string& name, bool interval)
+    {
+        bool found = false;
+
+        for (Item& item : items_)
+        {
+            if (!item.removed && (item.component == component) && (item.interval == interval) && (item.name == name))
+            {
+                item.removed = true;
+                found        = true;
+            }
+        }
+
+        return found;
+    }
+
+    /**
+     * @brief Remove all timers of a component.
+     */
+    void CancelAll(Component* component)
+    {
+        for (Item& item : items_)
+        {
+            item.removed = item.removed || (item.component == component);
+        }
+    }
+
+    /**
+     * @brief Execute the timers, which are due. A callback may add or remove timers.
+     */
+    void Call(void)
+    {
+        for (size_t i = 0; i < items_.size(); ++i)
+        {
+            if (items_[i].removed || (items_[i].dueUs > HostClock::Instance().NowUs()))
+            {
+                continue;
+            }
+
+            std::function<void()> callback = items_[i].callback;
+
+            if (items_[i].interval)
+            {
+                items_[i].dueUs += static_cast<uint64_t>(items_[i].timeMs) * 1000u;
+            }
+            else
+            {
+                items_[i].removed = true;
+            }
+
+            callback();
+        }
+
+        size_t kept = 0;
+
+        for (size_t i = 0; i < items_.size(); ++i)
+        {
+            if (!items_[i].removed)
+            {
+                items_[kept++] = items_[i];
+            }
+        }
+        items_.resize(kept);
+    }
+
+private:
+    struct Item
+    {
+        Component* component;
+        std::string name;
+        bool interval;
+        uint32_t timeMs;
+        uint64_t dueUs;
+        std::function<void()> callback;
+        bool removed;
+    };
+
+    std::vector<Item> items_;
+};
+
+/**
+ * @brief Host version of the ESPHome component, the timers run on the virtual clock.
+ */
+class Component
+{
+public:
+    virtual ~Component();
+
+    virtual void setup() {}
+    virtual void loop() {}
+    virtual void dump_config() {}
+
+    /// @brief Called by App.setup()
+    virtual void call_setup() { setup(); }
+
+    void mark_failed() { failed_ = true; }
+    bool is_failed() const { return failed_; }
+
+    void status_set_warning(const char* = nullptr) { warning_ = true; }
+    void status_clear_warning() { warning_ = false; }
+    bool status_has_warning() const { return warning_; }
+
+protected:
+    void set_interval(const std::string& name, uint32_t interval, std::function<void()> callback)
+    {
+        HostScheduler::Instance().Set(this, name, true, interval, callback);
+    }
+    bool cancel_interval(const std::string& name) { return HostScheduler::Instance().Cancel(this, name, true); }
+
+    void set_timeout(const std::string& name, uint32_t timeout, std::function<void()> callback)
+    {
+        HostScheduler::Instance().Set(this, name, false, timeout, callback);
+    }
+    bool cancel_timeout(const std::string& name) { return HostScheduler::Instance().Cancel(this, name, false); }
+
+private:
+    bool failed_{ false };
+    bool warning_{ false };
+};
+
+/**
+ * @brief Host version of the ESPHome polling component, update() is called in the update interval.
+ */
+class PollingComponent : public Component
+{
+public:
+    PollingComponent() = default;
+    explicit PollingComponent(uint32_t update_interval)
+        : update_interval_(update_interval)
+    {
+    }
+
+    virtual void update() = 0;
+
+    void call_setup() override
+    {
+        setup();
+        start_poller();
+    }
+
+    virtual void set_update_interval(uint32_t update_interval) { update_interval_ = update_interval; }
+    virtual uint32_t get_update_interval() const { return update_interval_; }
+
+    void start_poller() { set_interval("update", get_update_interval(), [this]() { update(); }); }
+    void stop_poller() { cancel_interval("update"); }
+
+private:
+    uint32_t update_interval_{ 0 };
+};
+
+/**
+ * @brief Host version of the ESPHome application: setup() and loop() of all registered components.
+ */
+class Application
+{
+public:
+    static Application& Instance(void)
+    {
+        static Application application;
+        return application;
+    }
+
+    template <typename C>
+    C* register_component(C* component)
+    {
+        components_.push_back(component);
+        return component;
+    }
+
+    void unregister_component(Component* component)
+    {
+        for (size_t i = 0; i < components_.size(); ++i)
+        {
+            if (components_[i] == component)
+            {
+                components_.erase(components_.begin() + static_cast<std::ptrdiff_t>(i));
+                return;
+            }
+        }
+    }
+
+    void setup()
+    {
+        for (Component* component : components_)
+        {
+            component->call_setup();
+        }
+    }
+
+    void loop()
+    {
+        HostScheduler::Instance().Call();
+
+        for (Component* component : components_)
+        {
+            component->loop();
+        }
+    }
+
+private:
+    std::vector<Component*> components_;
+};
+
+inline Component::~Component()
+{
+    HostScheduler::Instance().CancelAll(this);
+    Application::Instance().unregister_component(this);
+}
+
+/// @brief The application, App.setup() and App.loop() are called by the simulated main loop
+static Application& App __attribute__((unused)) = Application::Instance();
+
+/**
+ * @brief Host version of the ESPHome entity, the base of the climate and sensor components.
+ */
+class EntityBase
+{
+public:
+    void set_name(const char* name) { name_ = name; }
+    const std::string& get_name() const { return name_; }
+    uint32_t get_object_id_hash() { return fnv1_hash(name_); }
+
+private:
+    std::string name_;
+};
+
+/**
+ * @brief Preference in the flash, the host keeps it in memory till the end of the process (e.g. over a simulated reboot).
+ */
+class ESPPreferenceObject
+{
+public:
+    ESPPreferenceObject() = default;
+    ESPPreferenceObject(std::map<uint32_t, std::vector<uint8_t>>* store, uint32_t key)
+        : store_(store)
+        , key_(key)
+    {
+    }
+
+    template <typename T>
+    bool save(const T* src)
+    {
+        if (store_ == nullptr)
+        {
+            return false;
+        }
+
+        (*store_)[key_].assign(reinterpret_cast<const uint8_t*>(src), reinterpret_cast<const uint8_t*>(src) + sizeof(T));
+        return true;
+    }
+
+    template <typename T>
+    bool load(T* dest)
+    {
+        if ((store_ == nullptr) || (store_->count(key_) == 0u) || ((*store_)[key_].size() != sizeof(T)))
+        {
+            return false;
+        }
+
+        memcpy(dest, (*store_)[key_].data(), sizeof(T));
+        return true;
+    }
+
+private:
+    std::map<uint32_t, std::vector<uint8_t>>* store_{ nullptr };
+    uint32_t key_{ 0 };
+};
+
+/**
+ * @brief Host version of the ESPHome preferences.
+ */
+class ESPPreferences
+{
+public:
+    static ESPPreferences& Instance(void)
+    {
+        static ESPPreferences preferences;
+        return preferences;
+    }
+
+    template <typename T>
+    ESPPreferenceObject make_preference(uint32_t type, bool = false)
+    {
+        return ESPPreferenceObject(&store_, type);
+    }
+
+    /// @brief Number of saved preferences
+    size_t Count(void) const { return store_.size(); }
+
+    /// @brief Remove all preferences, e.g. a new node
+    void Clear(void) { store_.clear(); }
+
+private:
+    std::map<uint32_t, std::vector<uint8_t>> store_;
+};
+
+/// @brief The preferences of the node
+static ESPPreferences* global_preferences __attribute__((unused)) = &ESPPreferences::Instance();
+
+namespace sensor
+{
+
+/**
+ * @brief Host version of the ESPHome sensor, keeps the last published value.
+ */
+class Sensor : public EntityBase
+{
+public:
+    void publish_state(float state)
+    {
+        this->state = state;
+        has_state_  = true;
+        ++publishes_;
+    }
+
+    bool has_state() const { return has_state_; }
+    float get_state() const { return state; }
+
+    /// @brief Number of published values
+    uint32_t Publishes(void) const { return publishes_; }
+
+    float state{ NAN };
+
+private:
+    bool has_state_{ false };
+    uint32_t publishes_{ 0 };
+};
+
+} // namespace sensor
+
+namespace binary_sensor
+{
+
+/**
+ * @brief Host version of the ESPHome binary sensor, keeps the last published value.
+ */
+class BinarySensor : public EntityBase
+{
+public:
+    void publish_state(bool state)
+    {
+        this->state = state;
+        has_state_  = true;
+    }
+
+    bool has_state() const { return has_state_; }
+
+    bool state{ false };
+
+private:
+    bool has_state_{ false };
+};
+
+} // namespace binary_sensor
+
+namespace climate
+{
+
+enum ClimateMode : uint8_t
+{
+    CLIMATE_MODE_OFF = 0,
+    CLIMATE_MODE_HEAT_COOL,
+    CLIMATE_MODE_COOL,
+    CLIMATE_MODE_HEAT,
+    CLIMATE_MODE_FAN_ONLY,
+    CLIMATE_MODE_DRY,
+    CLIMATE_MODE_AUTO
+};
+
+/**
+ * @brief Capabilities of a climate device.
+ */
+class ClimateTraits
+{
+public:
+    void set_supports_current_temperature(bool supports) { supports_current_temperature_ = supports; }
+    bool get_supports_current_temperature() const { return supports_current_temperature_; }
+    void set_supported_modes(std::set<ClimateMode> modes) { supported_modes_ = modes; }
+    const std::set<ClimateMode>& get_supported_modes() const { return supported_modes_; }
+    void set_visual_min_temperature(float temperature) { visual_min_temperature_ = temperature; }
+    void set_visual_max_temperature(float temperature) { visual_max_temperature_ = temperature; }
+    void set_visual_temperature_step(float step) { visual_temperature_step_ = step; }
+
+private:
+    bool supports_current_temperature_{ false };
+    std::set<ClimateMode> supported_modes_;
+    float visual_min_temperature_{ 10.0f };
+    float visual_max_temperature_{ 30.0f };
+    float visual_temperature_step_{ 0.1f };
+};
+
+class Climate;
+
+/**
+ * @brief Request of Home Assistant to change the climate device.
+ */
+class ClimateCall
+{
+public:
+    explicit ClimateCall(Climate* parent)
+        : parent_(parent)
+    {
+    }
+
+    ClimateCall& set_mode(ClimateMode mode)
+    {
+        mode_ = mode;
+        return *this;
+    }
+    ClimateCall& set_target_temperature(float target_temperature)
+    {
+        target_temperature_ = target_temperature;
+        return *this;
+    }
+
+    const optional<ClimateMode>& get_mode() const { return mode_; }
+    const optional<float>& get_target_temperature() const { return target_temperature_; }
+
+    void perform();
+
+private:
+    Climate* parent_;
+    optional<ClimateMode> mode_;
+    optional<float> target_temperature_;
+};
+
+/**
+ * @brief Host version of the ESPHome climate device, publish_state() calls the state callbacks (e.g. the API).
+ */
+class Climate : public EntityBase
+{
+public:
+    virtual ~Climate() = default;
+
+    ClimateCall make_call() { return ClimateCall(this); }
+    ClimateTraits get_traits() { return traits(); }
+
+    void add_on_state_callback(std::function<void(Climate&)> callback) { state_callbacks_.push_back(callback); }
+
+    void publish_state()
+    {
+        for (auto& callback : state_callbacks_)
+        {
+            callback(*this);
+        }
+    }
+
+    ClimateMode mode{ CLIMATE_MODE_OFF };
+    float target_temperature{ NAN };
+    float current_temperature{ NAN };
+
+protected:
+    friend ClimateCall;
+
+    virtual void control(const ClimateCall& call) = 0;
+    virtual ClimateTraits traits()                = 0;
+
+private:
+    std::vector<std::function<void(Climate&)>> state_callbacks_;
+};
+
+inline void ClimateCall::perform() { parent_->control(*this); }
+
+} // namespace climate
+
+namespace api
+{
+
+/**
+ * @brief Connection of Home Assistant, the fired events are kept in memory.
+ */
+class HostApiServer
+{
+public:
+    static HostApiServer& Instance(void)
+    {
+        static HostApiServer server;
+        return server;
+    }
+
+    /// @brief An event of Home Assistant
+    struct Event
+    {
+        std::string name;
+        std::map<std::string, std::string> data;
+    };
+
+    bool connected{ false };
+    std::vector<Event> events;
+};
+
+/**
+ * @brief Host version of the ESPHome custom API device.
+ */
+class CustomAPIDevice
+{
+public:
+    bool is_connected() const { return HostApiServer::Instance().connected; }
+
+    void fire_homeassistant_event(const std::string& event_name, const std::map<std::string, std::string>& data = {})
+    {
+        HostApiServer::Instance().events.push_back(HostApiServer::Event{ event_name, data });
+    }
+};
+
+} // namespace api
+
+namespace uart
+{
+
+/**
+ * @brief Host version of the ESPHome UART component. The hardware is replaced by a derived class (e.g. a simulated thermostat).
+ */
+class UARTComponent
+{
+public:
+    virtual ~UARTComponent() = default;
+
+    virtual void write_array(const uint8_t* data, size_t len) = 0;
+    virtual bool peek_byte(uint8_t* data)                     = 0;
+    virtual bool read_array(uint8_t* data, size_t len)        = 0;
+    virtual int available()                                   = 0;
+    virtual void flush()                                      = 0;
+};
+
+/**
+ * @brief Host version of the ESPHome UART device. Same API as the original, all calls are forwarded to the parent component.
+ */
+class UARTDevice
+{
+public:
+    UARTDevice() = default;
+    UARTDevice(UARTComponent* parent)
+        : parent_(parent)
+    {
+    }
+
+    void set_uart_parent(UARTComponent* parent) { parent_ = parent; }
+
+    void write_byte(uint8_t data) { parent_->write_array(&data, 1); }
+    void write_array(const uint8_t* data, size_t len) { parent_->write_array(data, len); }
+    void write_str(const char* str)
+    {
+        size_t len{ 0 };
+        while (str[len] != '\0')
+        {
+            ++len;
+        }
+        parent_->write_array(reinterpret_cast<const uint8_t*>(str), len);
+    }
+
+    bool read_byte(uint8_t* data) { return parent_->read_array(data, 1); }
+    bool peek_byte(uint8_t* data) { return parent_->peek_byte(data); }
+    bool read_array(uint8_t* data, size_t len) { return parent_->read_array(data, len); }
+    int available() { return parent_->available(); }
+    void flush() { parent_->flush(); }
+
+    // Arduino Stream compatibility
+    size_t write(uint8_t data)
+    {
+        write_byte(data);
+        return 1;
+    }
+    int read()
+    {
+        uint8_t data;
+        if (!read_byte(&data))
+        {
+            return -1;
+        }
+        return data;
+    }
+    int peek()
+    {
+        uint8_t data;
+        if (!peek_byte(&data))
+        {
+            return -1;
+        }
+        return data;
+    }
+
+protected:
+    UARTComponent* parent_{ nullptr };
+};
+
+} // namespace uart
+} // namespace esphome
+
+#ifndef HOST_LOG_LEVEL
+/// @brief 0 = none, 1 = error, 2 = warning, 3 = info, 4 = debug, 5 = verbose
+#define HOST_LOG_LEVEL 2
+#endif
+
+#define HOST_LOG(level, letter, tag, format, ...)                                                                                          \
+    do                                                                                                                                     \
+    {                                                                                                                                      \
+        if (HOST_LOG_LEVEL >= (level))                                                                                                     \
+        {                                                                                                                                  \
+            printf("[%s][%s]: " format "\n", letter, tag, ##__VA_ARGS__);                                                                  \
+        }                                                                                                                                  \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) HOST_LOG(1, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) HOST_LOG(2, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) HOST_LOG(3, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGCONFIG(tag, format, ...) HOST_LOG(3, "C", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) HOST_LOG(4, "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) HOST_LOG(5, "V", tag, format, ##__VA_ARGS__)
+
+using namespace esphome;
+using namespace esphome::uart;
+using namespace esphome::climate;
+
+#endif
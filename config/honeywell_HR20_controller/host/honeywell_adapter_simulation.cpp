@@ -0,0 +1,468 @@
+/**
+ * @file honeywell_adapter_simulation.cpp
+ *
+ * @brief Runs the ESPHome climate adapter against the simulated HR20 thermostat on the host.
+ *        The adapter is set up and looped like by the ESPHome application, the timers (polling, settle time, statistics)
+ *        run on the virtual clock. The published climate state is compared with the state of the simulated thermostat.
+ *        The passive listening and the polling of status lines, the writes from Home Assistant, the external temperature
+ *        sensor, the suppression of unchanged publishes, the restored state after a reboot, the cached protocol detection,
+ *        the availability, the history backfill, the bus and the I/O task are checked.
+ *
+ *        Build & run (from this directory, the adapter needs C++17):
+ *          g++ -std=gnu++17 -O2 -I. -I.. -I../../common honeywell_adapter_simulation.cpp -o honeywell_adapter_simulation
+ *          ./honeywell_adapter_simulation
+ *
+ *        Options: --baud <rate> --latency-us <us> --seed <n>
+ */
+
+// the components of the node, like the defines.h of an ESPHome build
+#define USE_API
+#define USE_BINARY_SENSOR
+#define USE_SENSOR
+
+#include "EsphomeClimateHoneywellAdapter.h"
+#include "EsphomeHoneywellBus.h"
+#include "HR20Simulator.h"
+#include "HoneywellHistory.h"
+#include "HoneywellIoTask.h"
+#include "HoneywellManager_AutoDetect.h"
+#include "HoneywellManager_HR20_V1.h"
+#include "HoneywellManager_OpenHR20.h"
+#include "esphome.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace
+{
+
+/// @brief Period of the simulated ESPHome main loop
+constexpr uint32_t LOOP_PERIOD_US{ 1000 };
+
+int failures = 0;
+
+/**
+ * @brief Print one line of the report.
+ */
+void report(const char* adapter, const char* check, bool passed)
+{
+    printf("%-10s %-46s %s\n", adapter, check, passed ? "ok" : "FAILED");
+
+    if (!passed)
+    {
+        ++failures;
+    }
+}
+
+/**
+ * @brief Run the ESPHome main loop for the given time.
+ */
+void runFor(uint32_t durationMs)
+{
+    const uint64_t startUs = esphome::HostClock::Instance().NowUs();
+
+    while ((esphome::HostClock::Instance().NowUs() - startUs) < (static_cast<uint64_t>(durationMs) * 1000u))
+    {
+        App.loop();
+        esphome::HostClock::Instance().Advance(LOOP_PERIOD_US);
+    }
+}
+
+/**
+ * @brief Compare a temperature of the climate state with a value in 1/10 °C.
+ */
+bool isTemperature(float temperature, int tenths)
+{
+    return !std::isnan(temperature) && (lroundf(temperature * 10.0f) == tenths);
+}
+
+/**
+ * @brief Status lines of the OpenHR20 firmware, written state from Home Assistant and suppressed publishes.
+ */
+void runOpenHR20(const HR20Simulator::Config& baseConfig)
+{
+    HR20Simulator::Config config     = baseConfig;
+    config.protocol                  = HR20Simulator::Protocol::E_OPEN_HR20;
+    config.statusBroadcastIntervalUs = 60000000u;
+    config.broadcastOnChange         = true;
+    HR20Simulator simulator(config);
+    HR20Simulator::OpenHR20State& device = simulator.GetOpenHR20State();
+    EsphomeClimateHoneywellAdapter<HoneywellManager_OpenHR20> adapter(&simulator);
+    uint32_t publishes = 0;
+
+    ESPPreferences::Instance().Clear();
+    adapter.set_name("OpenHR20");
+    adapter.add_on_state_callback([&](Climate&) { ++publishes; });
+    App.register_component(&adapter);
+    App.setup();
+
+    runFor(65000);
+    report("OpenHR20", "Status line published",
+           isTemperature(adapter.current_temperature, 205) && isTemperature(adapter.target_temperature, 210)
+               && (adapter.mode == CLIMATE_MODE_HEAT));
+    report("OpenHR20", "Traits with current temperature", adapter.get_traits().get_supports_current_temperature());
+
+    // the slider is dragged, only the last value is written after the settle time.
+    // The status line after the change confirms the value, it is not read back once more.
+    const uint32_t commandsBefore = simulator.CommandsProcessed();
+    adapter.make_call().set_target_temperature(19.0f).perform();
+    runFor(500);
+    adapter.make_call().set_target_temperature(19.5f).perform();
+    runFor(10000);
+    report("OpenHR20", "Target temperature written",
+           (device.desiredTemperature == 1950) && isTemperature(adapter.target_temperature, 195)
+               && (simulator.CommandsProcessed() == (commandsBefore + 1u)));
+
+    // a status line with the old value, received before the write is confirmed, does not reset the GUI
+    bool jumped_back = false;
+    simulator.BroadcastStatus();
+    runFor(1000);
+    adapter.set_write_settle_time(0);
+    adapter.add_on_state_callback([&](Climate& climate) { jumped_back = jumped_back || isTemperature(climate.target_temperature, 195); });
+    adapter.make_call().set_target_temperature(20.0f).perform();
+    device.currentTemperature = 2010;
+    simulator.BroadcastStatus();
+    runFor(10000);
+    report("OpenHR20", "No jump back till the write is confirmed",
+           !jumped_back && (device.desiredTemperature == 2000) && isTemperature(adapter.target_temperature, 200)
+               && isTemperature(adapter.current_temperature, 201));
+
+    adapter.make_call().set_mode(CLIMATE_MODE_AUTO).perform();
+    runFor(10000);
+    report("OpenHR20", "Automatic mode written", device.automatic && (adapter.mode == CLIMATE_MODE_AUTO));
+
+    // nothing changes, the periodic status lines are not published again
+    const uint32_t publishesBefore = publishes;
+    runFor(10u * 60u * 1000u);
+    report("OpenHR20", "Unchanged status lines suppressed", publishes == publishesBefore);
+
+    device.currentTemperature = 1930;
+    simulator.BroadcastStatus();
+    runFor(1000);
+    report("OpenHR20", "Changed status line published",
+           (publishes == (publishesBefore + 1u)) && isTemperature(adapter.current_temperature, 193));
+}
+
+/**
+ * @brief OpenHR20 without passive listening, the status lines are polled.
+ */
+void runOpenHR20Polling(const HR20Simulator::Config& baseConfig)
+{
+    HR20Simulator::Config config = baseConfig;
+    config.protocol              = HR20Simulator::Protocol::E_OPEN_HR20;
+    HR20Simulator simulator(config);
+    HR20Simulator::OpenHR20State& device = simulator.GetOpenHR20State();
+    EsphomeClimateHoneywellAdapter<HoneywellManager_OpenHR20> adapter(&simulator);
+
+    ESPPreferences::Instance().Clear();
+    adapter.set_name("Polling");
+    adapter.set_passive_listening(false);
+    App.register_component(&adapter);
+    App.setup();
+
+    runFor(20000);
+    report("Polling", "Room temperature read", isTemperature(adapter.current_temperature, 205) && isTemperature(adapter.target_temperature, 210));
+
+    // the valve moves, so the next poll follows after the fast interval
+    device.currentTemperature = 1980;
+    device.valvePosition      = 60;
+    runFor(20u * 60u * 1000u);
+    report("Polling", "Changed room temperature read", isTemperature(adapter.current_temperature, 198));
+}
+
+/**
+ * @brief HR20_V1 with an external temperature sensor, the target temperature is written from Home Assistant.
+ */
+void runHR20V1(const HR20Simulator::Config& baseConfig)
+{
+    HR20Simulator::Config config = baseConfig;
+    config.protocol              = HR20Simulator::Protocol::E_HR20_V1;
+    HR20Simulator simulator(config);
+    sensor::Sensor roomSensor;
+    EsphomeClimateHoneywellAdapter<HoneywellManager_HR20_V1> adapter(&simulator, &roomSensor);
+
+    ESPPreferences::Instance().Clear();
+    adapter.set_name("HR20_V1");
+    App.register_component(&adapter);
+    roomSensor.publish_state(19.2f);
+    App.setup();
+
+    runFor(20000);
+    report("HR20_V1", "State read", isTemperature(adapter.target_temperature, 210) && isTemperature(adapter.current_temperature, 192));
+    report("HR20_V1", "Traits with external sensor", adapter.get_traits().get_supports_current_temperature());
+
+    adapter.make_call().set_target_temperature(18.0f).perform();
+    runFor(10000);
+    report("HR20_V1", "Target temperature written", isTemperature(adapter.target_temperature, 180));
+
+    // the next poll reads the written value back
+    runFor(60000);
+    report("HR20_V1", "Target temperature read back", isTemperature(adapter.target_temperature, 180) && (adapter.mode == CLIMATE_MODE_OFF));
+}
+
+/**
+ * @brief The confirmed state is published after a reboot, before the thermostat is read. The thermostat is read soon after,
+ *        then the learned polling interval is resumed.
+ */
+void runRestore(const HR20Simulator::Config& baseConfig)
+{
+    HR20Simulator::Config config = baseConfig;
+    config.protocol              = HR20Simulator::Protocol::E_OPEN_HR20;
+    HR20Simulator simulator(config);
+    uint32_t learnedIntervalMs = 0;
+
+    ESPPreferences::Instance().Clear();
+
+    {
+        EsphomeClimateHoneywellAdapter<HoneywellManager_OpenHR20> adapter(&simulator);
+        adapter.set_name("Restore");
+        adapter.set_passive_listening(false);
+        App.register_component(&adapter);
+        App.setup();
+
+        adapter.make_call().set_target_temperature(22.5f).perform();
+        runFor(30000);
+        report("Restore", "State confirmed before the reboot", isTemperature(adapter.target_temperature, 225));
+
+        // nothing changes, the polling interval grows and is saved
+        runFor(2u * 60u * 60u * 1000u);
+        learnedIntervalMs = adapter.get_update_interval();
+    }
+
+    // reboot: a new adapter with the same name
+    EsphomeClimateHoneywellAdapter<HoneywellManager_OpenHR20> adapter(&simulator);
+    uint32_t publishes = 0;
+
+    adapter.set_name("Restore");
+    adapter.set_passive_listening(false);
+    adapter.add_on_state_callback([&](Climate&) { ++publishes; });
+    App.register_component(&adapter);
+    App.setup();
+
+    report("Restore", "Saved state published in setup()",
+           (publishes == 1u) && isTemperature(adapter.target_temperature, 225) && (adapter.mode == CLIMATE_MODE_HEAT));
+
+    runFor(15000);
+    report("Restore", "Thermostat read soon after the reboot", adapter.confirmed_target_temperature_.has_value());
+    report("Restore", "Learned interval resumed", (learnedIntervalMs > 15000u) && (adapter.get_update_interval() == learnedIntervalMs));
+}
+
+/**
+ * @brief The detected protocol is cached, after a reboot the probing is skipped.
+ */
+void runAutoDetect(const HR20Simulator::Config& baseConfig)
+{
+    HR20Simulator::Config config = baseConfig;
+    config.protocol              = HR20Simulator::Protocol::E_HR20_V1;
+    uint32_t bytesDetected       = 0;
+    uint32_t bytesCached         = 0;
+
+    ESPPreferences::Instance().Clear();
+
+    for (uint32_t* bytes : { &bytesDetected, &bytesCached })
+    {
+        HR20Simulator simulator(config);
+        EsphomeClimateHoneywellAdapter<HoneywellManager_AutoDetect> adapter(&simulator);
+
+        adapter.set_name("AutoDetect");
+        App.register_component(&adapter);
+        App.setup();
+
+        // bytes sent till the first state was read from the thermostat
+        for (uint32_t timeMs = 0; (timeMs < 30000u) && !adapter.confirmed_target_temperature_.has_value(); timeMs += 100u)
+        {
+            runFor(100);
+        }
+        *bytes = adapter.confirmed_target_temperature_.has_value() ? simulator.BytesFromHost() : 0u;
+        runFor(1000);
+    }
+
+    report("AutoDetect", "Protocol detected", bytesDetected > 0u);
+    report("AutoDetect", "Cached protocol without probing", (bytesCached > 0u) && (bytesCached < bytesDetected));
+}
+
+/**
+ * @brief An unplugged thermostat is shown as unavailable, till it responds again.
+ */
+void runAvailability(const HR20Simulator::Config& baseConfig)
+{
+    HR20Simulator::Config config = baseConfig;
+    config.protocol              = HR20Simulator::Protocol::E_HR20_V1;
+    HR20Simulator simulator(config);
+    binary_sensor::BinarySensor availability;
+    EsphomeClimateHoneywellAdapter<HoneywellManager_HR20_V1> adapter(&simulator);
+    RetryPolicy policy;
+
+    policy.breakerFailureThreshold = 2;
+    policy.breakerProbeIntervalMs  = 10000;
+
+    ESPPreferences::Instance().Clear();
+    adapter.set_name("Available");
+    adapter.set_retry_policy(policy);
+    adapter.set_availability_sensor(&availability);
+    App.register_component(&adapter);
+    App.setup();
+
+    runFor(20000);
+    report("Available", "Available after setup", availability.state && !adapter.status_has_warning());
+
+    simulator.SetConnected(false);
+    runFor(20u * 60u * 1000u);
+    report("Available", "Unplugged thermostat unavailable", !availability.state && adapter.status_has_warning());
+
+    simulator.SetConnected(true);
+    runFor(20u * 60u * 1000u);
+    report("Available", "Available again", availability.state && !adapter.status_has_warning());
+}
+
+/**
+ * @brief The readings recorded while Home Assistant is disconnected are sent after reconnecting.
+ */
+void runHistory(const HR20Simulator::Config& baseConfig)
+{
+    static HoneywellHistory history;
+    HR20Simulator::Config config     = baseConfig;
+    config.protocol                  = HR20Simulator::Protocol::E_OPEN_HR20;
+    config.statusBroadcastIntervalUs = 60000000u;
+    HR20Simulator simulator(config);
+    HR20Simulator::OpenHR20State& device = simulator.GetOpenHR20State();
+    EsphomeClimateHoneywellAdapter<HoneywellManager_OpenHR20, HoneywellHistory> adapter(&simulator);
+    api::HostApiServer& api = api::HostApiServer::Instance();
+
+    ESPPreferences::Instance().Clear();
+    api.connected = false;
+    api.events.clear();
+    adapter.set_name("History");
+    adapter.set_history(&history, 60000);
+    App.register_component(&adapter);
+    App.setup();
+
+    for (int i = 0; i < 20; ++i)
+    {
+        device.valvePosition = 20 + i;
+        runFor(60000);
+    }
+
+    api.connected = true;
+    runFor(1000);
+
+    size_t samples = 0;
+
+    for (const api::HostApiServer::Event& event : api.events)
+    {
+        for (char c : event.data.at("samples"))
+        {
+            samples += (c == ';') ? 1u : 0u;
+        }
+    }
+
+    report("History", "Recorded while disconnected", history.Count() >= 15u);
+    report("History", "Backfill after reconnecting",
+           !api.events.empty() && (api.events[0].name == "esphome.honeywell_history") && (samples == history.Count()));
+}
+
+/**
+ * @brief More thermostats than the bus can drive, the last one is advanced by its own loop().
+ */
+void runBus(const HR20Simulator::Config& baseConfig)
+{
+    static const char* const NAMES[]{ "Bus 1", "Bus 2", "Bus 3", "Bus 4", "Bus 5" };
+    static_assert(sizeof(NAMES) / sizeof(NAMES[0]) == (HoneywellBus::MAX_MANAGERS + 1u), "one thermostat more than the bus drives");
+    HR20Simulator::Config config = baseConfig;
+    config.protocol              = HR20Simulator::Protocol::E_HR20_V1;
+    std::vector<std::unique_ptr<HR20Simulator>> simulators;
+    std::vector<std::unique_ptr<EsphomeClimateHoneywellAdapter<HoneywellManager_HR20_V1>>> adapters;
+    EsphomeHoneywellBus bus;
+    bool all_read = true;
+
+    ESPPreferences::Instance().Clear();
+    App.register_component(&bus);
+
+    for (const char* name : NAMES)
+    {
+        simulators.emplace_back(new HR20Simulator(config));
+        adapters.emplace_back(bus.add_thermostat<HoneywellManager_HR20_V1>(simulators.back().get()));
+        adapters.back()->set_name(name);
+        App.register_component(adapters.back().get());
+    }
+    App.setup();
+
+    runFor(20000);
+    for (const auto& adapter : adapters)
+    {
+        all_read = all_read && isTemperature(adapter->target_temperature, 210);
+    }
+
+    report("Bus", "All thermostats read", all_read);
+    report("Bus", "Full bus reported", bus.status_has_warning());
+}
+
+/**
+ * @brief The I/O task without FreeRTOS, the adapter advances the manager from loop().
+ */
+void runIoTask(const HR20Simulator::Config& baseConfig)
+{
+    HR20Simulator::Config config     = baseConfig;
+    config.protocol                  = HR20Simulator::Protocol::E_OPEN_HR20;
+    config.statusBroadcastIntervalUs = 60000000u;
+    config.broadcastOnChange         = true;
+    HR20Simulator simulator(config);
+    HR20Simulator::OpenHR20State& device = simulator.GetOpenHR20State();
+    EsphomeClimateHoneywellAdapter<HoneywellIoTask<HoneywellManager_OpenHR20>> adapter(&simulator);
+
+    ESPPreferences::Instance().Clear();
+    adapter.set_name("IoTask");
+    App.register_component(&adapter);
+    App.setup();
+
+    runFor(65000);
+    report("IoTask", "Status line published", isTemperature(adapter.current_temperature, 205));
+
+    adapter.make_call().set_target_temperature(17.5f).perform();
+    runFor(10000);
+    report("IoTask", "Target temperature written", (device.desiredTemperature == 1750) && isTemperature(adapter.target_temperature, 175));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    HR20Simulator::Config config;
+
+    for (int i = 1; (i + 1) < argc; i += 2)
+    {
+        if (0 == strcmp(argv[i], "--baud"))
+        {
+            config.baudRate = static_cast<uint32_t>(atoi(argv[i + 1]));
+        }
+        else if (0 == strcmp(argv[i], "--latency-us"))
+        {
+            config.responseLatencyUs = static_cast<uint32_t>(atoi(argv[i + 1]));
+        }
+        else if (0 == strcmp(argv[i], "--seed"))
+        {
+            config.seed = static_cast<uint32_t>(atoi(argv[i + 1]));
+        }
+        else
+        {
+            printf("unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    runOpenHR20(config);
+    runOpenHR20Polling(config);
+    runHR20V1(config);
+    runRestore(config);
+    runAutoDetect(config);
+    runAvailability(config);
+    runHistory(config);
+    runBus(config);
+    runIoTask(config);
+
+    printf("%d failure(s)\n", failures);
+
+    return (failures == 0) ? 0 : 1;
+}
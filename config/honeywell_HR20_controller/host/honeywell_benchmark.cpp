@@ -0,0 +1,562 @@
+/**
+ * @file honeywell_benchmark.cpp
+ *
+ * @brief Benchmark of all IHoneywellManager operations against the simulated HR20 thermostat.
+ *        Every operation is executed with the blocking API (the complete duration blocks the ESPHome loop) and with the
+ *        asynchronous API (only the single Loop() calls block). For each operation the p50/p99/max latency,
+ *        the bytes on the wire and the time spent sleeping (delay()) versus transferring (flush()) is reported.
+ *        All times are measured on the virtual clock of the host shim, so the results are reproducible.
+ *
+ *        Build & run (from this directory):
+ *          g++ -std=gnu++14 -O2 -I. -I.. honeywell_benchmark.cpp -o honeywell_benchmark && ./honeywell_benchmark
+ *
+ *        The encoder and decoder of HoneywellCodec.h are compared with sprintf() and strtol() in host CPU time per call.
+ *        The history (DeltaHistory.h) is filled with the changed readings of a simulated day, one reading per minute:
+ *        the compressed size per sample, the covered time and the host CPU time of Add() and of a batched Read() are reported.
+ *
+ *        Options: --baud <rate> --iterations <n> --idle-ms <ms> --drop <probability> --noise <probability> --seed <n> --loop-budget-ms <ms>
+ *                 --codec-iterations <n> --csv
+ */
+
+#include "../../common/DeltaHistory.h"
+#include "HR20Simulator.h"
+#include "HoneywellCodec.h"
+#include "HoneywellManager_HR20_V1.h"
+#include "HoneywellManager_OpenHR20.h"
+#include "esphome.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace
+{
+
+/// @brief Period of the simulated ESPHome main loop
+constexpr uint32_t LOOP_PERIOD_US{ 1000 };
+
+/// @brief Max simulated time of one asynchronous operation
+constexpr uint64_t ASYNC_TIMEOUT_US{ 30000000 };
+
+/**
+ * @brief Options of the benchmark
+ */
+struct Options
+{
+    HR20Simulator::Config simulator;
+    uint32_t iterations{ 100 };
+    uint32_t idleMs{ 5000 };
+    uint32_t loopBudgetMs{ 0 };
+    uint32_t codecIterations{ 1000000 };
+    bool csv{ false };
+};
+
+/**
+ * @brief One benchmarked operation
+ */
+struct Operation
+{
+    /// @brief Name of the operation
+    const char* name;
+
+    /// @brief Called before every iteration, e.g. to invalidate a cache.
+    std::function<void()> prepare;
+
+    /// @brief Execute the operation with the blocking API.
+    std::function<ErrorCode()> blocking;
+
+    /// @brief Queue the operation with the asynchronous API.
+    std::function<ErrorCode(CompletionCallback)> async;
+};
+
+/**
+ * @brief Measurements of all iterations of one operation
+ */
+struct Samples
+{
+    std::vector<uint64_t> latencyUs;
+    uint64_t maxLoopBlockUs{ 0 };
+    uint64_t bytesFromHost{ 0 };
+    uint64_t bytesToHost{ 0 };
+    uint64_t sleepUs{ 0 };
+    uint64_t transferUs{ 0 };
+    uint32_t errors{ 0 };
+};
+
+uint64_t now()
+{
+    return esphome::HostClock::Instance().NowUs();
+}
+
+uint64_t percentile(std::vector<uint64_t> values, double p)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(p * static_cast<double>(values.size()) + 0.999999);
+    index        = (index > 0u) ? (index - 1u) : 0u;
+
+    return values[std::min(index, values.size() - 1u)];
+}
+
+void printHeader(const Options& options)
+{
+    if (options.csv)
+    {
+        printf("manager,operation,api,p50_ms,p99_ms,max_ms,max_loop_block_ms,tx_bytes,rx_bytes,sleep_ms,transfer_ms,errors\n");
+    }
+    else
+    {
+        printf("%-8s %-26s %-5s %9s %9s %9s %10s %7s %7s %9s %9s %6s\n", "manager", "operation", "api", "p50 ms", "p99 ms", "max ms",
+               "loop ms", "tx B", "rx B", "sleep ms", "xfer ms", "errors");
+    }
+}
+
+void printSamples(const Options& options, const char* manager, const char* operation, const char* api, const Samples& samples)
+{
+    const double iterations = static_cast<double>(samples.latencyUs.empty() ? 1u : samples.latencyUs.size());
+    const double p50        = static_cast<double>(percentile(samples.latencyUs, 0.50)) / 1000.0;
+    const double p99        = static_cast<double>(percentile(samples.latencyUs, 0.99)) / 1000.0;
+    const double max        = static_cast<double>(percentile(samples.latencyUs, 1.00)) / 1000.0;
+    const double loopBlock  = static_cast<double>(samples.maxLoopBlockUs) / 1000.0;
+    const double tx         = static_cast<double>(samples.bytesFromHost) / iterations;
+    const double rx         = static_cast<double>(samples.bytesToHost) / iterations;
+    const double sleep      = static_cast<double>(samples.sleepUs) / iterations / 1000.0;
+    const double transfer   = static_cast<double>(samples.transferUs) / iterations / 1000.0;
+
+    if (options.csv)
+    {
+        printf("%s,%s,%s,%.2f,%.2f,%.2f,%.2f,%.1f,%.1f,%.2f,%.2f,%u\n", manager, operation, api, p50, p99, max, loopBlock, tx, rx, sleep,
+               transfer, samples.errors);
+    }
+    else
+    {
+        printf("%-8s %-26s %-5s %9.2f %9.2f %9.2f %10.2f %7.1f %7.1f %9.2f %9.2f %6u\n", manager, operation, api, p50, p99, max, loopBlock,
+               tx, rx, sleep, transfer, samples.errors);
+    }
+}
+
+/**
+ * @brief Run all iterations of one operation with the blocking and the asynchronous API.
+ */
+void benchmark(const Options& options, const char* managerName, IHoneywellManager& manager, HR20Simulator& simulator,
+               const Operation& operation)
+{
+    Samples blockingSamples;
+    Samples asyncSamples;
+
+    for (uint32_t i = 0; i < options.iterations; ++i)
+    {
+        // blocking API: the complete duration blocks the loop
+        esphome::HostClock::Instance().Advance(static_cast<uint64_t>(options.idleMs) * 1000u);
+        operation.prepare();
+
+        esphome::HostClock::Instance().ResetStatistics();
+        uint32_t bytesFromHost = simulator.BytesFromHost();
+        uint32_t bytesToHost   = simulator.BytesToHost();
+        uint64_t startUs       = now();
+
+        if (ErrorCode::E_OK != operation.blocking())
+        {
+            ++blockingSamples.errors;
+        }
+
+        blockingSamples.latencyUs.push_back(now() - startUs);
+        blockingSamples.maxLoopBlockUs = std::max(blockingSamples.maxLoopBlockUs, now() - startUs);
+        blockingSamples.bytesFromHost += simulator.BytesFromHost() - bytesFromHost;
+        blockingSamples.bytesToHost += simulator.BytesToHost() - bytesToHost;
+        blockingSamples.sleepUs += esphome::HostClock::Instance().SleepUs();
+        blockingSamples.transferUs += esphome::HostClock::Instance().TransferUs();
+
+        // asynchronous API: only the single Loop() calls block
+        esphome::HostClock::Instance().Advance(static_cast<uint64_t>(options.idleMs) * 1000u);
+        operation.prepare();
+
+        esphome::HostClock::Instance().ResetStatistics();
+        bytesFromHost       = simulator.BytesFromHost();
+        bytesToHost         = simulator.BytesToHost();
+        startUs             = now();
+        bool done           = false;
+        ErrorCode errorCode = operation.async([&done, &errorCode](ErrorCode result) {
+            errorCode = result;
+            done      = true;
+        });
+
+        while ((ErrorCode::E_OK == errorCode) && !done && ((now() - startUs) < ASYNC_TIMEOUT_US))
+        {
+            const uint64_t loopStartUs = now();
+            manager.Loop();
+            asyncSamples.maxLoopBlockUs = std::max(asyncSamples.maxLoopBlockUs, now() - loopStartUs);
+            esphome::HostClock::Instance().Advance(LOOP_PERIOD_US);
+        }
+
+        if (!done || (ErrorCode::E_OK != errorCode))
+        {
+            ++asyncSamples.errors;
+        }
+
+        asyncSamples.latencyUs.push_back(now() - startUs);
+        asyncSamples.bytesFromHost += simulator.BytesFromHost() - bytesFromHost;
+        asyncSamples.bytesToHost += simulator.BytesToHost() - bytesToHost;
+        asyncSamples.sleepUs += esphome::HostClock::Instance().SleepUs();
+        asyncSamples.transferUs += esphome::HostClock::Instance().TransferUs();
+    }
+
+    printSamples(options, managerName, operation.name, "block", blockingSamples);
+    printSamples(options, managerName, operation.name, "async", asyncSamples);
+}
+
+/**
+ * @brief Operations of the generic IHoneywellManager interface
+ */
+std::vector<Operation> interfaceOperations(IHoneywellManager& manager, std::function<void()> prepareRead)
+{
+    std::vector<Operation> operations;
+    std::function<void()> nothing = []() {};
+
+    operations.push_back(Operation{ "SetDesiredTemperature", nothing, [&manager]() { return manager.SetDesiredTemperature(225); },
+                                    [&manager](CompletionCallback callback) { return manager.SetDesiredTemperatureAsync(225, callback); } });
+    operations.push_back(Operation{ "GetDesiredTemperature", prepareRead,
+                                    [&manager]() {
+                                        int temperature = 0;
+                                        return manager.GetDesiredTemperature(temperature);
+                                    },
+                                    [&manager](CompletionCallback callback) {
+                                        return manager.GetDesiredTemperatureAsync([callback](ErrorCode errorCode, int) { callback(errorCode); });
+                                    } });
+    operations.push_back(Operation{ "SetMode", nothing, [&manager]() { return manager.SetMode(Mode::E_AUTOMATIC); },
+                                    [&manager](CompletionCallback callback) { return manager.SetModeAsync(Mode::E_AUTOMATIC, callback); } });
+    operations.push_back(Operation{ "GetMode", prepareRead,
+                                    [&manager]() {
+                                        Mode mode = Mode::E_INVALID;
+                                        return manager.GetMode(mode);
+                                    },
+                                    [&manager](CompletionCallback callback) {
+                                        return manager.GetModeAsync([callback](ErrorCode errorCode, Mode) { callback(errorCode); });
+                                    } });
+    operations.push_back(Operation{ "GetState", prepareRead,
+                                    [&manager]() {
+                                        // there is no blocking API of the whole state, the loop is run like RunUntilIdle()
+                                        ErrorCode result      = ErrorCode::E_NOT_OK;
+                                        ErrorCode queueResult = manager.GetStateAsync([&result](ErrorCode errorCode, int, Mode) { result = errorCode; });
+
+                                        while ((ErrorCode::E_OK == queueResult) && manager.IsBusy())
+                                        {
+                                            manager.Loop();
+                                            delay(1);
+                                        }
+
+                                        return (ErrorCode::E_OK == queueResult) ? result : queueResult;
+                                    },
+                                    [&manager](CompletionCallback callback) {
+                                        return manager.GetStateAsync([callback](ErrorCode errorCode, int, Mode) { callback(errorCode); });
+                                    } });
+
+    return operations;
+}
+
+void runOpenHR20(const Options& options)
+{
+    HR20Simulator::Config config = options.simulator;
+    config.protocol              = HR20Simulator::Protocol::E_OPEN_HR20;
+    HR20Simulator simulator(config);
+    HoneywellManager_OpenHR20 manager(&simulator);
+    manager.SetLoopBudget(options.loopBudgetMs);
+
+    // every read shall request a new status line, otherwise only the cache is measured
+    std::function<void()> invalidate = [&manager]() { manager.InvalidateStatusSnapshot(); };
+    std::vector<Operation> operations = interfaceOperations(manager, invalidate);
+    std::function<void()> nothing     = []() {};
+    WeeklySchedule schedule;
+
+    // a complete week: comfort from 06:00 till 22:00
+    for (int preset = 0; preset < WeeklySchedule::PRESETS; ++preset)
+    {
+        schedule.presetTemperatures[preset] = 170 + (preset * 10);
+    }
+    for (auto& day : schedule.slots)
+    {
+        for (uint8_t slot = 0; slot < WeeklySchedule::SLOTS_PER_DAY; ++slot)
+        {
+            day[slot] = WeeklySchedule::Slot{ static_cast<uint16_t>((6u + (2u * slot)) * 60u), static_cast<uint8_t>(slot % 4u) };
+        }
+    }
+
+    operations.push_back(Operation{ "GetStatusSnapshot", invalidate,
+                                    [&manager]() {
+                                        HoneywellManager_OpenHR20::StatusSnapshot snapshot;
+                                        return manager.GetStatusSnapshot(snapshot);
+                                    },
+                                    [&manager](CompletionCallback callback) {
+                                        return manager.GetStatusSnapshotAsync(
+                                            [callback](ErrorCode errorCode, const HoneywellManager_OpenHR20::StatusSnapshot&) { callback(errorCode); });
+                                    } });
+
+    operations.push_back(Operation{ "GetSchedule", nothing,
+                                    [&manager]() {
+                                        WeeklySchedule schedule;
+                                        return manager.GetSchedule(schedule);
+                                    },
+                                    [&manager](CompletionCallback callback) {
+                                        return manager.GetScheduleAsync([callback](ErrorCode errorCode, const WeeklySchedule&) { callback(errorCode); });
+                                    } });
+    operations.push_back(Operation{ "SetSchedule", nothing, [&manager, &schedule]() { return manager.SetSchedule(schedule); },
+                                    [&manager, &schedule](CompletionCallback callback) { return manager.SetScheduleAsync(schedule, callback); } });
+
+    for (const Operation& operation : operations)
+    {
+        benchmark(options, "OpenHR20", manager, simulator, operation);
+    }
+}
+
+void runHR20V1(const Options& options)
+{
+    HR20Simulator::Config config = options.simulator;
+    config.protocol              = HR20Simulator::Protocol::E_HR20_V1;
+    HR20Simulator simulator(config);
+    HoneywellManager_HR20_V1 manager(&simulator);
+    manager.SetLoopBudget(options.loopBudgetMs);
+
+    for (const Operation& operation : interfaceOperations(manager, []() {}))
+    {
+        benchmark(options, "HR20_V1", manager, simulator, operation);
+    }
+}
+
+/**
+ * @brief Host CPU time of one call in ns, the result of every call is added to the sink so it is not optimized away.
+ */
+double measureCodec(uint32_t iterations, const std::function<uint32_t(uint32_t)>& call)
+{
+    static volatile uint32_t sink{ 0 };
+    const auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < iterations; ++i)
+    {
+        sink = sink + call(i);
+    }
+
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / static_cast<double>(iterations);
+}
+
+void printCodec(const Options& options, const char* operation, const char* implementation, double ns)
+{
+    if (options.csv)
+    {
+        printf("codec,%s,%s,%.1f\n", operation, implementation, ns);
+    }
+    else
+    {
+        printf("%-8s %-26s %-9s %9.1f\n", "codec", operation, implementation, ns);
+    }
+}
+
+/**
+ * @brief Compare the encoder and the decoder of HoneywellCodec.h with sprintf() and strtol().
+ */
+void runCodec(const Options& options)
+{
+    static constexpr char STATUS_LINE[]{ "d6 10.01.14 22:01:49 M V: 39 I: 2150 S: 2200 B: 3035 Is: 00b9 X" };
+    static constexpr char PAYLOAD[]{ "0096" };
+    const uint32_t iterations = (options.codecIterations > 0u) ? options.codecIterations : 1u;
+
+    if (options.csv)
+    {
+        printf("\nmanager,operation,implementation,ns_per_call\n");
+    }
+    else
+    {
+        printf("\n%-8s %-26s %-9s %9s\n", "", "operation", "impl", "ns/call");
+    }
+
+    printCodec(options, "encode W%03X%04X", "sprintf", measureCodec(iterations, [](uint32_t i) {
+                   char request[UartTransaction::MAX_REQUEST_LENGTH];
+                   return static_cast<uint32_t>(sprintf(request, "W%03X%04X\r\n", 0x136u, i & 0xFFFFu)) + static_cast<uint8_t>(request[5]);
+               }));
+    printCodec(options, "encode W%03X%04X", "codec", measureCodec(iterations, [](uint32_t i) {
+                   char request[UartTransaction::MAX_REQUEST_LENGTH];
+                   HoneywellFrame<UartTransaction::MAX_REQUEST_LENGTH> frame;
+                   frame.Char('W').Hex(0x136u, 3u, true).Hex(i & 0xFFFFu, 4u, true).Text("\r\n").CopyTo(request);
+                   return static_cast<uint32_t>(strlen(request)) + static_cast<uint8_t>(request[5]);
+               }));
+    printCodec(options, "decode 4 hex digits", "strtol", measureCodec(iterations, [](uint32_t) {
+                   char readValue[5]{};
+                   char* end = nullptr;
+                   memcpy(readValue, PAYLOAD, 4u);
+                   return static_cast<uint32_t>(strtol(readValue, &end, 16)) + ((*end == '\0') ? 0u : 1u);
+               }));
+    printCodec(options, "decode 4 hex digits", "codec", measureCodec(iterations, [](uint32_t) {
+                   uint32_t value{ 0 };
+                   return HoneywellDecoder::DecodeUnsigned(FrameView{ PAYLOAD, 4u }, 16u, 0xFFFFu, value) ? value : 0u;
+               }));
+    printCodec(options, "parse status line", "codec", measureCodec(iterations, [](uint32_t) {
+                   HoneywellManager_OpenHR20::StatusSnapshot snapshot;
+                   HoneywellManager_OpenHR20::ParseStatusLine(STATUS_LINE, sizeof(STATUS_LINE) - 1u, snapshot);
+                   return static_cast<uint32_t>(snapshot.currentTemperature);
+               }));
+}
+
+/**
+ * @brief Fill the history of a thermostat with a simulated day and check that every sample is decoded unchanged.
+ */
+void runHistory(const Options& options)
+{
+    static constexpr uint32_t MINUTES{ 24u * 60u };
+    static constexpr size_t BATCH{ 16 };
+    static DeltaHistory<4> history;
+    std::vector<std::array<int16_t, 4>> samples;
+    std::vector<uint32_t> minutes;
+    DeltaHistory<4>::Sample batch[BATCH];
+    uint32_t seed   = options.simulator.seed;
+    int16_t current = 180;
+    uint32_t cursor = 0;
+    size_t count    = 0;
+    size_t reads    = 0;
+    bool unchanged  = true;
+
+    history.Restore();
+    history.Clear();
+
+    // night 17 °C, day 21 °C, the room follows slowly with a little noise, the valve opens while it is too cold
+    for (uint32_t minute = 0; minute < MINUTES; ++minute)
+    {
+        const int16_t target = ((minute >= (6u * 60u)) && (minute < (22u * 60u))) ? 210 : 170;
+        const int step       = (target > current) ? 1 : ((target < current) ? -1 : 0);
+        seed                 = (seed * 1103515245u) + 12345u;
+        current              = static_cast<int16_t>(current + step + static_cast<int>((seed >> 16) % 3u) - 1);
+
+        const std::array<int16_t, 4> values{ target, current, static_cast<int16_t>((target > current) ? 60 : 0),
+                                             static_cast<int16_t>(3050u - (minute / 240u)) };
+
+        // like the adapter, only changed readings are recorded
+        if (samples.empty() || (samples.back() != values))
+        {
+            samples.push_back(values);
+            minutes.push_back(minute);
+        }
+    }
+
+    const auto addStart = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        const int16_t values[4]{ samples[i][0], samples[i][1], samples[i][2], samples[i][3] };
+        history.Add(1700000000u + (60u * minutes[i]), 0u, values);
+    }
+
+    const auto readStart = std::chrono::steady_clock::now();
+
+    while ((count = history.Read(cursor, batch, BATCH)) > 0u)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const std::array<int16_t, 4>& expected = samples[batch[i].sequence];
+            unchanged = unchanged && (batch[i].time == (1700000000u + (60u * minutes[batch[i].sequence])))
+                        && std::equal(expected.begin(), expected.end(), batch[i].values);
+        }
+
+        ++reads;
+    }
+
+    const auto end              = std::chrono::steady_clock::now();
+    const double addNs          = std::chrono::duration<double, std::nano>(readStart - addStart).count()
+                         / static_cast<double>(samples.size());
+    const double readNs         = std::chrono::duration<double, std::nano>(end - readStart).count() / static_cast<double>(reads);
+    const double bytesPerSample = static_cast<double>(history.UsedBytes()) / static_cast<double>(history.Count());
+    const double hours          = static_cast<double>(minutes.back() - minutes[history.OldestSequence()]) / 60.0;
+
+    if (options.csv)
+    {
+        printf("\nhistory,samples,bytes,capacity,bytes_per_sample,hours,add_ns,read_batch_ns,unchanged\n");
+        printf("history,%u,%u,%u,%.2f,%.1f,%.1f,%.1f,%d\n", static_cast<unsigned>(history.Count()),
+               static_cast<unsigned>(history.UsedBytes()), static_cast<unsigned>(history.Capacity()), bytesPerSample, hours, addNs,
+               readNs, unchanged ? 1 : 0);
+    }
+    else
+    {
+        printf("\nhistory: %u of %u changed samples kept in %u of %u bytes (%.2f bytes/sample), %.1f hours\n",
+               static_cast<unsigned>(history.Count()), static_cast<unsigned>(samples.size()), static_cast<unsigned>(history.UsedBytes()),
+               static_cast<unsigned>(history.Capacity()), bytesPerSample, hours);
+        printf("history: add %.1f ns/sample, read %.1f ns/batch of %u, decoded %s\n", addNs, readNs, static_cast<unsigned>(BATCH),
+               unchanged ? "unchanged" : "WITH DIFFERENCES");
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (0 == strcmp(argv[i], "--csv"))
+        {
+            options.csv = true;
+        }
+        else if ((i + 1) >= argc)
+        {
+            printf("missing value of option %s\n", argv[i]);
+            return 2;
+        }
+        else if (0 == strcmp(argv[i], "--baud"))
+        {
+            options.simulator.baudRate = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (0 == strcmp(argv[i], "--iterations"))
+        {
+            options.iterations = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (0 == strcmp(argv[i], "--idle-ms"))
+        {
+            options.idleMs = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (0 == strcmp(argv[i], "--drop"))
+        {
+            options.simulator.txDropProbability = atof(argv[++i]);
+            options.simulator.rxDropProbability = options.simulator.txDropProbability;
+        }
+        else if (0 == strcmp(argv[i], "--noise"))
+        {
+            options.simulator.noiseProbability = atof(argv[++i]);
+        }
+        else if (0 == strcmp(argv[i], "--seed"))
+        {
+            options.simulator.seed = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (0 == strcmp(argv[i], "--loop-budget-ms"))
+        {
+            options.loopBudgetMs = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (0 == strcmp(argv[i], "--codec-iterations"))
+        {
+            options.codecIterations = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else
+        {
+            printf("unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    if (!options.csv)
+    {
+        printf("baud rate %u, %u iterations, %u ms idle time before each iteration\n\n", options.simulator.baudRate, options.iterations,
+               options.idleMs);
+    }
+
+    printHeader(options);
+    runOpenHR20(options);
+    runHR20V1(options);
+    runCodec(options);
+    runHistory(options);
+
+    return 0;
+}
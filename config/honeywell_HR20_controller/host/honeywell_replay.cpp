@@ -0,0 +1,510 @@
+/**
+ * @file honeywell_replay.cpp
+ *
+ * @brief Replays a captured UART trace (see HoneywellUartTrace.h) into HoneywellManager_OpenHR20 or HoneywellManager_HR20_V1.
+ *        The calls of the manager API are derived from the requests in the trace and issued at the recorded time:
+ *        - OpenHR20: "D" -> GetStatusSnapshotAsync(), "Axx" -> SetDesiredTemperatureAsync(), "Mxx" -> SetModeAsync().
+ *          Unsolicited status lines are parsed in listen mode. Other requests are not replayed, their responses arrive unsolicited.
+ *        - HR20_V1: the reads and writes after one wake up ("K") -> ExecuteBatchAsync().
+ *        The responses of the thermostat are delivered by HR20TracePlayer relative to the requests of the manager, so a field
+ *        failure is reproduced deterministically and a parser change can be measured against real traffic.
+ *        With --record a simulated session is written in the capture format, e.g. to create a reference trace.
+ *
+ *        Build & run (from this directory):
+ *          g++ -std=gnu++14 -O2 -I. -I.. honeywell_replay.cpp -o honeywell_replay
+ *          ./honeywell_replay --protocol openhr20 --speed 10 traces/openhr20_session.trace
+ *
+ *        Options: --protocol openhr20|hr20v1 --speed <factor> --baud <rate> --repeat <n> --record <file>
+ */
+
+#include "HR20Simulator.h"
+#include "HR20TracePlayer.h"
+#include "HoneywellManager_HR20_V1.h"
+#include "HoneywellManager_OpenHR20.h"
+#include "HoneywellStatistics.h"
+#include "esphome.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+/// @brief Period of the simulated ESPHome main loop
+constexpr uint32_t LOOP_PERIOD_US{ 1000 };
+
+/// @brief Max simulated time after the last record, till the replay is stopped
+constexpr uint64_t DRAIN_TIMEOUT_US{ 30000000 };
+
+/// @brief Max time between a wake up and the following request, which belong to the same call
+constexpr uint32_t WAKEUP_WINDOW_MS{ 1000 };
+
+/**
+ * @brief Options of the replay
+ */
+struct Options
+{
+    HR20Simulator::Protocol protocol{ HR20Simulator::Protocol::E_OPEN_HR20 };
+    HR20TracePlayer::Config player;
+    double speed{ 1.0 };
+    uint32_t repeat{ 1 };
+    const char* record{ nullptr };
+    const char* trace{ nullptr };
+};
+
+/**
+ * @brief One call of the manager API, derived from a request of the trace.
+ */
+struct ReplayCall
+{
+    /// @brief Recorded time of the first request of the call
+    uint32_t timeMs;
+
+    /// @brief Index of the first request in the trace
+    size_t record;
+
+    /// @brief Issue the call, the callback reports the result.
+    std::function<ErrorCode(CompletionCallback)> issue;
+};
+
+/**
+ * @brief Result of one replay
+ */
+struct ReplayResult
+{
+    uint32_t calls{ 0 };
+    uint32_t failedCalls{ 0 };
+    uint32_t rejectedCalls{ 0 };
+    uint32_t skippedRequests{ 0 };
+    uint32_t snapshots{ 0 };
+    uint64_t virtualUs{ 0 };
+    double cpuUs{ 0.0 };
+};
+
+/**
+ * @brief Request without line terminators and leading line feeds.
+ */
+std::string requestLine(const std::string& bytes)
+{
+    size_t begin = 0;
+    size_t end   = bytes.size();
+
+    while ((begin < end) && (bytes[begin] == '\n'))
+    {
+        ++begin;
+    }
+    while ((end > begin) && ((bytes[end - 1u] == '\n') || (bytes[end - 1u] == '\r')))
+    {
+        --end;
+    }
+
+    return bytes.substr(begin, end - begin);
+}
+
+/**
+ * @brief Derive the calls of the OpenHR20 manager. A wake up line feed belongs to the following request.
+ *        The unsolicited status lines are counted in listen mode.
+ */
+std::vector<ReplayCall> replayCalls(const std::vector<HR20TracePlayer::Record>& records, HoneywellManager_OpenHR20& manager, ReplayResult& result)
+{
+    std::vector<ReplayCall> calls;
+
+    manager.SetStatusObserver([&result](ErrorCode, const HoneywellManager_OpenHR20::StatusSnapshot&) { ++result.snapshots; });
+    manager.SetListenMode(true);
+
+    bool wakeup{ false };
+    size_t wakeupRecord{ 0 };
+
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        if (!records[i].tx)
+        {
+            continue;
+        }
+
+        const std::string line = requestLine(records[i].bytes);
+
+        if (line.empty())
+        {
+            wakeup       = true;
+            wakeupRecord = i;
+            continue;
+        }
+
+        const size_t first = (wakeup && ((records[i].timeMs - records[wakeupRecord].timeMs) <= WAKEUP_WINDOW_MS)) ? wakeupRecord : i;
+        wakeup             = false;
+
+        if (line == "D")
+        {
+            calls.push_back(ReplayCall{ records[first].timeMs, first, [&manager](CompletionCallback callback) {
+                                           return manager.GetStatusSnapshotAsync(
+                                               [callback](ErrorCode errorCode, const HoneywellManager_OpenHR20::StatusSnapshot&) { callback(errorCode); }, 0u);
+                                       } });
+        }
+        else if ((line.size() == 3u) && (line[0] == 'A'))
+        {
+            const int temperature = static_cast<int>(strtol(line.c_str() + 1, nullptr, 16)) * 5;
+            calls.push_back(ReplayCall{ records[first].timeMs, first, [&manager, temperature](CompletionCallback callback) {
+                                           return manager.SetDesiredTemperatureAsync(temperature, callback);
+                                       } });
+        }
+        else if ((line == "M00") || (line == "M01"))
+        {
+            const Mode mode = (line == "M01") ? Mode::E_AUTOMATIC : Mode::E_MANUAL;
+            calls.push_back(ReplayCall{ records[first].timeMs, first,
+                                        [&manager, mode](CompletionCallback callback) { return manager.SetModeAsync(mode, callback); } });
+        }
+        else
+        {
+            // e.g. the commands of a schedule session
+            ++result.skippedRequests;
+        }
+    }
+
+    return calls;
+}
+
+/**
+ * @brief Derive the calls of the HR20_V1 manager. All reads and writes after one wake up are one batch.
+ */
+std::vector<ReplayCall> replayCalls(const std::vector<HR20TracePlayer::Record>& records, HoneywellManager_HR20_V1& manager, ReplayResult& result)
+{
+    std::vector<ReplayCall> calls;
+    MemoryBatch batch;
+    size_t first{ 0 };
+    bool wakeup{ false };
+
+    auto flush = [&]() {
+        if (batch.count > 0u)
+        {
+            calls.push_back(ReplayCall{ records[first].timeMs, first, [&manager, batch](CompletionCallback callback) {
+                                           return manager.ExecuteBatchAsync(
+                                               batch, [callback](ErrorCode errorCode, const MemoryBatch&) { callback(errorCode); });
+                                       } });
+            batch = MemoryBatch{};
+        }
+    };
+
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        if (!records[i].tx)
+        {
+            continue;
+        }
+
+        const std::string line = requestLine(records[i].bytes);
+
+        if (line == "K")
+        {
+            // the first wake up command starts a new session
+            if (!wakeup)
+            {
+                flush();
+                first  = i;
+                wakeup = true;
+            }
+            continue;
+        }
+
+        if (!wakeup && (batch.count == 0u))
+        {
+            first = i;
+        }
+        wakeup = false;
+
+        if ((line.size() == 4u) && (line[0] == 'R'))
+        {
+            batch.AddRead(static_cast<uint16_t>(strtol(line.c_str() + 1, nullptr, 16)));
+        }
+        else if ((line.size() == 8u) && (line[0] == 'W'))
+        {
+            const uint16_t address = static_cast<uint16_t>(strtol(line.substr(1, 3).c_str(), nullptr, 16));
+            batch.AddWrite(address, static_cast<uint16_t>(strtol(line.c_str() + 4, nullptr, 16)));
+        }
+        else
+        {
+            ++result.skippedRequests;
+        }
+
+        if (batch.count >= MemoryBatch::MAX_OPERATIONS)
+        {
+            flush();
+        }
+    }
+
+    flush();
+
+    return calls;
+}
+
+/**
+ * @brief Replay the trace once into a new manager.
+ */
+template <typename Manager>
+ReplayResult replay(HR20TracePlayer& player, HoneywellStatistics& statistics, double speed)
+{
+    ReplayResult result;
+    Manager manager(&player);
+    std::vector<ReplayCall> calls;
+    uint32_t outstanding{ 0 };
+
+    player.Rewind();
+    calls = replayCalls(player.Records(), manager, result);
+
+    const uint64_t startUs = esphome::HostClock::Instance().NowUs();
+    const auto cpuStart    = std::chrono::steady_clock::now();
+    size_t next            = 0;
+    uint64_t finishedUs    = 0;
+
+    for (;;)
+    {
+        const uint64_t nowUs = esphome::HostClock::Instance().NowUs();
+
+        while ((next < calls.size()) && (nowUs >= player.ScheduledUs(calls[next].record)))
+        {
+            const ErrorCode errorCode = calls[next].issue([&result, &outstanding](ErrorCode callResult) {
+                --outstanding;
+                result.failedCalls += (callResult != ErrorCode::E_OK) ? 1u : 0u;
+            });
+
+            ++result.calls;
+            ++next;
+
+            if (errorCode == ErrorCode::E_OK)
+            {
+                ++outstanding;
+            }
+            else
+            {
+                ++result.rejectedCalls;
+            }
+        }
+
+        manager.Loop();
+
+        if ((next >= calls.size()) && (outstanding == 0u) && player.IsFinished() && !manager.IsBusy())
+        {
+            break;
+        }
+
+        // all records are delivered, but the manager does not finish
+        finishedUs = (player.IsFinished() && (finishedUs == 0u)) ? nowUs : finishedUs;
+        if ((finishedUs > 0u) && ((nowUs - finishedUs) > DRAIN_TIMEOUT_US))
+        {
+            break;
+        }
+
+        // trace and manager share the clock: only the idle time till the next call is skipped faster, so the timeouts
+        // of the manager see the same delays as without speed factor
+        uint64_t stepUs = LOOP_PERIOD_US;
+        if (!manager.IsBusy() && (outstanding == 0u))
+        {
+            const uint64_t idleUs = (next < calls.size()) ? (player.ScheduledUs(calls[next].record) - nowUs) : UINT64_MAX;
+            const uint64_t skipUs = static_cast<uint64_t>(LOOP_PERIOD_US * speed);
+            stepUs                = (skipUs < idleUs) ? skipUs : idleUs;
+            stepUs                = (stepUs > LOOP_PERIOD_US) ? stepUs : LOOP_PERIOD_US;
+        }
+
+        esphome::HostClock::Instance().Advance(stepUs);
+    }
+
+    result.cpuUs     = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - cpuStart).count();
+    result.virtualUs = esphome::HostClock::Instance().NowUs() - startUs;
+    manager.GetStatistics(statistics);
+
+    return result;
+}
+
+/**
+ * @brief Record a simulated session in the capture format.
+ */
+int record(const Options& options)
+{
+    FILE* file = fopen(options.record, "w");
+
+    if (file == nullptr)
+    {
+        printf("can not open %s\n", options.record);
+        return 2;
+    }
+
+    HR20Simulator::Config config;
+    config.protocol                  = options.protocol;
+    config.baudRate                  = options.player.baudRate;
+    config.broadcastOnChange         = true;
+    config.statusBroadcastIntervalUs = 20000000u;
+    HR20Simulator simulator(config);
+    HR20TraceRecorder recorder(simulator, file);
+    bool done{ false };
+
+    auto run = [&](uint64_t durationUs, IHoneywellManager& manager) {
+        const uint64_t startUs = esphome::HostClock::Instance().NowUs();
+        while (!done || ((esphome::HostClock::Instance().NowUs() - startUs) < durationUs))
+        {
+            manager.Loop();
+            esphome::HostClock::Instance().Advance(LOOP_PERIOD_US);
+        }
+    };
+    auto complete = [&](ErrorCode) { done = true; };
+    auto state    = [&](ErrorCode, int, Mode) { done = true; };
+
+    if (options.protocol == HR20Simulator::Protocol::E_OPEN_HR20)
+    {
+        HoneywellManager_OpenHR20 manager(&recorder);
+        manager.SetListenMode(true);
+
+        done = false;
+        manager.GetStateAsync(state);
+        run(5000000u, manager);
+        done = false;
+        manager.SetDesiredTemperatureAsync(225, complete);
+        run(0u, manager);
+        done = false;
+        manager.GetStateAsync(state);
+        run(30000000u, manager);
+        done = false;
+        manager.SetModeAsync(Mode::E_AUTOMATIC, complete);
+        run(3000000u, manager);
+        done = false;
+        manager.GetStateAsync(state);
+        run(1000000u, manager);
+    }
+    else
+    {
+        HoneywellManager_HR20_V1 manager(&recorder);
+
+        done = false;
+        manager.GetStateAsync(state);
+        run(5000000u, manager);
+        done = false;
+        manager.SetDesiredTemperatureAsync(215, complete);
+        run(10000000u, manager);
+        done = false;
+        manager.SetModeAsync(Mode::E_AUTOMATIC, complete);
+        run(1000000u, manager);
+        done = false;
+        manager.GetStateAsync(state);
+        run(1000000u, manager);
+    }
+
+    recorder.Flush();
+    fclose(file);
+    printf("recorded %s\n", options.record);
+
+    return 0;
+}
+
+/**
+ * @brief Print the command line options.
+ */
+void printUsage(void)
+{
+    printf("usage: honeywell_replay [--protocol openhr20|hr20v1] [--speed <factor>] [--baud <rate>] [--repeat <n>] <trace>\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (argv[i][0] != '-')
+        {
+            options.trace = argv[i];
+        }
+        else if ((i + 1) >= argc)
+        {
+            printf("missing value of option %s\n", argv[i]);
+            return 2;
+        }
+        else if (0 == strcmp(argv[i], "--protocol"))
+        {
+            ++i;
+
+            if (0 == strcmp(argv[i], "openhr20"))
+            {
+                options.protocol = HR20Simulator::Protocol::E_OPEN_HR20;
+            }
+            else if (0 == strcmp(argv[i], "hr20v1"))
+            {
+                options.protocol = HR20Simulator::Protocol::E_HR20_V1;
+            }
+            else
+            {
+                // a trace replayed against the wrong simulator would only be skipped
+                printf("unknown protocol %s\n", argv[i]);
+                printUsage();
+                return 2;
+            }
+        }
+        else if (0 == strcmp(argv[i], "--speed"))
+        {
+            options.speed = atof(argv[++i]);
+        }
+        else if (0 == strcmp(argv[i], "--baud"))
+        {
+            options.player.baudRate = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (0 == strcmp(argv[i], "--repeat"))
+        {
+            options.repeat = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (0 == strcmp(argv[i], "--record"))
+        {
+            options.record = argv[++i];
+        }
+        else
+        {
+            printf("unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    if (options.record != nullptr)
+    {
+        return record(options);
+    }
+
+    HR20TracePlayer player(options.player);
+
+    if ((options.trace == nullptr) || (options.speed <= 0.0) || !player.Load(options.trace))
+    {
+        printUsage();
+        return 2;
+    }
+
+    ReplayResult result;
+    HoneywellStatistics statistics;
+    double cpuUs{ 0.0 };
+
+
+    for (uint32_t i = 0; i < options.repeat; ++i)
+    {
+        result = (options.protocol == HR20Simulator::Protocol::E_OPEN_HR20)
+                     ? replay<HoneywellManager_OpenHR20>(player, statistics, options.speed)
+                     : replay<HoneywellManager_HR20_V1>(player, statistics, options.speed);
+        cpuUs += result.cpuUs;
+    }
+
+    printf("records: %u, calls: %u (failed %u, rejected %u), skipped requests: %u, status snapshots: %u\n",
+           static_cast<unsigned>(player.Records().size()), static_cast<unsigned>(result.calls), static_cast<unsigned>(result.failedCalls),
+           static_cast<unsigned>(result.rejectedCalls), static_cast<unsigned>(result.skippedRequests), static_cast<unsigned>(result.snapshots));
+    printf("requests: matched %u, not in the trace %u, not sent %u\n", static_cast<unsigned>(player.MatchedRequests()),
+           static_cast<unsigned>(player.UnmatchedRequests()), static_cast<unsigned>(player.MissedRequests()));
+    printf("transactions: %u, retries: %u, timeouts: %u, wrong responses: %u, discarded bytes: %u\n",
+           static_cast<unsigned>(statistics.Transactions()), static_cast<unsigned>(statistics.retries), static_cast<unsigned>(statistics.timeouts),
+           static_cast<unsigned>(statistics.wrongResponses), static_cast<unsigned>(statistics.discardedBytes));
+    printf("replayed %.1f s of virtual time, %.1f us cpu time per replay\n", static_cast<double>(result.virtualUs) / 1000000.0,
+           cpuUs / static_cast<double>(options.repeat));
+
+    const bool clean = (result.failedCalls == 0u) && (result.rejectedCalls == 0u) && (player.UnmatchedRequests() == 0u) && (player.MissedRequests() == 0u);
+
+    return clean ? 0 : 1;
+}
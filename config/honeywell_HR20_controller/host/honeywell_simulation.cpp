@@ -0,0 +1,781 @@
+/**
+ * @file honeywell_simulation.cpp
+ *
+ * @brief Runs both Honeywell managers against the simulated HR20 thermostat on the host.
+ *        Every command is executed blocking and asynchronously. The latency on the virtual clock is reported
+ *        and the result is compared with the state of the simulated thermostat.
+ *        The passive listen mode of the OpenHR20 manager is checked with unsolicited status lines.
+ *        The protocol detection is checked with both protocols, with and without a (wrong) cached result
+ *        and after probe rounds without an answer.
+ *        Several thermostats on their own UARTs are driven interleaved by the bus and compared with a sequential execution
+ *        and with separate non-blocking components.
+ *        The command and result queues of the I/O task are checked without FreeRTOS (the manager is advanced by Loop()).
+ *        The circuit breaker is checked with an unplugged thermostat, a blind write and an unsolicited status line.
+ *
+ *        Build & run (from this directory):
+ *          g++ -std=gnu++14 -O2 -I. -I.. honeywell_simulation.cpp -o honeywell_simulation && ./honeywell_simulation
+ *
+ *        Options: --baud <rate> --latency-us <us> --drop <probability> --noise <probability> --seed <n>
+ */
+
+#include "HR20Simulator.h"
+#include "HoneywellBus.h"
+#include "HoneywellIoTask.h"
+#include "HoneywellManager_AutoDetect.h"
+#include "HoneywellManager_HR20_V1.h"
+#include "HoneywellManager_OpenHR20.h"
+#include "esphome.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+namespace
+{
+
+/// @brief Period of the simulated ESPHome main loop
+constexpr uint32_t LOOP_PERIOD_US{ 1000 };
+
+/// @brief Max simulated time of one asynchronous command
+constexpr uint64_t ASYNC_TIMEOUT_US{ 30000000 };
+
+int failures = 0;
+
+/**
+ * @brief Compare a result and print one line of the report.
+ */
+void report(const char* manager, const char* operation, uint64_t startUs, ErrorCode errorCode, bool correct)
+{
+    const uint64_t durationUs = esphome::HostClock::Instance().NowUs() - startUs;
+    const bool passed         = (errorCode == ErrorCode::E_OK) && correct;
+
+    printf("%-8s %-34s %8.1f ms  error=%d  %s\n", manager, operation, static_cast<double>(durationUs) / 1000.0, static_cast<int>(errorCode),
+           passed ? "ok" : "FAILED");
+
+    if (!passed)
+    {
+        ++failures;
+    }
+}
+
+/**
+ * @brief Run the ESPHome loop till the asynchronous command is done.
+ */
+void runLoop(IHoneywellManager& manager, const bool& done, uint64_t timeoutUs = ASYNC_TIMEOUT_US)
+{
+    const uint64_t startUs = esphome::HostClock::Instance().NowUs();
+
+    while (!done && ((esphome::HostClock::Instance().NowUs() - startUs) < timeoutUs))
+    {
+        manager.Loop();
+        esphome::HostClock::Instance().Advance(LOOP_PERIOD_US);
+    }
+}
+
+void runOpenHR20(const HR20Simulator::Config& baseConfig)
+{
+    HR20Simulator::Config config = baseConfig;
+    config.protocol              = HR20Simulator::Protocol::E_OPEN_HR20;
+    HR20Simulator simulator(config);
+    HoneywellManager_OpenHR20 manager(&simulator);
+    HR20Simulator::OpenHR20State& device = simulator.GetOpenHR20State();
+    uint64_t startUs                     = 0;
+    ErrorCode errorCode                  = ErrorCode::E_NOT_OK;
+    int value                            = 0;
+    Mode mode                            = Mode::E_INVALID;
+    bool done                            = false;
+
+    // blocking API
+    startUs   = esphome::HostClock::Instance().NowUs();
+    errorCode = manager.GetDesiredTemperature(value);
+    report("OpenHR20", "GetDesiredTemperature", startUs, errorCode, value == (device.desiredTemperature / 10));
+
+    startUs   = esphome::HostClock::Instance().NowUs();
+    errorCode = manager.GetCurrentTemperature(value);
+    report("OpenHR20", "GetCurrentTemperature (cached)", startUs, errorCode, value == (device.currentTemperature / 10));
+
+    startUs   = esphome::HostClock::Instance().NowUs();
+    errorCode = manager.SetDesiredTemperature(225);
+    report("OpenHR20", "SetDesiredTemperature", startUs, errorCode, true);
+
+    startUs   = esphome::HostClock::Instance().NowUs();
+    errorCode = manager.GetDesiredTemperature(value);
+    report("OpenHR20", "GetDesiredTemperature (after set)", startUs, errorCode, (value == 225) && (device.desiredTemperature == 2250));
+
+    startUs   = esphome::HostClock::Instance().NowUs();
+    errorCode = manager.SetMode(Mode::E_AUTOMATIC);
+    report("OpenHR20", "SetMode", startUs, errorCode, true);
+
+    startUs   = esphome::HostClock::Instance().NowUs();
+    errorCode = manager.GetMode(mode);
+    report("OpenHR20", "GetMode", startUs, errorCode, (mode == Mode::E_AUTOMATIC) && device.automatic);
+
+    startUs   = esphome::HostClock::Instance().NowUs();
+    errorCode = manager.GetValvePosition(value);
+    report("OpenHR20", "GetValvePosition (cached)", startUs, errorCode, value == device.valvePosition);
+
+    startUs   = esphome::HostClock::Instance().NowUs();
+    errorCode = manager.GetCurrentBatteryVoltage(value);
+    report("OpenHR20", "GetCurrentBatteryVoltage (cached)", startUs, errorCode, value == device.batteryVoltage);
+
+    // asynchronous API
+    startUs = esphome::HostClock::Instance().NowUs();
+    done    = false;
+    manager.SetDesiredTemperatureAsync(180, [&](ErrorCode result) {
+        errorCode = result;
+        done      = true;
+    });
+    runLoop(manager, done);
+    report("OpenHR20", "SetDesiredTemperatureAsync", startUs, done ? errorCode : ErrorCode::E_RESPONSE_TIMEOUT, true);
+
+    startUs = esphome::HostClock::Instance().NowUs();
+    done    = false;
+    manager.GetDesiredTemperatureAsync([&](ErrorCode result, int temperature) {
+        errorCode = result;
+        value     = temperature;
+        done      = true;
+    });
+    runLoop(manager, done);
+    report("OpenHR20", "GetDesiredTemperatureAsync", startUs, done ? errorCode : ErrorCode::E_RESPONSE_TIMEOUT, value == 180);
+
+    // weekly heating programm, all commands pipelined
+    WeeklySchedule schedule;
+    startUs   = esphome::HostClock::Instance().NowUs();
+    errorCode = manager.GetSchedule(schedule);
+    report("OpenHR20", "GetSchedule", startUs, errorCode,
+           (schedule.presetTemperatures[2] == 200) && (schedule.slots[6][0].minutes == 360) && (schedule.slots[6][0].preset == 2) &&
+               (schedule.slots[6][7].minutes == WeeklySchedule::SLOT_DISABLED));
+
+    schedule.presetTemperatures[2] = 215;
+    schedule.slots[0][2]           = WeeklySchedule::Slot{ 17u * 60u + 30u, 3u };
+    schedule.slots[4][1].minutes   = WeeklySchedule::SLOT_DISABLED;
+    startUs                        = esphome::HostClock::Instance().NowUs();
+    done                           = false;
+    manager.SetScheduleAsync(schedule, [&](ErrorCode result) {
+        errorCode = result;
+        done      = true;
+    });
+    runLoop(manager, done);
+    report("OpenHR20", "SetScheduleAsync", startUs, done ? errorCode : ErrorCode::E_RESPONSE_TIMEOUT,
+           (device.config[3] == 43) && (device.timers[1][2] == ((3u << 12) | (17u * 60u + 30u))) && ((device.timers[5][1] & 0x0FFFu) == 0x0FFFu));
+
+    printf("OpenHR20 bytes to thermostat: %u, bytes from thermostat: %u\n\n", simulator.BytesFromHost(), simulator.BytesToHost());
+}
+
+void runOpenHR20Listener(const HR20Simulator::Config& baseConfig)
+{
+    HR20Simulator::Config config     = baseConfig;
+    config.protocol                  = HR20Simulator::Protocol::E_OPEN_HR20;
+    config.statusBroadcastIntervalUs = 60000000u;
+    config.broadcastOnChange         = true;
+    HR20Simulator simulator(config);
+    HoneywellManager_OpenHR20 manager(&simulator);
+    HR20Simulator::OpenHR20State& device = simulator.GetOpenHR20State();
+    HoneywellManager_OpenHR20::StatusSnapshot snapshot;
+    uint64_t startUs     = 0;
+    uint32_t updates     = 0;
+    bool done            = false;
+    ErrorCode errorCode  = ErrorCode::E_NOT_OK;
+    const uint32_t bytes = 0;
+
+    manager.SetListenMode(true);
+    manager.SetStatusObserver([&](ErrorCode result, const HoneywellManager_OpenHR20::StatusSnapshot& newSnapshot) {
+        errorCode = result;
+        snapshot  = newSnapshot;
+        ++updates;
+        done = true;
+    });
+
+    // periodic status line of the thermostat, no request is sent
+    startUs              = esphome::HostClock::Instance().NowUs();
+    device.valvePosition = 55;
+    done                 = false;
+    runLoop(manager, done, 61000000u);
+    report("OpenHR20", "Listen (periodic status line)", startUs, done ? errorCode : ErrorCode::E_RESPONSE_TIMEOUT,
+           (snapshot.valvePosition == 55) && (simulator.BytesFromHost() == bytes));
+
+    // state changed on the device, e.g. with the buttons
+    startUs                   = esphome::HostClock::Instance().NowUs();
+    device.currentTemperature = 1980;
+    simulator.BroadcastStatus();
+    done = false;
+    runLoop(manager, done);
+    report("OpenHR20", "Listen (status line after change)", startUs, done ? errorCode : ErrorCode::E_RESPONSE_TIMEOUT,
+           (snapshot.currentTemperature == 198) && (simulator.BytesFromHost() == bytes));
+
+    // a command of the manager, the status line after the change is reported as well
+    startUs = esphome::HostClock::Instance().NowUs();
+    done    = false;
+    manager.SetDesiredTemperatureAsync(200, nullptr);
+    runLoop(manager, done);
+    report("OpenHR20", "Listen (status line after command)", startUs, done ? errorCode : ErrorCode::E_RESPONSE_TIMEOUT,
+           snapshot.desiredTemperature == 200);
+
+    printf("OpenHR20 listener updates: %u, bytes to thermostat: %u, bytes from thermostat: %u\n\n", updates, simulator.BytesFromHost(),
+           simulator.BytesToHost());
+}
+
+/**
+ * @brief Lose the write commands on the line and let the manager resend the differing fields.
+ */
+void runOpenHR20Reconcile(const HR20Simulator::Config& baseConfig)
+{
+    HR20Simulator::Config config = baseConfig;
+    config.protocol              = HR20Simulator::Protocol::E_OPEN_HR20;
+    HR20Simulator simulator(config);
+    HoneywellManager_OpenHR20 manager(&simulator);
+    HR20Simulator::OpenHR20State& device = simulator.GetOpenHR20State();
+    ErrorCode errorCode                  = ErrorCode::E_NOT_OK;
+    ErrorCode modeResult                 = ErrorCode::E_NOT_OK;
+    ErrorCode temperatureResult          = ErrorCode::E_NOT_OK;
+
+    // the callbacks report the result of the reconciliation
+    auto write = [&]() {
+        modeResult        = ErrorCode::E_NOT_OK;
+        temperatureResult = ErrorCode::E_NOT_OK;
+        errorCode         = manager.SetModeAsync(Mode::E_MANUAL, [&](ErrorCode result) { modeResult = result; });
+        if (errorCode == ErrorCode::E_OK)
+        {
+            errorCode = manager.SetDesiredTemperatureAsync(235, [&](ErrorCode result) { temperatureResult = result; });
+        }
+
+        while (manager.IsBusy())
+        {
+            manager.Loop();
+            esphome::HostClock::Instance().Advance(LOOP_PERIOD_US);
+        }
+    };
+
+    auto reconcile = [&]() {
+        const uint64_t startUs = esphome::HostClock::Instance().NowUs();
+
+        while (manager.IsReconciling() && ((esphome::HostClock::Instance().NowUs() - startUs) < ASYNC_TIMEOUT_US))
+        {
+            manager.Loop();
+            esphome::HostClock::Instance().Advance(LOOP_PERIOD_US);
+        }
+    };
+
+    // both commands are lost, the next status line shows the old state
+    device.automatic = true;
+    simulator.SetConnected(false);
+    write();
+    simulator.SetConnected(true);
+
+    uint64_t startUs = esphome::HostClock::Instance().NowUs();
+    reconcile();
+    report("OpenHR20", "Reconcile lost writes", startUs, errorCode,
+           (device.desiredTemperature == 2350) && !device.automatic && (modeResult == ErrorCode::E_OK)
+               && (temperatureResult == ErrorCode::E_OK));
+
+    // the thermostat does not respond at all, the written state is dropped after the attempts
+    device.automatic = true;
+    simulator.SetConnected(false);
+    write();
+
+    startUs = esphome::HostClock::Instance().NowUs();
+    reconcile();
+    report("OpenHR20", "Reconcile gives up", startUs, errorCode,
+           device.automatic && !manager.IsReconciling() && (modeResult == ErrorCode::E_RESPONSE_WRONG)
+               && (temperatureResult == ErrorCode::E_RESPONSE_WRONG));
+    simulator.SetConnected(true);
+    printf("\n");
+}
+
+void runHR20V1(const HR20Simulator::Config& baseConfig)
+{
+    HR20Simulator::Config config = baseConfig;
+    config.protocol              = HR20Simulator::Protocol::E_HR20_V1;
+    HR20Simulator simulator(config);
+    HoneywellManager_HR20_V1 manager(&simulator);
+    uint64_t startUs    = 0;
+    ErrorCode errorCode = ErrorCode::E_NOT_OK;
+    int value           = 0;
+    Mode mode           = Mode::E_INVALID;
+    bool done           = false;
+
+    // blocking API
+    startUs   = esphome::HostClock::Instance().NowUs();
+    errorCode = manager.GetDesiredTemperature(value);
+    report("HR20_V1", "GetDesiredTemperature", startUs, errorCode, value == (simulator.Memory(0x137) + 60));
+
+    startUs   = esphome::HostClock::Instance().NowUs();
+    errorCode = manager.SetDesiredTemperature(225);
+    report("HR20_V1", "SetDesiredTemperature", startUs, errorCode, (simulator.Memory(0x137) == 165) && (simulator.Memory(0x20D) == 165));
+
+    startUs   = esphome::HostClock::Instance().NowUs();
+    errorCode = manager.SetMode(Mode::E_AUTOMATIC);
+    report("HR20_V1", "SetMode", startUs, errorCode, simulator.Memory(0x12C) == 0x10);
+
+    startUs   = esphome::HostClock::Instance().NowUs();
+    errorCode = manager.GetMode(mode);
+    report("HR20_V1", "GetMode", startUs, errorCode, mode == Mode::E_AUTOMATIC);
+
+    // asynchronous API
+    startUs = esphome::HostClock::Instance().NowUs();
+    done    = false;
+    manager.SetDesiredTemperatureAsync(75, [&](ErrorCode result) {
+        errorCode = result;
+        done      = true;
+    });
+    runLoop(manager, done);
+    report("HR20_V1", "SetDesiredTemperatureAsync (off)", startUs, done ? errorCode : ErrorCode::E_RESPONSE_TIMEOUT,
+           simulator.Memory(0x137) == 15);
+
+    startUs = esphome::HostClock::Instance().NowUs();
+    done    = false;
+    manager.GetModeAsync([&](ErrorCode result, Mode readMode) {
+        errorCode = result;
+        mode      = readMode;
+        done      = true;
+    });
+    runLoop(manager, done);
+    report("HR20_V1", "GetModeAsync", startUs, done ? errorCode : ErrorCode::E_RESPONSE_TIMEOUT, mode == Mode::E_AUTOMATIC);
+
+    startUs = esphome::HostClock::Instance().NowUs();
+    done    = false;
+    manager.GetStateAsync([&](ErrorCode result, int temperature, Mode readMode) {
+        errorCode = result;
+        value     = temperature;
+        mode      = readMode;
+        done      = true;
+    });
+    runLoop(manager, done);
+    report("HR20_V1", "GetStateAsync", startUs, done ? errorCode : ErrorCode::E_RESPONSE_TIMEOUT,
+           (value == 75) && (mode == Mode::E_AUTOMATIC));
+
+    // without callbacks the results are dropped, the next command reads the written mode
+    startUs = esphome::HostClock::Instance().NowUs();
+    done    = false;
+    manager.SetModeAsync(Mode::E_MANUAL, nullptr);
+    manager.GetDesiredTemperatureAsync(nullptr);
+    manager.GetStateAsync(nullptr);
+    manager.GetModeAsync([&](ErrorCode result, Mode readMode) {
+        errorCode = result;
+        mode      = readMode;
+        done      = true;
+    });
+    runLoop(manager, done);
+    report("HR20_V1", "Async without callbacks", startUs, done ? errorCode : ErrorCode::E_RESPONSE_TIMEOUT, mode == Mode::E_MANUAL);
+    manager.SetMode(Mode::E_AUTOMATIC);
+
+    // one session with several commands after one wake up
+    MemoryBatch batch;
+    batch.AddWrite(0x136, 0x0096);
+    batch.AddRead(0x136);
+    batch.AddRead(0x12B);
+    batch.AddRead(0x20C);
+    startUs   = esphome::HostClock::Instance().NowUs();
+    errorCode = manager.ExecuteBatch(batch);
+    report("HR20_V1", "ExecuteBatch (1 write, 3 reads)", startUs, errorCode,
+           (batch.operations[1].value == 0x96) && (batch.operations[2].value == 0x10) && (batch.operations[3].value == 0x1000));
+
+    printf("HR20_V1  bytes to thermostat: %u, bytes from thermostat: %u\n\n", simulator.BytesFromHost(), simulator.BytesToHost());
+}
+
+/**
+ * @brief Detect the protocol of the simulated thermostat and read the state with the detected backend.
+ *
+ * @param hint Cached backend of a previous boot, E_UNKNOWN to probe.
+ * @param expectedDetection Expected call of the detection observer, E_UNKNOWN if it shall not be called.
+ */
+void runAutoDetect(const HR20Simulator::Config& baseConfig, HR20Simulator::Protocol protocol, HoneywellBackendType hint,
+                   HoneywellBackendType expectedDetection, const char* operation)
+{
+    HR20Simulator::Config config = baseConfig;
+    config.protocol              = protocol;
+    HR20Simulator simulator(config);
+    HoneywellManager_AutoDetect manager(&simulator);
+    const HoneywellBackendType expected =
+        (protocol == HR20Simulator::Protocol::E_OPEN_HR20) ? HoneywellBackendType::E_OPEN_HR20 : HoneywellBackendType::E_HR20_V1;
+    HoneywellBackendType detected = HoneywellBackendType::E_UNKNOWN;
+    const uint64_t startUs        = esphome::HostClock::Instance().NowUs();
+    ErrorCode errorCode           = ErrorCode::E_NOT_OK;
+    bool done                     = false;
+
+    manager.SetBackendHint(hint);
+    manager.SetDetectionObserver([&](HoneywellBackendType backend) { detected = backend; });
+
+    // the adapter polls the state, requests are rejected while probing
+    for (uint32_t request = 0; (request < 10u) && (errorCode != ErrorCode::E_OK); ++request)
+    {
+        done = false;
+
+        if (ErrorCode::E_OK == manager.GetStateAsync([&](ErrorCode result, int, Mode) {
+                errorCode = result;
+                done      = true;
+            }))
+        {
+            runLoop(manager, done);
+        }
+        else
+        {
+            // probing
+            const uint64_t probeStartUs = esphome::HostClock::Instance().NowUs();
+
+            while ((manager.GetBackend() == HoneywellBackendType::E_UNKNOWN) &&
+                   ((esphome::HostClock::Instance().NowUs() - probeStartUs) < ASYNC_TIMEOUT_US))
+            {
+                manager.Loop();
+                esphome::HostClock::Instance().Advance(LOOP_PERIOD_US);
+            }
+        }
+    }
+
+    report("Auto", operation, startUs, errorCode, (manager.GetBackend() == expected) && (detected == expectedDetection));
+}
+
+/**
+ * @brief A thermostat which does not answer for several probe rounds is detected with the next round after it answers.
+ *        The failed probes must not open the circuit breakers, otherwise the probes would be rejected without sending.
+ */
+void runAutoDetectRetry(const HR20Simulator::Config& baseConfig)
+{
+    HR20Simulator::Config config = baseConfig;
+    config.protocol              = HR20Simulator::Protocol::E_HR20_V1;
+    HR20Simulator simulator(config);
+    HoneywellManager_AutoDetect manager(&simulator);
+    const bool never = false;
+
+    simulator.SetConnected(false);
+    runLoop(manager, never, 10u * HoneywellManager_AutoDetect::PROBE_RETRY_INTERVAL_MS * 1000u);
+
+    const uint64_t startUs = esphome::HostClock::Instance().NowUs();
+    simulator.SetConnected(true);
+
+    while ((manager.GetBackend() == HoneywellBackendType::E_UNKNOWN) &&
+           ((esphome::HostClock::Instance().NowUs() - startUs) < (2u * HoneywellManager_AutoDetect::PROBE_RETRY_INTERVAL_MS * 1000u)))
+    {
+        manager.Loop();
+        esphome::HostClock::Instance().Advance(LOOP_PERIOD_US);
+    }
+
+    report("Auto", "Detect after failed probe rounds", startUs, manager.IsAvailable() ? ErrorCode::E_OK : ErrorCode::E_DEVICE_UNAVAILABLE,
+           manager.GetBackend() == HoneywellBackendType::E_HR20_V1);
+}
+
+/**
+ * @brief Request the state of three thermostats on their own UARTs: one after the other, by separate non-blocking components
+ *        and interleaved by the bus.
+ */
+void runBus(const HR20Simulator::Config& baseConfig)
+{
+    HR20Simulator::Config openHR20Config = baseConfig;
+    openHR20Config.protocol              = HR20Simulator::Protocol::E_OPEN_HR20;
+    HR20Simulator::Config hr20V1Config   = baseConfig;
+    hr20V1Config.protocol                = HR20Simulator::Protocol::E_HR20_V1;
+    HR20Simulator simulators[3]{ HR20Simulator(openHR20Config), HR20Simulator(hr20V1Config), HR20Simulator(hr20V1Config) };
+    HoneywellManager_OpenHR20 openHR20(&simulators[0]);
+    HoneywellManager_HR20_V1 hr20V1First(&simulators[1]);
+    HoneywellManager_HR20_V1 hr20V1Second(&simulators[2]);
+    IHoneywellManager* managers[3]{ &openHR20, &hr20V1First, &hr20V1Second };
+    ErrorCode errorCodes[3]{ ErrorCode::E_NOT_OK, ErrorCode::E_NOT_OK, ErrorCode::E_NOT_OK };
+    uint32_t completed = 0;
+    HoneywellBus bus;
+
+    // one after the other, like one ESPHome component per thermostat with blocking commands
+    uint64_t startUs = esphome::HostClock::Instance().NowUs();
+    for (size_t i = 0; i < 3u; ++i)
+    {
+        bool done = false;
+        managers[i]->GetStateAsync([&, i](ErrorCode result, int, Mode) {
+            errorCodes[i] = result;
+            done          = true;
+        });
+        runLoop(*managers[i], done);
+    }
+    const uint64_t sequentialUs = esphome::HostClock::Instance().NowUs() - startUs;
+    report("Bus", "GetStateAsync x3 (sequential)", startUs, errorCodes[0],
+           (errorCodes[1] == ErrorCode::E_OK) && (errorCodes[2] == ErrorCode::E_OK));
+
+    // all requests at once, the thermostats fall asleep and the cached status expires before
+    auto requestAll = [&]() {
+        esphome::HostClock::Instance().Advance(5000000u);
+        completed = 0;
+        for (size_t i = 0; i < 3u; ++i)
+        {
+            errorCodes[i] = ErrorCode::E_NOT_OK;
+            managers[i]->GetStateAsync([&, i](ErrorCode result, int, Mode) {
+                errorCodes[i] = result;
+                ++completed;
+            });
+        }
+        return esphome::HostClock::Instance().NowUs();
+    };
+
+    // one ESPHome component per thermostat with its own loop(), the transactions are in flight at the same time as well
+    for (IHoneywellManager* manager : managers)
+    {
+        manager->SetLoopBudget(20u);
+    }
+    startUs = requestAll();
+    while ((completed < 3u) && ((esphome::HostClock::Instance().NowUs() - startUs) < ASYNC_TIMEOUT_US))
+    {
+        for (IHoneywellManager* manager : managers)
+        {
+            manager->Loop();
+        }
+        esphome::HostClock::Instance().Advance(LOOP_PERIOD_US);
+    }
+    const uint64_t separateUs = esphome::HostClock::Instance().NowUs() - startUs;
+    report("Bus", "GetStateAsync x3 (separate loops)", startUs, errorCodes[0],
+           (errorCodes[1] == ErrorCode::E_OK) && (errorCodes[2] == ErrorCode::E_OK) && (separateUs < sequentialUs));
+
+    // interleaved by the bus, all thermostats share one loop budget
+    for (size_t i = 0; i < 3u; ++i)
+    {
+        bus.AddManager(*managers[i]);
+    }
+    bus.SetLoopBudget(20u);
+
+    startUs = requestAll();
+    while ((completed < 3u) && ((esphome::HostClock::Instance().NowUs() - startUs) < ASYNC_TIMEOUT_US))
+    {
+        bus.Loop();
+        esphome::HostClock::Instance().Advance(LOOP_PERIOD_US);
+    }
+    const uint64_t interleavedUs = esphome::HostClock::Instance().NowUs() - startUs;
+    report("Bus", "GetStateAsync x3 (interleaved)", startUs, errorCodes[0],
+           (errorCodes[1] == ErrorCode::E_OK) && (errorCodes[2] == ErrorCode::E_OK) && (interleavedUs < sequentialUs));
+
+    printf("Bus      separate/sequential: %.0f %%, interleaved/sequential: %.0f %%\n\n",
+           100.0 * static_cast<double>(separateUs) / static_cast<double>(sequentialUs),
+           100.0 * static_cast<double>(interleavedUs) / static_cast<double>(sequentialUs));
+}
+
+/**
+ * @brief Commands and results through the queues of the I/O task, with an unsolicited status line and protocol detection.
+ */
+void runIoTask(const HR20Simulator::Config& baseConfig)
+{
+    HR20Simulator::Config config     = baseConfig;
+    config.protocol                  = HR20Simulator::Protocol::E_OPEN_HR20;
+    config.broadcastOnChange         = true;
+    HR20Simulator simulator(config);
+    HoneywellIoTask<HoneywellManager_AutoDetect> manager(&simulator);
+    HR20Simulator::OpenHR20State& device = simulator.GetOpenHR20State();
+    HoneywellBackendType detected        = HoneywellBackendType::E_UNKNOWN;
+    uint32_t updates                     = 0;
+    ErrorCode errorCode                  = ErrorCode::E_NOT_OK;
+    int value                            = 0;
+    bool done                            = false;
+
+    manager.SetDetectionObserver([&](HoneywellBackendType backend) { detected = backend; });
+    manager.SetStatusObserver([&](ErrorCode result, const HoneywellManager_AutoDetect::StatusSnapshot& snapshot) {
+        if (ErrorCode::E_OK == result)
+        {
+            value = snapshot.desiredTemperature;
+            ++updates;
+        }
+    });
+    manager.SetListenMode(true);
+
+    // rejected while probing, the queued command is completed without a callback
+    uint64_t startUs = esphome::HostClock::Instance().NowUs();
+    while ((detected == HoneywellBackendType::E_UNKNOWN) && ((esphome::HostClock::Instance().NowUs() - startUs) < ASYNC_TIMEOUT_US))
+    {
+        if (!manager.IsBusy())
+        {
+            manager.GetStateAsync(nullptr);
+        }
+        manager.Loop();
+        esphome::HostClock::Instance().Advance(LOOP_PERIOD_US);
+    }
+    report("IoTask", "Detect OpenHR20", startUs, ErrorCode::E_OK,
+           (detected == HoneywellBackendType::E_OPEN_HR20) && manager.IsListenMode());
+
+    startUs = esphome::HostClock::Instance().NowUs();
+    done    = false;
+    manager.SetDesiredTemperatureAsync(210, [&](ErrorCode result) {
+        errorCode = result;
+        done      = true;
+    });
+    runLoop(manager, done);
+
+    // the status line after the change is reported by the observer
+    const bool never = false;
+    runLoop(manager, never, 500000u);
+    report("IoTask", "SetDesiredTemperatureAsync", startUs, errorCode,
+           (device.desiredTemperature == 2100) && (value == 210) && (updates > 0u) && !manager.IsBusy());
+    printf("\n");
+}
+
+/**
+ * @brief Request the state of an unplugged thermostat till it is unavailable, and plug it in again.
+ */
+void runCircuitBreaker(const HR20Simulator::Config& baseConfig)
+{
+    HR20Simulator::Config config = baseConfig;
+    config.protocol              = HR20Simulator::Protocol::E_HR20_V1;
+    HR20Simulator simulator(config);
+    HoneywellManager_HR20_V1 manager(&simulator);
+    RetryPolicy policy;
+    ErrorCode errorCode = ErrorCode::E_NOT_OK;
+    bool done           = false;
+
+    policy.breakerFailureThreshold = 3;
+    policy.breakerProbeIntervalMs  = 10000;
+    manager.SetRetryPolicy(policy);
+
+    auto getState = [&]() {
+        done = false;
+        manager.GetStateAsync([&](ErrorCode result, int, Mode) {
+            errorCode = result;
+            done      = true;
+        });
+        runLoop(manager, done);
+    };
+
+    simulator.SetConnected(false);
+
+    uint64_t startUs = esphome::HostClock::Instance().NowUs();
+    // every request of the batch counts, a state request has two
+    for (uint8_t i = 0; (i < policy.breakerFailureThreshold) && manager.IsAvailable(); ++i)
+    {
+        getState();
+    }
+    report("Breaker", "Timeouts till unavailable", startUs, (errorCode == ErrorCode::E_RESPONSE_TIMEOUT) ? ErrorCode::E_OK : errorCode,
+           !manager.IsAvailable());
+
+    startUs = esphome::HostClock::Instance().NowUs();
+    getState();
+    report("Breaker", "Request while unavailable", startUs, (errorCode == ErrorCode::E_DEVICE_UNAVAILABLE) ? ErrorCode::E_OK : errorCode,
+           (esphome::HostClock::Instance().NowUs() - startUs) < 10000u);
+
+    // the next request after the probe interval is sent
+    simulator.SetConnected(true);
+    esphome::HostClock::Instance().Advance(12000000u);
+    startUs = esphome::HostClock::Instance().NowUs();
+    getState();
+    report("Breaker", "Probe after plugged in", startUs, errorCode, manager.IsAvailable());
+
+    // every timeout, retry and rejected request is counted
+    HoneywellStatistics statistics;
+    manager.GetStatistics(statistics);
+    startUs = esphome::HostClock::Instance().NowUs();
+    report("Breaker", "Statistics", startUs, ErrorCode::E_OK,
+           (statistics.timeouts >= policy.breakerFailureThreshold) && (statistics.retries >= statistics.timeouts) && (statistics.rejected >= 1u) &&
+               (statistics.transactionMs.Samples() == (statistics.Transactions())));
+    statistics.Log();
+    printf("\n");
+}
+
+/**
+ * @brief A blind write to an unavailable OpenHR20 thermostat must not make it available, an unsolicited status line does.
+ */
+void runOpenHR20CircuitBreaker(const HR20Simulator::Config& baseConfig)
+{
+    HR20Simulator::Config config = baseConfig;
+    config.protocol              = HR20Simulator::Protocol::E_OPEN_HR20;
+    HR20Simulator simulator(config);
+    HoneywellManager_OpenHR20 manager(&simulator);
+    RetryPolicy policy;
+    ErrorCode errorCode = ErrorCode::E_NOT_OK;
+    bool done           = false;
+
+    policy.breakerFailureThreshold = 3;
+    policy.breakerProbeIntervalMs  = 10000;
+    manager.SetRetryPolicy(policy);
+
+    simulator.SetConnected(false);
+
+    uint64_t startUs = esphome::HostClock::Instance().NowUs();
+    for (uint8_t i = 0; (i < policy.breakerFailureThreshold) && manager.IsAvailable(); ++i)
+    {
+        done = false;
+        manager.GetStatusSnapshotAsync(
+            [&](ErrorCode result, const HoneywellManager_OpenHR20::StatusSnapshot&) {
+                errorCode = result;
+                done      = true;
+            },
+            0u);
+        runLoop(manager, done);
+    }
+    report("Breaker", "OpenHR20 till unavailable", startUs,
+           (errorCode == ErrorCode::E_RESPONSE_TIMEOUT) ? ErrorCode::E_OK : errorCode, !manager.IsAvailable());
+
+    // the command is let through as probe, but a command without response does not show that the thermostat is there.
+    // The written mode is not confirmed, as long as the thermostat does not respond.
+    esphome::HostClock::Instance().Advance(12000000u);
+    startUs = esphome::HostClock::Instance().NowUs();
+    done    = false;
+    manager.SetModeAsync(Mode::E_MANUAL, [&](ErrorCode result) {
+        errorCode = result;
+        done      = true;
+    });
+    runLoop(manager, done, 2000000u);
+    report("Breaker", "OpenHR20 blind write (unavailable)", startUs, ErrorCode::E_OK, !done && !manager.IsAvailable());
+
+    // a status line of a thermostat, which is only listened to (repeated, if the line is disturbed)
+    simulator.SetConnected(true);
+    manager.SetListenMode(true);
+    startUs = esphome::HostClock::Instance().NowUs();
+    for (uint8_t i = 0; (i < 5u) && !manager.IsAvailable(); ++i)
+    {
+        simulator.BroadcastStatus();
+        done = false;
+        runLoop(manager, done, 200000u);
+    }
+    report("Breaker", "OpenHR20 status line (unavailable)", startUs, ErrorCode::E_OK, manager.IsAvailable());
+    printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    HR20Simulator::Config config;
+
+    for (int i = 1; (i + 1) < argc; i += 2)
+    {
+        if (0 == strcmp(argv[i], "--baud"))
+        {
+            config.baudRate = static_cast<uint32_t>(atoi(argv[i + 1]));
+        }
+        else if (0 == strcmp(argv[i], "--latency-us"))
+        {
+            config.responseLatencyUs = static_cast<uint32_t>(atoi(argv[i + 1]));
+        }
+        else if (0 == strcmp(argv[i], "--drop"))
+        {
+            config.txDropProbability = atof(argv[i + 1]);
+            config.rxDropProbability = config.txDropProbability;
+        }
+        else if (0 == strcmp(argv[i], "--noise"))
+        {
+            config.noiseProbability = atof(argv[i + 1]);
+        }
+        else if (0 == strcmp(argv[i], "--seed"))
+        {
+            config.seed = static_cast<uint32_t>(atoi(argv[i + 1]));
+        }
+        else
+        {
+            printf("unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    runOpenHR20(config);
+    runOpenHR20Listener(config);
+    runOpenHR20Reconcile(config);
+    runHR20V1(config);
+    runAutoDetect(config, HR20Simulator::Protocol::E_OPEN_HR20, HoneywellBackendType::E_UNKNOWN, HoneywellBackendType::E_OPEN_HR20,
+                  "Detect OpenHR20");
+    runAutoDetect(config, HR20Simulator::Protocol::E_HR20_V1, HoneywellBackendType::E_UNKNOWN, HoneywellBackendType::E_HR20_V1,
+                  "Detect HR20_V1");
+    runAutoDetect(config, HR20Simulator::Protocol::E_HR20_V1, HoneywellBackendType::E_HR20_V1, HoneywellBackendType::E_UNKNOWN,
+                  "Cached HR20_V1");
+    runAutoDetect(config, HR20Simulator::Protocol::E_HR20_V1, HoneywellBackendType::E_OPEN_HR20, HoneywellBackendType::E_HR20_V1,
+                  "Wrong cached OpenHR20");
+    runAutoDetectRetry(config);
+    printf("\n");
+    runBus(config);
+    runIoTask(config);
+    runCircuitBreaker(config);
+    runOpenHR20CircuitBreaker(config);
+
+    printf("%d failure(s)\n", failures);
+
+    return (failures == 0) ? 0 : 1;
+}